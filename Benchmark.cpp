@@ -1,15 +1,36 @@
+#include "Metrics/Binary.hpp"
+#include "Metrics/Clock.hpp"
+#include "Metrics/CountMinSketch.hpp"
+#include "Metrics/Counter.hpp"
+#include "Metrics/Covariance.hpp"
+#include "Metrics/EwmaVariance.hpp"
+#include "Metrics/ExponentiallyDecayingReservoir.hpp"
 #include "Metrics/Gauge.hpp"
 #include "Metrics/Histogram.hpp"
+#include "Metrics/HyperLogLog.hpp"
 #include "Metrics/Kurtosis.hpp"
 #include "Metrics/LinearRegression.hpp"
+#include "Metrics/Meter.hpp"
 #include "Metrics/MinMax.hpp"
 #include "Metrics/MinMeanMax.hpp"
+#include "Metrics/Moments.hpp"
 #include "Metrics/Registry.hpp"
+#include "Metrics/RollingVariance.hpp"
 #include "Metrics/SamplingReservoir.hpp"
+#include "Metrics/SharedRegistry.hpp"
+#include "Metrics/SlidingTimeWindowReservoir.hpp"
 #include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Stats.hpp"
+#include "Metrics/TextExporter.hpp"
+#include "Metrics/TimeWindow.hpp"
+#include "Metrics/Timer.hpp"
+#include "Metrics/TopK.hpp"
 #include "Metrics/Variance.hpp"
 #include "elapsed.hpp"
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <thread>
 #include <vector>
 
 const int LOOPS_UPDATE = 5000000;
@@ -22,6 +43,46 @@ class DummyMutex {
     void unlock() {}
 };
 
+/** reference for Counter: a single atomic shared by all threads */
+class AtomicCounter {
+  public:
+    void inc() { _value.fetch_add(1, std::memory_order_relaxed); }
+    int64_t count() const { return _value.load(); }
+
+  private:
+    std::atomic<int64_t> _value{0};
+};
+
+/** increment counter LOOPS_UPDATE times from each thread, return time per
+ * increment per thread */
+template <typename T>
+double incrementFromThreads(T &counter, unsigned threads) {
+    std::vector<std::thread> workers;
+    Elapsed s;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([&counter]() {
+            for (int j = 0; j < LOOPS_UPDATE; j++) {
+                counter.inc();
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+}
+
+/** time an empty scope LOOPS_UPDATE times, return time per loop */
+template <typename C> double timeEmptyScope() {
+    Metrics::Timer<Metrics::SlidingWindowReservoir<double, DummyMutex>, C>
+        timer{1000};
+    Elapsed s;
+    for (int i = 0; i < LOOPS_UPDATE; i++) {
+        auto scope = timer.time();
+    }
+    return static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+}
+
 int main() {
     std::cout << "Looping, no of iterations: " << LOOPS_UPDATE << std::endl;
     {
@@ -76,6 +137,119 @@ int main() {
         printf("time per loop: %.1lf ns\n\n", ns_per_loop);
     }
 
+    {
+        using namespace Metrics::Feature;
+        std::cout << "BasicStats<double,DummyMutex,Count,Min,Max,M2>()"
+                  << std::endl;
+        Metrics::BasicStats<double, DummyMutex, Count, Min, Max, M2> stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        using namespace Metrics::Feature;
+        std::cout << "BasicStats<double,DummyMutex,Mean,M2>()" << std::endl;
+        Metrics::BasicStats<double, DummyMutex, Mean, M2> stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "Variance<double,DummyMutex,ShiftedSumAccumulator>()"
+                  << std::endl;
+        Metrics::Variance<double, DummyMutex,
+                          Metrics::Internals::ShiftedSumAccumulator<double>>
+            stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "Variance<double,DummyMutex,ShiftedSumAccumulator<double,"
+                     "true>>()"
+                  << std::endl;
+        Metrics::Variance<
+            double, DummyMutex,
+            Metrics::Internals::ShiftedSumAccumulator<double, true>>
+            stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "EwmaVariance<double,DummyMutex>()" << std::endl;
+        Metrics::EwmaVariance<double, DummyMutex> stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "RollingVariance<double,DummyMutex>(10000)" << std::endl;
+        Metrics::RollingVariance<double, DummyMutex> stats(10000);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n", ns_per_loop);
+
+        Elapsed elapsedOutput;
+        for (int i = 0; i < LOOPS_OUTPUT; i++) {
+            auto output = stats.toString();
+        }
+        double output_us_per_loop =
+            static_cast<double>(elapsedOutput.ElapsedUs()) / LOOPS_OUTPUT;
+        printf("output time per loop: %.1lf us\n\n", output_us_per_loop);
+    }
+
+    {
+        std::cout << "TimeWindow<VarianceNoLock<double>,DummyMutex>(300)"
+                  << std::endl;
+        Metrics::TimeWindow<Metrics::Internals::VarianceNoLock<double>,
+                            DummyMutex>
+            stats(300);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
     {
         std::cout << "Kurtosis<double,DummyMutex>()" << std::endl;
         Metrics::Kurtosis<double, DummyMutex> stats;
@@ -89,6 +263,51 @@ int main() {
         printf("time per loop: %.1lf ns\n\n", ns_per_loop);
     }
 
+    {
+        std::cout << "Moments<4,double,DummyMutex>()" << std::endl;
+        Metrics::Moments<4, double, DummyMutex> stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "Moments<6,double,DummyMutex>()" << std::endl;
+        Metrics::Moments<6, double, DummyMutex> stats;
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            stats.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        constexpr int BATCH = 1000;
+        std::cout << "Moments<4,double,DummyMutex>(), batches of " << BATCH
+                  << std::endl;
+        Metrics::Moments<4, double, DummyMutex> stats;
+        std::vector<double> values(BATCH);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i += BATCH) {
+            for (int j = 0; j < BATCH; j++) {
+                values[j] = i + j;
+            }
+            stats.updateBatch(values.data(), values.size());
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Stats: " << stats.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
     {
         std::cout << "LinearRegression<double,DummyMutex>()" << std::endl;
         Metrics::LinearRegression<double, DummyMutex> stats;
@@ -150,6 +369,31 @@ int main() {
         printf("time per loop: %.1lf ns\n\n", ns_per_loop);
     }
 
+    {
+        std::cout << "SlidingTimeWindowReservoir<double>(10000)" << std::endl;
+        Metrics::SlidingTimeWindowReservoir<double> reservoir(10000);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            reservoir.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "ExponentiallyDecayingReservoir<double>(1028)"
+                  << std::endl;
+        Metrics::ExponentiallyDecayingReservoir<double> reservoir(1028);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            reservoir.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
     {
         std::cout << "Gauge<double>()" << std::endl;
         Metrics::Gauge<double> gauge{};
@@ -162,6 +406,117 @@ int main() {
         printf("time per loop: %.1lf ns\n\n", ns_per_loop);
     }
 
+    {
+        std::cout << "Meter<>()" << std::endl;
+        Metrics::Meter<> meter{};
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            meter.mark();
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "Meter: " << meter.toString(1) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        // with a single hardware thread the threads take turns and there is
+        // no contention, so both variants are expected to be equally fast
+        const unsigned hardware = std::thread::hardware_concurrency();
+        const unsigned threads = std::max(2U, hardware);
+        std::cout << "Counter<>() vs std::atomic, " << threads << " threads on "
+                  << hardware << " hardware threads" << std::endl;
+        AtomicCounter atomic{};
+        double ns_per_loop = incrementFromThreads(atomic, threads);
+        printf("std::atomic time per loop: %.1lf ns\n", ns_per_loop);
+
+        Metrics::Counter<> counter{};
+        ns_per_loop = incrementFromThreads(counter, threads);
+        printf("Counter<ThreadCellIndex> time per loop: %.1lf ns\n",
+               ns_per_loop);
+
+        Metrics::Counter<Metrics::Internals::CpuCellIndex> cpu_counter{};
+        ns_per_loop = incrementFromThreads(cpu_counter, threads);
+        printf("Counter<CpuCellIndex> time per loop: %.1lf ns\n\n",
+               ns_per_loop);
+    }
+
+    {
+        std::cout << "HyperLogLog<>(14)" << std::endl;
+        Metrics::HyperLogLog<> hll{14};
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            hll.update(i);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "HyperLogLog: " << hll.toString() << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "Covariance<double,DummyMutex>(16)" << std::endl;
+        Metrics::Covariance<double, DummyMutex> covariance{16};
+        std::vector<double> values(16);
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE / 16; i++) {
+            for (unsigned j = 0; j < values.size(); j++) {
+                values[j] = i + j;
+            }
+            covariance.update(values);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / (LOOPS_UPDATE / 16);
+        std::cout << "Covariance: count(" << covariance.count()
+                  << ") correlation(0, 1): " << covariance.correlation(0, 1)
+                  << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "CountMinSketch(2048, 4)" << std::endl;
+        Metrics::CountMinSketch sketch{2048, 4};
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            sketch.update(i & 4095);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "CountMinSketch: " << sketch.toString()
+                  << ", estimate(0): " << sketch.estimate(0) << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "TopK<int>(100), zipf-like keys" << std::endl;
+        Metrics::TopK<int> topk{100};
+        std::vector<int> keys(1024);
+        for (unsigned i = 0; i < keys.size(); i++) {
+            // key k appears about 1/k of the time
+            keys[i] = static_cast<int>(keys.size() / (i + 1));
+        }
+        Elapsed s;
+        for (int i = 0; i < LOOPS_UPDATE; i++) {
+            topk.update(keys[(static_cast<unsigned>(i) * 7919) & 1023]);
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+        std::cout << "TopK: " << topk.top()[0].key << "("
+                  << topk.top()[0].count << ")" << std::endl;
+        printf("time per loop: %.1lf ns\n\n", ns_per_loop);
+    }
+
+    {
+        std::cout << "Timer<SlidingWindowReservoir<double,DummyMutex>>(1000)"
+                  << std::endl;
+        printf("steady_clock time per loop: %.1lf ns\n",
+               timeEmptyScope<std::chrono::steady_clock>());
+        printf("CoarseClock time per loop: %.1lf ns\n",
+               timeEmptyScope<Metrics::CoarseClock>());
+        printf("TscClock time per loop: %.1lf ns\n\n",
+               timeEmptyScope<Metrics::TscClock>());
+    }
+
     {
         std::cout << "Histogram<SamplingReservoir<double>>(1000)" << std::endl;
         Metrics::Histogram<Metrics::SamplingReservoir<double>, double>
@@ -290,9 +645,156 @@ int main() {
             printf("updating shared_ptr<Variance> time per loop: %.1lf ns\n",
                    ns_per_loop);
         }
+        auto handle = registry.create<Metrics::Variance<double>>("my handle");
+        {
+            Elapsed s;
+            for (int i = 0; i < LOOPS_UPDATE; i++) {
+                handle->update(i);
+            }
+            double ns_per_loop =
+                static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+            printf("updating Handle<Variance> time per loop: %.1lf ns\n",
+                   ns_per_loop);
+        }
         std::cout << "Registry:" << std::endl
                   << registry.reportString(1) << std::endl;
     }
 
+    {
+        constexpr int HISTOGRAMS = 1000;
+        constexpr int REPORTS = 20;
+        Metrics::Registry registry;
+        for (int i = 0; i < HISTOGRAMS; i++) {
+            auto histogram = std::make_shared<
+                Metrics::Histogram<Metrics::SlidingWindowReservoir<>>>(1000);
+            for (int j = 0; j < 1000; j++) {
+                histogram->update(j);
+            }
+            registry.addMetric("histogram " + std::to_string(i), histogram);
+        }
+
+        std::cout << "Registry with " << HISTOGRAMS
+                  << " histograms, report into existing map" << std::endl;
+        std::map<std::string, std::string> report;
+        Elapsed s;
+        for (int i = 0; i < REPORTS; i++) {
+            registry.reportMap(report, 1);
+        }
+        double us_per_loop =
+            static_cast<double>(s.ElapsedUs()) / REPORTS / HISTOGRAMS;
+        printf("time per histogram: %.2lf us\n", us_per_loop);
+
+        std::cout << "Registry with " << HISTOGRAMS
+                  << " histograms, visit with TextExporter" << std::endl;
+        Metrics::TextExporter exporter(1);
+        Elapsed s2;
+        for (int i = 0; i < REPORTS; i++) {
+            exporter.clear();
+            registry.visit(exporter);
+        }
+        us_per_loop =
+            static_cast<double>(s2.ElapsedUs()) / REPORTS / HISTOGRAMS;
+        printf("time per histogram: %.2lf us\n\n", us_per_loop);
+    }
+
+    {
+        constexpr int METRICS = 20000;
+        constexpr int REPORTS = 20;
+        Metrics::Registry registry;
+        for (int i = 0; i < METRICS; i++) {
+            auto stats = registry.create<Metrics::Variance<>>(
+                "stats " + std::to_string(i));
+            for (int j = 0; j < 10; j++) {
+                stats->update(j);
+            }
+        }
+
+        std::cout << "Registry with " << METRICS
+                  << " Variance metrics, report into existing map"
+                  << std::endl;
+        std::map<std::string, std::string> report;
+        {
+            Elapsed s;
+            for (int i = 0; i < REPORTS; i++) {
+                registry.reportMap(report, 1);
+            }
+            double ns_per_loop = static_cast<double>(s.ElapsedUs()) * 1000.0 /
+                                 REPORTS / METRICS;
+            printf("time per metric: %.1lf ns\n", ns_per_loop);
+        }
+
+        std::cout << "Registry with " << METRICS
+                  << " Variance metrics, visit with TextExporter" << std::endl;
+        Metrics::TextExporter exporter(1);
+        {
+            Elapsed s;
+            for (int i = 0; i < REPORTS; i++) {
+                exporter.clear();
+                registry.visit(exporter);
+            }
+            double ns_per_loop = static_cast<double>(s.ElapsedUs()) * 1000.0 /
+                                 REPORTS / METRICS;
+            printf("time per metric: %.1lf ns\n\n", ns_per_loop);
+        }
+    }
+
+    {
+        Metrics::Internals::VarianceNoLock<double> state;
+        for (int i = 0; i < 1000; i++) {
+            state.update(i);
+        }
+        std::vector<uint8_t> data;
+        Metrics::serialize(state, data);
+        std::cout << "VarianceNoLock serialize/deserialize, " << data.size()
+                  << " bytes" << std::endl;
+        Elapsed s;
+        Metrics::Internals::VarianceNoLock<double> merged;
+        for (int i = 0; i < LOOPS_OUTPUT; i++) {
+            data.clear();
+            Metrics::serialize(state, data);
+            Metrics::Internals::VarianceNoLock<double> decoded;
+            Metrics::deserialize(decoded, data);
+            merged += decoded;
+        }
+        double ns_per_loop =
+            static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_OUTPUT;
+        printf("time per serialize, deserialize and merge: %.1lf ns\n",
+               ns_per_loop);
+        std::cout << "Merged: " << merged.toString() << std::endl << std::endl;
+    }
+
+    {
+        const std::string name =
+            "/metrics-benchmark-" + std::to_string(getpid());
+        Metrics::SharedRegistry<> registry(name);
+        auto handle =
+            registry.create<Metrics::Internals::VarianceNoLock<double>>(
+                "shared");
+        {
+            Elapsed s;
+            for (int i = 0; i < LOOPS_UPDATE; i++) {
+                handle.update(i);
+            }
+            double ns_per_loop =
+                static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_UPDATE;
+            printf("updating SharedHandle<VarianceNoLock> time per loop: "
+                   "%.1lf ns\n",
+                   ns_per_loop);
+        }
+        Metrics::SharedRegistryReader reader(name);
+        std::string report;
+        {
+            Elapsed s;
+            for (int i = 0; i < LOOPS_OUTPUT; i++) {
+                report = reader.reportString(1);
+            }
+            double ns_per_loop =
+                static_cast<double>(s.ElapsedUs()) * 1000.0 / LOOPS_OUTPUT;
+            printf("SharedRegistryReader report time per loop: %.1lf ns\n",
+                   ns_per_loop);
+        }
+        std::cout << "Shared registry:" << std::endl << report << std::endl;
+    }
+
     return 0;
 }
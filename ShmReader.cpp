@@ -0,0 +1,35 @@
+#include "Metrics/SharedRegistry.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+/* Print the report of a SharedRegistry of another process, e.g.
+   ShmReader /myservice.metrics 2 10
+   prints the metrics with precision 2 every 10 seconds. */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <name> [precision] [interval]"
+                  << std::endl;
+        return 1;
+    }
+    const int precision = (argc > 2) ? std::atoi(argv[2]) : -1;
+    const int interval = (argc > 3) ? std::atoi(argv[3]) : 0;
+
+    try {
+        Metrics::SharedRegistryReader reader(argv[1]);
+        for (;;) {
+            std::cout << reader.reportString(precision) << std::flush;
+            if (interval <= 0) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(interval));
+            std::cout << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
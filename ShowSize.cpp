@@ -1,12 +1,26 @@
+#include "Metrics/CountMinSketch.hpp"
+#include "Metrics/Counter.hpp"
+#include "Metrics/Covariance.hpp"
+#include "Metrics/EwmaVariance.hpp"
+#include "Metrics/FixedSamplingReservoir.hpp"
+#include "Metrics/FixedSlidingWindowReservoir.hpp"
 #include "Metrics/Gauge.hpp"
 #include "Metrics/Histogram.hpp"
+#include "Metrics/HyperLogLog.hpp"
 #include "Metrics/Kurtosis.hpp"
 #include "Metrics/LinearRegression.hpp"
+#include "Metrics/Meter.hpp"
 #include "Metrics/MinMax.hpp"
 #include "Metrics/MinMeanMax.hpp"
+#include "Metrics/Moments.hpp"
 #include "Metrics/Registry.hpp"
+#include "Metrics/RollingVariance.hpp"
 #include "Metrics/SamplingReservoir.hpp"
 #include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Stats.hpp"
+#include "Metrics/TimeWindow.hpp"
+#include "Metrics/Timer.hpp"
+#include "Metrics/TopK.hpp"
 #include "Metrics/Variance.hpp"
 #include <iostream>
 #include <vector>
@@ -35,6 +49,48 @@ int main() {
         std::cout << "sizeof Variance<double,DummyMutex>: " << sizeof dut
                   << std::endl;
     }
+    {
+        using namespace Metrics::Feature;
+        Metrics::BasicStats<double, DummyMutex, Count, Min, Max, M2> dut;
+        std::cout << "sizeof Stats<Count,Min,Max,M2,DummyMutex>: "
+                  << sizeof dut << std::endl;
+    }
+    {
+        using namespace Metrics::Feature;
+        Metrics::BasicStats<double, DummyMutex, Mean, M2> dut;
+        std::cout << "sizeof Stats<Mean,M2,DummyMutex>: " << sizeof dut
+                  << std::endl;
+    }
+    {
+        using namespace Metrics::Feature;
+        Metrics::BasicStats<double, DummyMutex, Min, Max> dut;
+        std::cout << "sizeof Stats<Min,Max,DummyMutex>: " << sizeof dut
+                  << std::endl;
+    }
+    {
+        Metrics::Moments<6, double, DummyMutex> dut;
+        std::cout << "sizeof Moments<6,double,DummyMutex>: " << sizeof dut
+                  << std::endl;
+    }
+    {
+        Metrics::EwmaVariance<double, DummyMutex> dut;
+        std::cout << "sizeof EwmaVariance<double,DummyMutex>: " << sizeof dut
+                  << std::endl;
+    }
+    {
+        Metrics::RollingVariance<double, DummyMutex> dut(10000);
+        std::cout << "sizeof RollingVariance<double,DummyMutex>(10000): "
+                  << sizeof dut << std::endl;
+    }
+    {
+        Metrics::TimeWindow<Metrics::Internals::VarianceNoLock<double>,
+                            DummyMutex>
+            dut(300);
+        std::cout << "sizeof TimeWindow<VarianceNoLock<double>,DummyMutex>(300): "
+                  << sizeof dut << " + " << 300 * sizeof(int64_t) << " + "
+                  << 300 * sizeof(Metrics::Internals::VarianceNoLock<double>)
+                  << std::endl;
+    }
     {
         Metrics::Kurtosis<double, DummyMutex> dut;
         std::cout << "sizeof Kurtosis<double,DummyMutex>: " << sizeof dut
@@ -45,6 +101,29 @@ int main() {
         std::cout << "sizeof LinearRegression<double,DummyMutex>: " << sizeof dut
                   << std::endl;
     }
+    {
+        Metrics::Counter<> dut;
+        std::cout << "sizeof Counter: " << sizeof dut << std::endl;
+    }
+    {
+        Metrics::CountMinSketch dut(2048, 4);
+        std::cout << "sizeof CountMinSketch(2048, 4): " << sizeof dut << " + "
+                  << 2048 * 4 * 8 << std::endl;
+    }
+    {
+        Metrics::Covariance<> dut(16);
+        std::cout << "sizeof Covariance<>(16): " << sizeof dut << " + "
+                  << (16 + 16 + 16 * 17 / 2) * sizeof(double) << std::endl;
+    }
+    {
+        Metrics::HyperLogLog<> dut(14);
+        std::cout << "sizeof HyperLogLog<>(14): " << sizeof dut << " + "
+                  << (1 << 14) << " when dense" << std::endl;
+    }
+    {
+        Metrics::Meter<> dut;
+        std::cout << "sizeof Meter: " << sizeof dut << std::endl;
+    }
     {
         Metrics::SamplingReservoir<double> dut(10);
         std::cout << "sizeof SamplingReservoir<double>(10): " << sizeof dut
@@ -55,11 +134,51 @@ int main() {
         std::cout << "sizeof SamplingReservoir<double>(10000): " << sizeof dut
                   << std::endl;
     }
+    {
+        Metrics::SamplingReservoir<double, std::mutex,
+                                   Metrics::NarrowCodec<double>>
+            dut(10000);
+        std::cout << "sizeof SamplingReservoir<double,NarrowCodec>(10000): "
+                  << sizeof dut << " + " << 10000 * sizeof(float)
+                  << std::endl;
+    }
+    {
+        Metrics::SamplingReservoir<double, std::mutex,
+                                   Metrics::Log16Codec<double>>
+            dut(10000);
+        std::cout << "sizeof SamplingReservoir<double,Log16Codec>(10000): "
+                  << sizeof dut << " + " << 10000 * sizeof(uint16_t)
+                  << std::endl;
+    }
     {
         Metrics::SlidingWindowReservoir<double> dut(10000);
         std::cout << "sizeof SlidingWindowReservoir<double>(10000): "
                   << sizeof dut << std::endl;
     }
+    {
+        Metrics::TopK<> dut(100);
+        std::cout << "sizeof TopK<>(100): " << sizeof dut << std::endl;
+    }
+    {
+        Metrics::FixedSamplingReservoir<double, 1024> dut;
+        std::cout << "sizeof FixedSamplingReservoir<double,1024>: "
+                  << sizeof dut << std::endl;
+    }
+    {
+        Metrics::FixedSlidingWindowReservoir<float, 1024> dut;
+        std::cout << "sizeof FixedSlidingWindowReservoir<float,1024>: "
+                  << sizeof dut << std::endl;
+    }
+    {
+        Metrics::Histogram<Metrics::FixedSamplingReservoir<double, 1024>>
+            dut{Metrics::FixedCapacity{}, true, 21};
+        std::cout << "sizeof Histogram<FixedSamplingReservoir<double,1024>>: "
+                  << sizeof dut << std::endl;
+    }
+    {
+        Metrics::Timer<> dut(1000);
+        std::cout << "sizeof Timer<>(1000): " << sizeof dut << std::endl;
+    }
     {
         Metrics::Histogram<Metrics::SamplingReservoir<double>, double> dut{
             1000, true, 21};
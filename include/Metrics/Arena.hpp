@@ -0,0 +1,95 @@
+#ifndef METRICS_ARENA_HPP
+#define METRICS_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace Metrics {
+/** Monotonic arena on a buffer: allocating moves a pointer, deallocating
+ * does nothing, clear() releases all allocations at once. When the buffer is
+ * full, memory comes from the heap. Not thread safe: use an arena per
+ * reporting thread, e.g. cleared after each reporting cycle. */
+class Arena {
+  public:
+    /** buffer must outlive the arena */
+    Arena(void *buffer, size_t size) noexcept
+        : _begin(static_cast<char *>(buffer)), _end(_begin + size),
+          _current(_begin) {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t alignment) {
+        const uintptr_t current = reinterpret_cast<uintptr_t>(_current);
+        const uintptr_t aligned =
+            (current + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        if (aligned + size <= reinterpret_cast<uintptr_t>(_end)) {
+            _current = reinterpret_cast<char *>(aligned + size);
+            return reinterpret_cast<void *>(aligned);
+        }
+        _overflows++;
+        return ::operator new(size);
+    }
+
+    void deallocate(void *p) noexcept {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+        if (address < reinterpret_cast<uintptr_t>(_begin) ||
+            address >= reinterpret_cast<uintptr_t>(_end)) {
+            ::operator delete(p);
+        }
+    }
+
+    /** release all allocations in the buffer */
+    void clear() noexcept { _current = _begin; }
+
+    /** return no of bytes used in the buffer */
+    size_t used() const noexcept { return _current - _begin; }
+
+    /** return no of allocations which did not fit in the buffer */
+    size_t overflows() const noexcept { return _overflows; }
+
+  private:
+    char *const _begin;
+    char *const _end;
+    char *_current;
+    size_t _overflows = 0;
+};
+
+/** Standard allocator on an Arena, e.g. for Snapshot<double,
+ * ArenaAllocator<double>> */
+template <typename T> class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena) noexcept : _arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+        : _arena(other.arena()) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *p, size_t) noexcept { _arena->deallocate(p); }
+
+    Arena *arena() const noexcept { return _arena; }
+
+  private:
+    Arena *_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &lhs,
+                const ArenaAllocator<U> &rhs) noexcept {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &lhs,
+                const ArenaAllocator<U> &rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+} // namespace Metrics
+
+#endif
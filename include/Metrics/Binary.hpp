@@ -0,0 +1,233 @@
+#ifndef METRICS_BINARY_HPP
+#define METRICS_BINARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Metrics {
+/** Binary encoding of metric states, e.g. to merge the states of many
+ * processes. The encoding does not depend on the platform:
+ * - unsigned integers are LEB128 varints, signed integers are zigzag
+ *   encoded varints, so small counts take 1 byte
+ * - float and double are IEEE 754, little endian
+ * - strings are a varint length followed by the bytes
+ * A state is encoded by its serialize(BinaryWriter &) and decoded by
+ * deserialize(BinaryReader &) of the same type. Metrics::serialize() adds the
+ * version of the encoding. */
+constexpr uint8_t BINARY_VERSION = 1;
+
+class BinaryWriter {
+  public:
+    /** append to out */
+    explicit BinaryWriter(std::vector<uint8_t> &out) : _out(out) {}
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            _out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        _out.push_back(static_cast<uint8_t>(value));
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                            !std::is_signed<V>::value>::type
+    write(V value) {
+        writeVarint(value);
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                            std::is_signed<V>::value>::type
+    write(V value) {
+        const auto u = static_cast<uint64_t>(value);
+        writeVarint((u << 1) ^ (value < 0 ? ~uint64_t{0} : 0));
+    }
+
+    void write(double value) {
+        static_assert(sizeof(double) == 8, "double must be IEEE 754");
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeFixed(bits, 8);
+    }
+
+    void write(float value) {
+        static_assert(sizeof(float) == 4, "float must be IEEE 754");
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeFixed(bits, 4);
+    }
+
+    void write(const std::string &value) {
+        writeVarint(value.size());
+        _out.insert(_out.end(), value.begin(), value.end());
+    }
+
+  private:
+    void writeFixed(uint64_t bits, unsigned bytes) {
+        for (unsigned i = 0; i < bytes; i++) {
+            _out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t> &_out;
+};
+
+/** Reads values written by BinaryWriter. A read returns false when there is
+ * not enough data or the value does not fit, all further reads fail. */
+class BinaryReader {
+  public:
+    BinaryReader(const uint8_t *data, size_t size)
+        : _data(data), _end(data + size) {}
+
+    bool readVarint(uint64_t &value) {
+        uint64_t result = 0;
+        for (unsigned shift = 0; shift < 64 && _data != _end; shift += 7) {
+            const uint8_t byte = *_data++;
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                value = result;
+                return true;
+            }
+        }
+        return fail();
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                                !std::is_signed<V>::value,
+                            bool>::type
+    read(V &value) {
+        uint64_t u;
+        if (!readVarint(u) || u > std::numeric_limits<V>::max()) {
+            return fail();
+        }
+        value = static_cast<V>(u);
+        return true;
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                                std::is_signed<V>::value,
+                            bool>::type
+    read(V &value) {
+        uint64_t u;
+        if (!readVarint(u)) {
+            return false;
+        }
+        const auto decoded = static_cast<int64_t>(u >> 1) ^
+                             -static_cast<int64_t>(u & 1);
+        value = static_cast<V>(decoded);
+        if (static_cast<int64_t>(value) != decoded) {
+            return fail();
+        }
+        return true;
+    }
+
+    bool read(double &value) {
+        uint64_t bits;
+        if (!readFixed(bits, 8)) {
+            return false;
+        }
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    bool read(float &value) {
+        uint64_t bits;
+        if (!readFixed(bits, 4)) {
+            return false;
+        }
+        const auto bits32 = static_cast<uint32_t>(bits);
+        std::memcpy(&value, &bits32, sizeof(value));
+        return true;
+    }
+
+    bool read(std::string &value) {
+        uint64_t size;
+        if (!readVarint(size) || size > remaining()) {
+            return fail();
+        }
+        value.assign(reinterpret_cast<const char *>(_data), size);
+        _data += size;
+        return true;
+    }
+
+    /** read a count of elements which each take at least 1 byte, fails when
+     * there is not enough data left, e.g. to reserve memory safely */
+    bool readCount(size_t &count) {
+        uint64_t u;
+        if (!readVarint(u) || u > remaining()) {
+            return fail();
+        }
+        count = static_cast<size_t>(u);
+        return true;
+    }
+
+    /** return no of bytes not read yet */
+    size_t remaining() const noexcept { return _end - _data; }
+
+  private:
+    bool readFixed(uint64_t &bits, unsigned bytes) {
+        if (remaining() < bytes) {
+            return fail();
+        }
+        bits = 0;
+        for (unsigned i = 0; i < bytes; i++) {
+            bits |= static_cast<uint64_t>(_data[i]) << (8 * i);
+        }
+        _data += bytes;
+        return true;
+    }
+
+    bool fail() noexcept {
+        _data = _end;
+        return false;
+    }
+
+    const uint8_t *_data;
+    const uint8_t *_end;
+};
+
+/** append the encoding of state to out, preceded by the version */
+template <typename S>
+void serialize(const S &state, std::vector<uint8_t> &out) {
+    BinaryWriter writer(out);
+    writer.write(BINARY_VERSION);
+    state.serialize(writer);
+}
+
+/** return the encoding of state, preceded by the version */
+template <typename S> std::vector<uint8_t> serialize(const S &state) {
+    std::vector<uint8_t> result;
+    serialize(state, result);
+    return result;
+}
+
+/** decode state from data written by serialize() of the same type. Returns
+ * false when the data is truncated, invalid or of another version, state is
+ * unchanged then. Also returns false when a valid state is followed by
+ * trailing bytes. */
+template <typename S>
+bool deserialize(S &state, const uint8_t *data, size_t size) {
+    BinaryReader reader(data, size);
+    uint8_t version;
+    if (!reader.read(version) || version != BINARY_VERSION) {
+        return false;
+    }
+    return state.deserialize(reader) && reader.remaining() == 0;
+}
+
+template <typename S>
+bool deserialize(S &state, const std::vector<uint8_t> &data) {
+    return deserialize(state, data.data(), data.size());
+}
+
+} // namespace Metrics
+
+#endif
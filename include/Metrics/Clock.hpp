@@ -0,0 +1,113 @@
+#ifndef METRICS_CLOCK_HPP
+#define METRICS_CLOCK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define METRICS_HAS_TSC 1
+#endif
+
+namespace Metrics {
+/** std::chrono compatible monotonic clock with a low resolution (typically
+ * 1..4 ms), but cheaper to read than std::chrono::steady_clock. Falls back to
+ * steady_clock when CLOCK_MONOTONIC_COARSE is not available. */
+struct CoarseClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<CoarseClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept {
+#ifdef CLOCK_MONOTONIC_COARSE
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return time_point(duration(static_cast<rep>(ts.tv_sec) * 1000000000 +
+                                   ts.tv_nsec));
+#else
+        return time_point(std::chrono::duration_cast<duration>(
+            std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+    }
+};
+
+/** std::chrono compatible clock reading the time stamp counter of x86 CPUs,
+ * converted to nanoseconds with a calibration against steady_clock on first
+ * use (takes about 10 ms). Only monotonic on CPUs with an invariant TSC.
+ * Falls back to steady_clock on other architectures. */
+struct TscClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<TscClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept {
+#ifdef METRICS_HAS_TSC
+        const Calibration &c = calibration();
+        return time_point(duration(
+            static_cast<rep>(static_cast<double>(__rdtsc() - c.tsc0) *
+                             c.ns_per_tick)));
+#else
+        return time_point(std::chrono::duration_cast<duration>(
+            std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+    }
+
+  private:
+#ifdef METRICS_HAS_TSC
+    struct Calibration {
+        uint64_t tsc0;
+        double ns_per_tick;
+    };
+
+    static const Calibration &calibration() noexcept {
+        static const Calibration c = calibrate();
+        return c;
+    }
+
+    /** steady_clock time and the TSC at that time */
+    struct Sample {
+        std::chrono::steady_clock::time_point time;
+        uint64_t tsc;
+    };
+
+    /** read steady_clock between two TSC reads, several times, and keep the
+     * read with the fewest ticks around it: a read which was preempted or
+     * interrupted is not used */
+    static Sample sample() noexcept {
+        constexpr int SAMPLES = 9;
+        Sample result{};
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < SAMPLES; i++) {
+            const uint64_t before = __rdtsc();
+            const auto time = std::chrono::steady_clock::now();
+            const uint64_t after = __rdtsc();
+            if (after - before < best) {
+                best = after - before;
+                result = {time, before + (after - before) / 2};
+            }
+        }
+        return result;
+    }
+
+    static Calibration calibrate() noexcept {
+        const Sample start = sample();
+        while (std::chrono::steady_clock::now() - start.time <
+               std::chrono::milliseconds(10)) {
+        }
+        const Sample stop = sample();
+
+        const double ns =
+            std::chrono::duration<double, std::nano>(stop.time - start.time)
+                .count();
+        return {start.tsc, ns / static_cast<double>(stop.tsc - start.tsc)};
+    }
+#endif
+};
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef METRICS_CODEC_HPP
+#define METRICS_CODEC_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Metrics {
+/** Codecs convert a value of type T to the type stored in a reservoir
+ * (Stored) and back, to reduce the memory of large reservoirs. A codec has:
+ * - using Stored = ...;
+ * - Stored encode(T value) const;
+ * - T decode(Stored code) const; */
+
+/** store values as is */
+template <typename T = double> struct IdentityCodec {
+    using Stored = T;
+    Stored encode(T value) const noexcept { return value; }
+    T decode(Stored code) const noexcept { return code; }
+};
+
+/** store values in a smaller floating point type, e.g. double as float */
+template <typename T = double, typename S = float> struct NarrowCodec {
+    using Stored = S;
+    Stored encode(T value) const noexcept { return static_cast<S>(value); }
+    T decode(Stored code) const noexcept { return static_cast<T>(code); }
+};
+
+/** store values as an integer multiple of a fixed resolution, e.g. 1 us
+ * durations in an int32_t. Values outside the range of S are clamped. */
+template <typename T = double, typename S = int32_t> class FixedPointCodec {
+  public:
+    using Stored = S;
+
+    explicit FixedPointCodec(T resolution = 0.001) : _resolution(resolution) {}
+
+    Stored encode(T value) const noexcept {
+        const T scaled = std::round(value / _resolution);
+        if (!(scaled > std::numeric_limits<S>::min())) {
+            // also NAN
+            return std::numeric_limits<S>::min();
+        }
+        if (scaled >= std::numeric_limits<S>::max()) {
+            return std::numeric_limits<S>::max();
+        }
+        return static_cast<S>(scaled);
+    }
+
+    T decode(Stored code) const noexcept { return code * _resolution; }
+
+  private:
+    T _resolution;
+};
+
+/** store values in 16 bits with a constant relative precision: a sign bit and
+ * 15 bits for the logarithm of the magnitude, between min and max. Magnitudes
+ * below min are stored as 0, above max as max. With the default range of
+ * 1e-9..1e9, the relative error is below 0.07 %. */
+template <typename T = double> class Log16Codec {
+  public:
+    using Stored = uint16_t;
+
+    explicit Log16Codec(T min = 1e-9, T max = 1e9)
+        : _logMin(std::log(min)),
+          _step((std::log(max) - std::log(min)) / (MAX_INDEX - 1)) {}
+
+    Stored encode(T value) const noexcept {
+        const Stored sign = (value < 0) ? SIGN_BIT : 0;
+        const T index = std::round((std::log(std::fabs(value)) - _logMin) /
+                                   _step) +
+                        1;
+        if (!(index >= 1)) {
+            // also 0 and NAN
+            return 0;
+        }
+        if (index >= MAX_INDEX) {
+            return sign | MAX_INDEX;
+        }
+        return sign | static_cast<Stored>(index);
+    }
+
+    T decode(Stored code) const noexcept {
+        const Stored index = code & MAX_INDEX;
+        if (index == 0) {
+            return 0;
+        }
+        const T magnitude = std::exp(_logMin + (index - 1) * _step);
+        return (code & SIGN_BIT) ? -magnitude : magnitude;
+    }
+
+  private:
+    static constexpr Stored SIGN_BIT = 0x8000;
+    static constexpr Stored MAX_INDEX = 0x7fff;
+
+    T _logMin;
+    T _step; /** log of the ratio between 2 successive codes */
+};
+
+template <typename T>
+constexpr typename Log16Codec<T>::Stored Log16Codec<T>::SIGN_BIT;
+template <typename T>
+constexpr typename Log16Codec<T>::Stored Log16Codec<T>::MAX_INDEX;
+
+namespace Internals {
+/** pointer to the values of a reservoir, nullptr when the values are stored
+ * encoded */
+template <typename T, typename S> struct ValuesOf {
+    static const T *data(const S *) noexcept { return nullptr; }
+};
+
+template <typename T> struct ValuesOf<T, T> {
+    static const T *data(const T *stored) noexcept { return stored; }
+};
+
+/** decode a range of stored values and append them to out */
+template <typename T, typename A, typename E, typename It>
+void decode(const E &codec, It begin, It end, std::vector<T, A> &out) {
+    out.reserve(out.size() + (end - begin));
+    for (auto it = begin; it != end; ++it) {
+        out.push_back(codec.decode(*it));
+    }
+}
+
+template <typename T, typename A, typename It>
+void decode(const IdentityCodec<T> &, It begin, It end,
+            std::vector<T, A> &out) {
+    out.insert(out.end(), begin, end);
+}
+
+} // namespace Internals
+} // namespace Metrics
+
+#endif
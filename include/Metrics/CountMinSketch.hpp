@@ -0,0 +1,191 @@
+#ifndef METRICS_COUNTMINSKETCH_HPP
+#define METRICS_COUNTMINSKETCH_HPP
+
+/* Count-Min sketch in C++
+   Cormode and Muthukrishnan, An Improved Data Stream Summary: The Count-Min
+   Sketch and its Applications
+   http://dimacs.rutgers.edu/~graham/pubs/papers/cm-full.pdf
+   Row hashes: Kirsch and Mitzenmacher, Less Hashing, Same Performance
+*/
+
+#include "Hash.hpp"
+#include "IMetric.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Metrics {
+/** Estimate the no of occurrences of any key in fixed memory. The estimate
+ * never undercounts (see below) and overcounts by at most e * count() / width
+ * with probability 1 - exp(-depth).
+ *
+ * Cells are atomic, updating is lock-free. Optional conservative update only
+ * raises the cells of a key to its current minimum + n, which reduces the
+ * overcount a lot for skewed streams. Concurrent conservative updates of the
+ * same key can however lose increments, so only enable it when a single
+ * thread updates the sketch. */
+class CountMinSketch : public IMetric {
+  public:
+    static constexpr unsigned MAX_DEPTH = 16;
+
+    /** width = no of cells per row, rounded up to a power of 2
+     * depth = no of rows, 1..MAX_DEPTH
+     * conservative = use conservative update, not safe for concurrent use */
+    explicit CountMinSketch(uint32_t width = 2048, unsigned depth = 4,
+                            bool conservative = false)
+        : _mask(roundUp(width) - 1),
+          _depth(clampDepth(depth)),
+          _conservative(conservative),
+          _cells(new std::atomic<uint64_t>[noCells()]) {
+        reset();
+    }
+    ~CountMinSketch() override = default;
+
+    void reset() noexcept override {
+        for (uint64_t i = 0; i < noCells(); i++) {
+            _cells[i].store(0, std::memory_order_relaxed);
+        }
+        _total.store(0, std::memory_order_relaxed);
+    }
+
+    /** count n occurrences of key, hashed with std::hash */
+    template <typename K> void update(const K &key, uint64_t n = 1) noexcept {
+        updateHash(Internals::mix64(std::hash<K>{}(key)), n);
+    }
+
+    /** count n occurrences of a key by its well mixed 64 bit hash */
+    void updateHash(uint64_t hash, uint64_t n = 1) noexcept {
+        uint64_t index[MAX_DEPTH];
+        indices(hash, index);
+        _total.fetch_add(n, std::memory_order_relaxed);
+
+        if (!_conservative) {
+            for (unsigned row = 0; row < _depth; row++) {
+                _cells[index[row]].fetch_add(n, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        const uint64_t target = minimum(index) + n;
+        for (unsigned row = 0; row < _depth; row++) {
+            auto &cell = _cells[index[row]];
+            uint64_t current = cell.load(std::memory_order_relaxed);
+            while (current < target &&
+                   !cell.compare_exchange_weak(current, target,
+                                               std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    /** add the counts of another sketch, see merge(). Throws
+     * std::invalid_argument when the width or depth differ. */
+    CountMinSketch &operator+=(const CountMinSketch &rhs) {
+        if (!merge(rhs)) {
+            throw std::invalid_argument("sketch has a different width/depth");
+        }
+        return *this;
+    }
+
+    /** add the counts of another sketch with the same width and depth.
+     * Returns false without merging when the width or depth differ. */
+    bool merge(const CountMinSketch &rhs) noexcept {
+        if (rhs._mask != _mask || rhs._depth != _depth) {
+            return false;
+        }
+        // a+=a reads each cell before doubling it, so needs no special case
+        for (uint64_t i = 0; i < noCells(); i++) {
+            _cells[i].fetch_add(rhs._cells[i].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+        }
+        _total.fetch_add(rhs._total.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+        return true;
+    }
+
+    /** return no of cells per row */
+    uint64_t width() const noexcept { return _mask + 1; }
+
+    /** return no of rows */
+    unsigned depth() const noexcept { return _depth; }
+
+    /** return no of occurrences of all keys */
+    uint64_t count() const noexcept {
+        return _total.load(std::memory_order_relaxed);
+    }
+
+    /** return estimated no of occurrences of key */
+    template <typename K> uint64_t estimate(const K &key) const noexcept {
+        return estimateHash(Internals::mix64(std::hash<K>{}(key)));
+    }
+
+    /** return estimated no of occurrences of a key by its hash */
+    uint64_t estimateHash(uint64_t hash) const noexcept {
+        uint64_t index[MAX_DEPTH];
+        indices(hash, index);
+        return minimum(index);
+    }
+
+    std::string toString(int /* precision */ = -1) const noexcept override {
+        return "count(" + std::to_string(count()) + ") width(" +
+               std::to_string(width()) + ") depth(" + std::to_string(depth()) +
+               ")";
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        visitor.field("count", static_cast<int64_t>(count()));
+        visitor.field("width", static_cast<int64_t>(width()));
+        visitor.field("depth", static_cast<int64_t>(depth()));
+    }
+
+  private:
+    static unsigned clampDepth(unsigned depth) noexcept {
+        if (depth > MAX_DEPTH) {
+            return MAX_DEPTH;
+        }
+        return (depth < 1) ? 1 : depth;
+    }
+
+    static uint64_t roundUp(uint32_t width) noexcept {
+        uint64_t result = 1;
+        while (result < width) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    uint64_t noCells() const noexcept { return (_mask + 1) * _depth; }
+
+    /** cell index in each row: h1 + row * h2, computed for all rows at once
+     * without dependencies between rows so the compiler can vectorize it */
+    void indices(uint64_t hash, uint64_t (&index)[MAX_DEPTH]) const noexcept {
+        const uint64_t h1 = hash & 0xffffffffULL;
+        const uint64_t h2 = (hash >> 32) | 1;
+        for (unsigned row = 0; row < MAX_DEPTH; row++) {
+            index[row] = ((h1 + row * h2) & _mask) + row * (_mask + 1);
+        }
+    }
+
+    uint64_t minimum(const uint64_t (&index)[MAX_DEPTH]) const noexcept {
+        uint64_t result = std::numeric_limits<uint64_t>::max();
+        for (unsigned row = 0; row < _depth; row++) {
+            result = std::min(
+                result, _cells[index[row]].load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+
+    const uint64_t _mask;
+    const unsigned _depth;
+    const bool _conservative;
+    std::unique_ptr<std::atomic<uint64_t>[]> _cells;
+    std::atomic<uint64_t> _total{0};
+};
+
+} // namespace Metrics
+
+#endif
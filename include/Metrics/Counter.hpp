@@ -0,0 +1,38 @@
+#ifndef METRICS_COUNTER_HPP
+#define METRICS_COUNTER_HPP
+
+#include "IMetric.hpp"
+#include "StripedCounter.hpp"
+#include <cstdint>
+#include <string>
+
+namespace Metrics {
+/** Count events from many threads. Incrementing is a single relaxed atomic
+ * add on a cell of the calling thread (I = Internals::ThreadCellIndex) or CPU
+ * (I = Internals::CpuCellIndex), reading sums all cells. */
+template <typename I = Internals::ThreadCellIndex>
+class Counter : public IMetric {
+  public:
+    void reset() noexcept override { _count.reset(); }
+
+    void inc(int64_t n = 1) noexcept { _count.add(n); }
+    void dec(int64_t n = 1) noexcept { _count.add(-n); }
+
+    /** return current count, concurrent updates may or may not be included */
+    int64_t count() const noexcept { return _count.sum(); }
+
+    std::string toString(int /* precision */ = -1) const noexcept override {
+        return std::to_string(count());
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        visitor.field("count", count());
+    }
+
+  private:
+    Internals::StripedCounter<16, I> _count{};
+};
+
+} // namespace Metrics
+
+#endif
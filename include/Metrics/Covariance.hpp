@@ -0,0 +1,364 @@
+#ifndef METRICS_COVARIANCE_HPP
+#define METRICS_COVARIANCE_HPP
+
+#include "Binary.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+namespace Internals {
+/** Calculate the covariance matrix of k signals incrementally using the
+ * multivariate version of Welford's algorithm
+ * https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Covariance
+ * The co-moments are stored as a packed upper triangular matrix, row by row,
+ * so the rank-1 update of a row is a contiguous loop the compiler can
+ * vectorize. */
+template <typename T = double> class CovarianceNoLock {
+  public:
+    /** k = no of signals */
+    explicit CovarianceNoLock(unsigned k)
+        : _mean(k), _delta(k), _comoment(k * (k + 1) / 2) {}
+
+    void reset() noexcept {
+        _count = 0;
+        std::fill(_mean.begin(), _mean.end(), T{});
+        std::fill(_comoment.begin(), _comoment.end(), T{});
+    }
+
+    /** add a sample of all k signals */
+    void update(const T *values) noexcept {
+        const unsigned k = dimensions();
+        _count++;
+        const T n = static_cast<T>(_count);
+        const T scale = (n - 1) / n;
+
+        // delta to the old mean, mean is updated afterwards
+        for (unsigned i = 0; i < k; i++) {
+            _delta[i] = values[i] - _mean[i];
+            _mean[i] += _delta[i] / n;
+        }
+
+        // C += (n-1)/n * delta * delta^T, upper triangle only
+        T *row = _comoment.data();
+        for (unsigned i = 0; i < k; i++) {
+            const T a = scale * _delta[i];
+            const T *delta = _delta.data() + i;
+            const unsigned length = k - i;
+            for (unsigned j = 0; j < length; j++) {
+                row[j] += a * delta[j];
+            }
+            row += length;
+        }
+    }
+
+    /** add a sample of all k signals, a sample with another size is
+     * ignored */
+    void update(const std::vector<T> &values) noexcept {
+        if (values.size() != dimensions()) {
+            return;
+        }
+        update(values.data());
+    }
+
+    /** merge the samples of another matrix with the same no of signals,
+     * other matrices are ignored */
+    CovarianceNoLock &operator+=(const CovarianceNoLock &rhs) noexcept {
+        if (rhs.dimensions() != dimensions() || rhs._count == 0) {
+            return *this;
+        }
+        if (_count == 0) {
+            *this = rhs;
+            return *this;
+        }
+
+        const unsigned k = dimensions();
+        const T count_both = static_cast<T>(_count + rhs._count);
+        const T scale = static_cast<T>(_count) * rhs._count / count_both;
+        for (unsigned i = 0; i < k; i++) {
+            _delta[i] = rhs._mean[i] - _mean[i];
+            _mean[i] += _delta[i] * rhs._count / count_both;
+        }
+
+        T *row = _comoment.data();
+        const T *rhs_row = rhs._comoment.data();
+        for (unsigned i = 0; i < k; i++) {
+            const T a = scale * _delta[i];
+            const T *delta = _delta.data() + i;
+            const unsigned length = k - i;
+            for (unsigned j = 0; j < length; j++) {
+                row[j] += rhs_row[j] + a * delta[j];
+            }
+            row += length;
+            rhs_row += length;
+        }
+        _count += rhs._count;
+        return *this;
+    }
+
+    friend inline CovarianceNoLock
+    operator+(const CovarianceNoLock &lhs,
+              const CovarianceNoLock &rhs) noexcept {
+        CovarianceNoLock result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of signals */
+    unsigned dimensions() const noexcept { return _mean.size(); }
+
+    /** return no of samples */
+    int64_t count() const noexcept { return _count; }
+
+    /** return mean of signal i or NAN when there are no samples */
+    T mean(unsigned i) const noexcept {
+        return (_count == 0) ? NAN : _mean[i];
+    }
+
+    /** co-moment: sum of (x_i-x_i_mean)*(x_j-x_j_mean) */
+    T comoment(unsigned i, unsigned j) const noexcept {
+        if (i > j) {
+            std::swap(i, j);
+        }
+        return _comoment[i * dimensions() - i * (i - 1) / 2 + j - i];
+    }
+
+    /** return covariance of a population or NAN when there are no samples */
+    T covariance(unsigned i, unsigned j) const noexcept {
+        return (_count < 1) ? NAN : comoment(i, j) / _count;
+    }
+
+    /** covariance of a sample from a population */
+    T sample_covariance(unsigned i, unsigned j) const noexcept {
+        return (_count < 2) ? NAN : comoment(i, j) / (_count - 1);
+    }
+
+    /** return variance of signal i of a population */
+    T variance(unsigned i) const noexcept { return covariance(i, i); }
+
+    /** standard deviation of signal i of a population */
+    T stddev(unsigned i) const noexcept { return sqrt(variance(i)); }
+
+    /** correlation of signals i and j, or NAN when less than 2 samples */
+    T correlation(unsigned i, unsigned j) const noexcept {
+        return (_count < 2) ? NAN
+                            : comoment(i, j) /
+                                  sqrt(comoment(i, i) * comoment(j, j));
+    }
+
+    std::string toString(int precision = -1) const noexcept {
+        Internals::Formatter os(precision);
+        os << "count(" << count() << ") mean(";
+        for (unsigned i = 0; i < dimensions(); i++) {
+            os << (i == 0 ? "" : ", ") << mean(i);
+        }
+        os << ") stddev(";
+        for (unsigned i = 0; i < dimensions(); i++) {
+            os << (i == 0 ? "" : ", ") << stddev(i);
+        }
+        os << ")";
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        for (unsigned i = 0; i < dimensions(); i++) {
+            visitor.field("mean", i, static_cast<double>(mean(i)));
+        }
+        for (unsigned i = 0; i < dimensions(); i++) {
+            visitor.field("stddev", i, static_cast<double>(stddev(i)));
+        }
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.write(dimensions());
+        out.write(_count);
+        for (T mean : _mean) {
+            out.write(mean);
+        }
+        for (T comoment : _comoment) {
+            out.write(comoment);
+        }
+    }
+
+    /** decode a state written by serialize(), the no of signals is taken
+     * from the data. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) {
+        size_t k;
+        int64_t count;
+        // each mean and comoment takes at least a byte
+        if (!in.readCount(k) || !in.read(count) ||
+            static_cast<uint64_t>(k) * (k + 3) / 2 > in.remaining()) {
+            return false;
+        }
+        CovarianceNoLock result(k);
+        result._count = count;
+        for (T &mean : result._mean) {
+            if (!in.read(mean)) {
+                return false;
+            }
+        }
+        for (T &comoment : result._comoment) {
+            if (!in.read(comoment)) {
+                return false;
+            }
+        }
+        *this = std::move(result);
+        return true;
+    }
+
+  private:
+    int64_t _count = 0;
+    std::vector<T> _mean;
+    std::vector<T> _delta; /** scratch buffer, avoids an allocation */
+    std::vector<T> _comoment;
+};
+
+} // namespace Internals
+
+/** Calculate the covariance and correlation matrix of k signals
+ * incrementally. A sample of all signals is added with a single lock. */
+template <typename T = double, typename M = std::mutex>
+class Covariance : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    /** k = no of signals */
+    explicit Covariance(unsigned k) : _state(k) {}
+    ~Covariance() override = default;
+
+    Covariance(const Covariance &other) noexcept : _state(0) {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        _state = other._state;
+    }
+
+    Covariance &operator=(const Covariance &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        _state = other._state;
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+    }
+
+    /** add a sample of all k signals */
+    void update(const T *values) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(values);
+    }
+
+    /** add a sample of all k signals, a sample with another size is
+     * ignored */
+    void update(const std::vector<T> &values) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(values);
+    }
+
+    Covariance &operator+=(const Covariance &rhs) noexcept {
+        // In the very unlikely case that 2 threads simultaneously do a+=b and
+        // b+=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{rhs._mutex, std::defer_lock};
+        if (&rhs == this) {
+            // second lock would deadlock when doing a+=a
+            lock1.lock();
+        } else {
+            std::lock(lock1, lock2);
+        }
+        _state += rhs._state;
+        return *this;
+    }
+
+    friend inline Covariance operator+(const Covariance &lhs,
+                                       const Covariance &rhs) noexcept {
+        Covariance result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of signals */
+    unsigned dimensions() const noexcept { return _state.dimensions(); }
+
+    /** return no of samples */
+    int64_t count() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return mean of signal i or NAN when there are no samples */
+    T mean(unsigned i) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.mean(i);
+    }
+
+    /** return covariance of a population or NAN when there are no samples */
+    T covariance(unsigned i, unsigned j) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.covariance(i, j);
+    }
+
+    /** covariance of a sample from a population */
+    T sample_covariance(unsigned i, unsigned j) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.sample_covariance(i, j);
+    }
+
+    /** return variance of signal i of a population */
+    T variance(unsigned i) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.variance(i);
+    }
+
+    /** standard deviation of signal i of a population */
+    T stddev(unsigned i) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.stddev(i);
+    }
+
+    /** correlation of signals i and j, or NAN when less than 2 samples */
+    T correlation(unsigned i, unsigned j) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.correlation(i, j);
+    }
+
+    /** return copy of the state, to read many values with a single lock */
+    Internals::CovarianceNoLock<T> state() const noexcept {
+        lock_guard lock(_mutex);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
+    }
+
+  private:
+    Internals::CovarianceNoLock<T> _state;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef METRICS_EWMAVARIANCE_HPP
+#define METRICS_EWMAVARIANCE_HPP
+
+#include "Binary.hpp"
+#include "Clock.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Metrics {
+namespace Internals {
+/** Calculate exponentially weighted moving mean and variance incrementally
+ * https://fanf2.user.srcf.net/hermes/doc/antiforgery/stats.pdf
+ */
+template <typename T = double> class EwmaVarianceNoLock {
+  public:
+    /** alpha = weight of a new sample, in ]0..1] */
+    explicit EwmaVarianceNoLock(T alpha = 0.1) : _alpha(alpha) {}
+
+    void reset() noexcept {
+        _count = {};
+        _mean = {};
+        _variance = {};
+    }
+
+    void update(T value) noexcept { update(value, _alpha); }
+
+    /** update with a specific weight of the new sample, e.g. alpha_for() for
+     * samples which are not equally spaced in time */
+    void update(T value, T alpha) noexcept {
+        if (_count == 0) {
+            _mean = value;
+        } else {
+            const T delta = value - _mean;
+            const T increment = alpha * delta;
+            _mean += increment;
+            _variance = (1 - alpha) * (_variance + delta * increment);
+        }
+        _count++;
+    }
+
+    /** update with n samples with a given mean and (population) variance,
+     * together weighing as one sample with weight alpha, e.g. samples taken
+     * at the same time */
+    void update(int64_t n, T mean, T variance, T alpha) noexcept {
+        if (_count == 0) {
+            _mean = mean;
+            _variance = variance;
+        } else {
+            const T delta = mean - _mean;
+            const T increment = alpha * delta;
+            _mean += increment;
+            _variance = (1 - alpha) * (_variance + delta * increment) +
+                        alpha * variance;
+        }
+        _count += n;
+    }
+
+    /** weight of a sample taken <elapsed> after the previous one, for a
+     * time constant tau (same unit as elapsed) */
+    static T alpha_for(T elapsed, T tau) noexcept {
+        return 1 - std::exp(-elapsed / tau);
+    }
+
+    /** return weight of a new sample */
+    T alpha() const noexcept { return _alpha; }
+
+    /** return no of measurements */
+    int64_t count() const noexcept { return _count; }
+
+    /** return moving mean or NAN when there are no measurements */
+    T mean() const noexcept { return (_count == 0) ? NAN : _mean; }
+
+    /** return moving variance or NAN when there are no measurements */
+    T variance() const noexcept { return (_count == 0) ? NAN : _variance; }
+
+    /** moving standard deviation */
+    T stddev() const noexcept { return sqrt(variance()); }
+
+    std::string toString(int precision = -1) const noexcept {
+        Internals::Formatter os(precision);
+        os << "count(" << count() << ") mean(" << mean() << ") stddev("
+           << stddev() << ")";
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("stddev", static_cast<double>(stddev()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.write(_alpha);
+        out.write(_count);
+        out.write(_mean);
+        out.write(_variance);
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        EwmaVarianceNoLock result(*this);
+        if (!in.read(result._alpha) || !in.read(result._count) ||
+            !in.read(result._mean) || !in.read(result._variance)) {
+            return false;
+        }
+        *this = result;
+        return true;
+    }
+
+  private:
+    T _alpha;
+    int64_t _count = 0;
+    T _mean{};
+    T _variance{};
+};
+
+} // namespace Internals
+
+/** Calculate exponentially weighted moving mean and variance incrementally.
+ * The weight of a new sample is either fixed (alpha), or depends on the time
+ * since the previous sample (tau = time constant). C is a std::chrono
+ * compatible clock, only read when a time constant is used. */
+template <typename T = double, typename M = std::mutex,
+          typename C = CoarseClock>
+class EwmaVariance : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    /** alpha = weight of a new sample, in ]0..1] */
+    explicit EwmaVariance(T alpha = 0.1) : _state(alpha) {}
+
+    /** tau = time constant, a sample has weight 1/e after tau */
+    explicit EwmaVariance(std::chrono::duration<double> tau)
+        : _state(1), _tau(tau.count()) {}
+
+    ~EwmaVariance() override = default;
+
+    EwmaVariance(const EwmaVariance &other) noexcept : _state(1) {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        copyFrom(other);
+    }
+
+    EwmaVariance &operator=(const EwmaVariance &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        copyFrom(other);
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+        _tickCount = 0;
+    }
+
+    void update(T value) noexcept {
+        if (_tau <= 0) {
+            lock_guard lock(_mutex);
+            _state.update(value);
+            return;
+        }
+
+        lock_guard lock(_mutex);
+        const auto now = C::now();
+        if (_tickCount == 0 || now != _last) {
+            const T elapsed =
+                std::chrono::duration<double>(now - _last).count();
+            _last = now;
+            _tickStart = _state;
+            _tickAlpha = _state.alpha_for(elapsed, _tau);
+            _tickCount = 0;
+            _tickMean = 0;
+            _tickM2 = 0;
+        }
+
+        // samples within one clock tick are averaged, and weigh together as
+        // one sample taken at that tick
+        _tickCount++;
+        const T delta = value - _tickMean;
+        _tickMean += delta / _tickCount;
+        _tickM2 += delta * (value - _tickMean);
+        _state = _tickStart;
+        _state.update(_tickCount, _tickMean, _tickM2 / _tickCount, _tickAlpha);
+    }
+
+    /** return no of measurements */
+    int64_t count() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return moving mean or NAN when there are no measurements */
+    T mean() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.mean();
+    }
+
+    /** return moving variance or NAN when there are no measurements */
+    T variance() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.variance();
+    }
+
+    /** moving standard deviation */
+    T stddev() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.stddev();
+    }
+
+    /** return copy of the state, to read many values with a single lock */
+    Internals::EwmaVarianceNoLock<T> state() const noexcept {
+        lock_guard lock(_mutex);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
+    }
+
+  private:
+    void copyFrom(const EwmaVariance &other) noexcept {
+        _state = other._state;
+        _tau = other._tau;
+        _last = other._last;
+        _tickStart = other._tickStart;
+        _tickAlpha = other._tickAlpha;
+        _tickCount = other._tickCount;
+        _tickMean = other._tickMean;
+        _tickM2 = other._tickM2;
+    }
+
+    Internals::EwmaVarianceNoLock<T> _state;
+    T _tau{};
+    typename C::time_point _last{};
+    // samples of the tick of _last, only used with a time constant
+    Internals::EwmaVarianceNoLock<T> _tickStart{1};
+    T _tickAlpha{};
+    int64_t _tickCount = 0;
+    T _tickMean{};
+    T _tickM2{};
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
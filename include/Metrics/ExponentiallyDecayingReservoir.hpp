@@ -0,0 +1,239 @@
+#ifndef METRICS_EXPONENTIALLYDECAYINGRESERVOIR_HPP
+#define METRICS_EXPONENTIALLYDECAYINGRESERVOIR_HPP
+
+/* Forward decay sampling in C++
+   Cormode et al., Forward Decay: A Practical Time Decay Model for Streaming
+   Systems - http://dimacs.rutgers.edu/~graham/pubs/papers/fwddecay.pdf
+*/
+
+#include "IReservoir.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+/** create sample reservoir on a stream of data, biased towards recent data
+ * using exponential forward decay. C is a std::chrono compatible clock. A is
+ * the allocator of the stored values and the snapshots. */
+template <typename T = double, typename M = std::mutex,
+          typename C = std::chrono::steady_clock,
+          typename A = std::allocator<T>>
+class ExponentiallyDecayingReservoir : public IReservoir<T, A> {
+  public:
+    /** n = reservoir size, alpha = decay factor per second. The default alpha
+     * makes the reservoir represent roughly the last 5 minutes. */
+    explicit ExponentiallyDecayingReservoir(unsigned n, double alpha = 0.015,
+                                            const A &alloc = A())
+        : _alpha(alpha), _rescaleInterval(rescaleInterval(alpha)),
+          _reservoir(n, T{}, alloc), _heap(EntryAllocator(alloc)) {
+        _heap.reserve(n);
+        reinitialize(C::now());
+    }
+
+    void reset() noexcept override {
+        const auto now = C::now();
+        const std::lock_guard<M> lock(_mutex);
+        reinitialize(now);
+    }
+
+    /** Update reservoir, the lowest priority sample is replaced when full */
+    void update(T value) noexcept override { update(value, 1.0); }
+
+    /** Update reservoir with a weighted value: a value with weight w is w
+     * times more likely to be sampled than a value with weight 1 at the same
+     * time. Values with weight <= 0 are ignored. */
+    void update(T value, double weight) noexcept {
+        if (!(weight > 0)) {
+            return;
+        }
+        const auto now = C::now();
+        const std::lock_guard<M> lock(_mutex);
+        if (now >= _nextRescale) {
+            rescale(now);
+        }
+
+        const double priority =
+            weight * std::exp(_alpha * seconds(now - _start)) / getRandom();
+        auto n = static_cast<unsigned>(_reservoir.size());
+        if (_heap.size() < n) {
+            auto slot = static_cast<unsigned>(_heap.size());
+            _reservoir[slot] = value;
+            _heap.push_back({priority, slot});
+            std::push_heap(_heap.begin(), _heap.end(), compare);
+        } else if (n > 0 && priority > _heap.front().priority) {
+            std::pop_heap(_heap.begin(), _heap.end(), compare);
+            _reservoir[_heap.back().slot] = value;
+            _heap.back().priority = priority;
+            std::push_heap(_heap.begin(), _heap.end(), compare);
+        }
+        _count++;
+    }
+
+    unsigned count() const noexcept { return _count; }
+    unsigned size() const noexcept override { return _reservoir.size(); }
+    unsigned samples() const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        return _heap.size();
+    }
+    const T *data() const noexcept override { return _reservoir.data(); }
+
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(_reservoir.get_allocator());
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        out.assign(_reservoir.cbegin(), _reservoir.cbegin() + _heap.size());
+    }
+
+    /** append the no of updates and the samples to out, with priorities
+     * relative to now */
+    void serialize(BinaryWriter &out) const override {
+        const auto now = C::now();
+        const std::lock_guard<M> lock(_mutex);
+        const double factor = std::exp(-_alpha * seconds(now - _start));
+        out.write(_count);
+        out.write(_heap.size());
+        for (const auto &entry : _heap) {
+            out.write(_reservoir[entry.slot]);
+            out.write(entry.priority * factor);
+        }
+    }
+
+    /** replace the samples by samples written by serialize() of a reservoir
+     * with the same alpha. When there are more samples than fit, the samples
+     * with the highest priority are kept. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) override {
+        unsigned count;
+        size_t samples;
+        if (!in.read(count) || !in.readCount(samples) || samples > count) {
+            return false;
+        }
+        std::vector<std::pair<double, T>> decoded(samples);
+        for (auto &x : decoded) {
+            if (!in.read(x.second) || !in.read(x.first) ||
+                !(x.first > 0 && std::isfinite(x.first))) {
+                return false;
+            }
+        }
+        const size_t n = size();
+        if (n == 0) {
+            // an empty reservoir keeps only the count
+            decoded.clear();
+        } else if (decoded.size() > n) {
+            std::nth_element(decoded.begin(), decoded.begin() + n - 1,
+                             decoded.end(),
+                             [](const std::pair<double, T> &lhs,
+                                const std::pair<double, T> &rhs) {
+                                 return lhs.first > rhs.first;
+                             });
+            decoded.resize(n);
+        }
+
+        const auto now = C::now();
+        const std::lock_guard<M> lock(_mutex);
+        reinitialize(now);
+        _count = count;
+        for (const auto &x : decoded) {
+            const auto slot = static_cast<unsigned>(_heap.size());
+            _reservoir[slot] = x.second;
+            _heap.push_back({x.first, slot});
+        }
+        std::make_heap(_heap.begin(), _heap.end(), compare);
+        return true;
+    }
+
+  private:
+    /** priority of a sample in the reservoir, and its index in _reservoir */
+    struct Entry {
+        double priority;
+        unsigned slot;
+    };
+
+    using EntryAllocator =
+        typename std::allocator_traits<A>::template rebind_alloc<Entry>;
+
+    /** ordering for a min-heap on priority */
+    static bool compare(const Entry &lhs, const Entry &rhs) noexcept {
+        return lhs.priority > rhs.priority;
+    }
+
+    static double seconds(typename C::duration d) noexcept {
+        return std::chrono::duration<double>(d).count();
+    }
+
+    /** get a random number in range ]0:1[ */
+    double getRandom() noexcept {
+        double r;
+        do {
+            r = _distribution_real(_random);
+        } while (r == 0.0);
+        return r;
+    }
+
+    /** time after which exp(alpha * t) reaches the square root of the
+     * largest double: priorities stay finite, also for a weight / random
+     * number up to 1e150. At most RESCALE_INTERVAL. */
+    static typename C::duration rescaleInterval(double alpha) noexcept {
+        const double limit =
+            std::log(std::numeric_limits<double>::max()) / (2 * alpha);
+        if (!(alpha > 0) || limit >= seconds(RESCALE_INTERVAL)) {
+            return RESCALE_INTERVAL;
+        }
+        return std::chrono::duration_cast<typename C::duration>(
+            std::chrono::duration<double>(limit));
+    }
+
+    /** move the landmark time to now, to keep the priorities finite. Scaling
+     * all priorities by the same factor keeps the heap ordering intact. */
+    void rescale(typename C::time_point now) noexcept {
+        const double factor = std::exp(-_alpha * seconds(now - _start));
+        for (auto &entry : _heap) {
+            entry.priority *= factor;
+        }
+        _start = now;
+        _nextRescale = now + _rescaleInterval;
+    }
+
+    /** non-virtual function to initialize, can be called from constructor */
+    void reinitialize(typename C::time_point now) noexcept {
+        _count = 0;
+        _heap.clear();
+        _start = now;
+        _nextRescale = now + _rescaleInterval;
+    }
+
+    static constexpr std::chrono::hours RESCALE_INTERVAL{1};
+
+    unsigned _count{};
+    double _alpha;
+    typename C::duration _rescaleInterval;
+    typename C::time_point _start{};
+    typename C::time_point _nextRescale{};
+    /// Fast random generator, seeded
+    std::minstd_rand _random{std::random_device{}()};
+    std::uniform_real_distribution<> _distribution_real{0.0, 1.0};
+    std::vector<T, A> _reservoir;
+    std::vector<Entry, EntryAllocator> _heap;
+    mutable M _mutex{};
+};
+
+template <typename T, typename M, typename C, typename A>
+constexpr std::chrono::hours
+    ExponentiallyDecayingReservoir<T, M, C, A>::RESCALE_INTERVAL;
+
+} // namespace Metrics
+
+#endif
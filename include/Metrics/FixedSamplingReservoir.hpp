@@ -0,0 +1,95 @@
+#ifndef METRICS_FIXEDSAMPLINGRESERVOIR_HPP
+#define METRICS_FIXEDSAMPLINGRESERVOIR_HPP
+
+/* Reservoir sampling in C++
+   https://en.wikipedia.org/wiki/Reservoir_sampling
+*/
+
+#include "Codec.hpp"
+#include "IReservoir.hpp"
+#include "SamplingReservoir.hpp"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Metrics {
+/** create sample reservoir on a stream of data, with a capacity of N values
+ * stored inline without heap allocation. E is the codec of the stored
+ * values. A is the allocator of the snapshots, and of the keys of weighted
+ * sampling, which are only allocated after the first weighted update. */
+template <typename T = double, unsigned N = 1024, typename M = std::mutex,
+          typename E = IdentityCodec<T>, typename A = std::allocator<T>>
+class FixedSamplingReservoir : public IReservoir<T, A> {
+    static_assert(N > 0, "reservoir must have a capacity");
+    using Storage = std::array<typename E::Stored, N>;
+
+  public:
+    explicit FixedSamplingReservoir(E codec = E(), const A &alloc = A())
+        : _state(codec, alloc) {}
+
+    void reset() noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.reset();
+    }
+
+    /** Update reservoir using fast algorithm L */
+    void update(T value) noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.update(value);
+    }
+
+    /** Update reservoir with a weighted value using algorithm A-ExpJ, see
+     * SamplingReservoir::update(value, weight) */
+    void update(T value, double weight) noexcept {
+        const std::lock_guard<M> lock(_mutex);
+        _state.update(value, weight);
+    }
+
+    unsigned count() const noexcept { return _state.count(); }
+    unsigned size() const noexcept override { return N; }
+    unsigned samples() const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        return _state.samples();
+    }
+    /** return stored values, or nullptr when they are encoded */
+    const T *data() const noexcept override { return _state.data(); }
+
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(_state.allocator());
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        out.fill(
+            [this](std::vector<T, A> &values) { _state.decodeTo(values); });
+    }
+
+    /** append the no of updates and the samples to out */
+    void serialize(BinaryWriter &out) const override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.serialize(out);
+    }
+
+    /** replace the samples by samples written by serialize() of a reservoir
+     * of the same capacity, sampling continues as if all updates were done
+     * on this reservoir. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) override {
+        const std::lock_guard<M> lock(_mutex);
+        return _state.deserialize(in);
+    }
+
+  private:
+    Internals::SamplingReservoirNoLock<T, E, Storage, A> _state;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
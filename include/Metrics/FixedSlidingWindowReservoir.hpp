@@ -0,0 +1,117 @@
+#ifndef METRICS_FIXEDSLIDINGWINDOWRESERVOIR_HPP
+#define METRICS_FIXEDSLIDINGWINDOWRESERVOIR_HPP
+
+#include "IReservoir.hpp"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Metrics {
+/** sliding windows on a stream of data, with a capacity of N values stored
+ * inline without heap allocation. When N is a power of 2, the write position
+ * wraps around with a mask. A is the allocator of the snapshots. */
+template <typename T = double, unsigned N = 1024, typename M = std::mutex,
+          typename A = std::allocator<T>>
+class FixedSlidingWindowReservoir : public IReservoir<T, A> {
+    static_assert(N > 0, "reservoir must have a capacity");
+
+  public:
+    /** alloc = allocator of the snapshots */
+    explicit FixedSlidingWindowReservoir(const A &alloc = A())
+        : _alloc(alloc) {}
+
+    void reset() noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _writePosition = 0;
+        _samples = 0;
+    }
+
+    /** Update sliding window */
+    void update(T value) noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        update_nolock(value);
+    }
+
+    unsigned size() const noexcept override { return N; }
+    unsigned samples() const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        return _samples;
+    }
+    const T *data() const noexcept override { return _reservoir.data(); }
+
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(_alloc);
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        out.assign(_reservoir.cbegin(), _reservoir.cbegin() + _samples);
+    }
+
+    /** append the samples to out, oldest first */
+    void serialize(BinaryWriter &out) const override {
+        const std::lock_guard<M> lock(_mutex);
+        out.write(_samples);
+        unsigned position = (_writePosition + N - _samples) % N;
+        for (unsigned i = 0; i < _samples; i++) {
+            out.write(_reservoir[position]);
+            position = next(position);
+        }
+    }
+
+    /** replace the samples by samples written by serialize(), keeps the
+     * newest N samples. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) override {
+        size_t samples;
+        if (!in.readCount(samples)) {
+            return false;
+        }
+        std::vector<T> values(samples);
+        for (T &value : values) {
+            if (!in.read(value)) {
+                return false;
+            }
+        }
+        const std::lock_guard<M> lock(_mutex);
+        _writePosition = 0;
+        _samples = 0;
+        for (T value : values) {
+            update_nolock(value);
+        }
+        return true;
+    }
+
+  private:
+    static constexpr bool POWER_OF_2 = (N & (N - 1)) == 0;
+
+    static unsigned next(unsigned position) noexcept {
+        if (POWER_OF_2) {
+            return (position + 1) & (N - 1);
+        }
+        return (position + 1 == N) ? 0 : position + 1;
+    }
+
+    void update_nolock(T value) noexcept {
+        _reservoir[_writePosition] = value;
+        _writePosition = next(_writePosition);
+        if (_samples < N) {
+            _samples++;
+        }
+    }
+
+    unsigned _writePosition = 0;
+    unsigned _samples = 0;
+    std::array<T, N> _reservoir{};
+    A _alloc;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+#endif
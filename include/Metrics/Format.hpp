@@ -0,0 +1,122 @@
+#ifndef METRICS_FORMAT_HPP
+#define METRICS_FORMAT_HPP
+
+#include <clocale>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace Metrics {
+namespace Internals {
+/** replace the decimal point of the C locale in text of length n by '.',
+ * return the new length */
+inline int replaceDecimalPoint(char *text, int n, const char *point) {
+    if (point[0] == '.' && point[1] == '\0') {
+        return n;
+    }
+    char *found = strstr(text, point);
+    if (found == nullptr) {
+        return n;
+    }
+    const int length = static_cast<int>(strlen(point));
+    *found = '.';
+    // also moves the terminating 0
+    memmove(found + 1, found + length, n - (found - text) - length + 1);
+    return n - length + 1;
+}
+
+/** append a floating point value formatted like std::ostream: printf %g, or
+ * %.Nf with std::fixed and std::setprecision(N) when precision N > -1.
+ * Like a stream with the default classic locale, the decimal point is
+ * always '.', whatever LC_NUMERIC is. */
+inline void appendNumber(std::string &out, double value, int precision) {
+    char text[400];
+    int n = (precision > -1)
+                ? snprintf(text, sizeof(text), "%.*f", precision, value)
+                : snprintf(text, sizeof(text), "%g", value);
+    // %f of a huge value with a large precision is truncated
+    if (n >= static_cast<int>(sizeof(text))) {
+        n = static_cast<int>(sizeof(text)) - 1;
+    }
+    out.append(text, replaceDecimalPoint(text, n, localeconv()->decimal_point));
+}
+
+inline void appendNumber(std::string &out, long long value) {
+    char text[24];
+    out.append(text, snprintf(text, sizeof(text), "%lld", value));
+}
+
+inline void appendNumber(std::string &out, unsigned long long value) {
+    char text[24];
+    out.append(text, snprintf(text, sizeof(text), "%llu", value));
+}
+
+/** Replacement of std::ostringstream for toString(): numbers are formatted
+ * with snprintf into a stack buffer, without the locale handling and
+ * allocations of a stream. The output is the same as a stream with
+ * std::fixed and std::setprecision(precision) when precision > -1. */
+class Formatter {
+  public:
+    explicit Formatter(int precision = -1) : _precision(precision) {
+        _text.reserve(INITIAL_CAPACITY);
+    }
+
+    Formatter &operator<<(const char *text) {
+        _text += text;
+        return *this;
+    }
+
+    Formatter &operator<<(const std::string &text) {
+        _text += text;
+        return *this;
+    }
+
+    Formatter &operator<<(char c) {
+        _text += c;
+        return *this;
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_floating_point<V>::value,
+                            Formatter &>::type
+    operator<<(V value) {
+        appendNumber(_text, static_cast<double>(value), _precision);
+        return *this;
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                                std::is_signed<V>::value,
+                            Formatter &>::type
+    operator<<(V value) {
+        appendNumber(_text, static_cast<long long>(value));
+        return *this;
+    }
+
+    template <typename V>
+    typename std::enable_if<std::is_integral<V>::value &&
+                                !std::is_signed<V>::value,
+                            Formatter &>::type
+    operator<<(V value) {
+        appendNumber(_text, static_cast<unsigned long long>(value));
+        return *this;
+    }
+
+    /** return the text, the formatter is empty afterwards */
+    std::string release() noexcept { return std::move(_text); }
+
+  private:
+    /** fits the output of most metrics, so formatting allocates once */
+    static constexpr size_t INITIAL_CAPACITY = 128;
+
+    int _precision;
+    std::string _text{};
+};
+
+} // namespace Internals
+} // namespace Metrics
+
+#endif
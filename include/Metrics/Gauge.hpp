@@ -1,10 +1,9 @@
 #ifndef METRICS_GAUGE_HPP
 #define METRICS_GAUGE_HPP
 
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include <atomic>
-#include <iomanip>
-#include <sstream>
 #include <string>
 
 namespace Metrics {
@@ -24,12 +23,13 @@ template <typename T = double> class Gauge : public IMetric {
     }
 
     std::string toString(int precision = -1) const noexcept override {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << value();
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        visitor.field("value", static_cast<double>(value()));
     }
 
   private:
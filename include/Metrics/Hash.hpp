@@ -0,0 +1,23 @@
+#ifndef METRICS_HASH_HPP
+#define METRICS_HASH_HPP
+
+#include <cstdint>
+
+namespace Metrics {
+namespace Internals {
+/** 64 bit finalizer of splitmix64, spreads the entropy of all input bits over
+ * all output bits. std::hash is the identity function for integers in most
+ * standard libraries, so its result must be mixed before using the bits. */
+inline uint64_t mix64(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace Internals
+} // namespace Metrics
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef METRICS_HISTOGRAM_HPP
 #define METRICS_HISTOGRAM_HPP
 
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include "IReservoir.hpp"
 #include "Variance.hpp"
@@ -8,10 +9,22 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <utility>
 
 namespace Metrics {
-/** Store a reservoir histogram. U is float/double, T is an IReservoir<U> */
+/** Tag to create a Histogram with a reservoir of a fixed capacity */
+struct FixedCapacity {};
+
+/** Tag to create a Histogram with the constructor arguments of its reservoir
+ */
+struct ReservoirArgs {};
+
+/** Store a reservoir histogram. U is float/double, T is an IReservoir<U>.
+ * After reuseSnapshots(), toString() reuses the memory of the snapshot of the
+ * previous call. */
 template <typename T, typename U = double> class Histogram : public IMetric {
+    using Allocator = typename T::SnapshotType::Values::allocator_type;
+
   public:
     /** Create a histogram
      * n = reservoir size
@@ -20,39 +33,72 @@ template <typename T, typename U = double> class Histogram : public IMetric {
     explicit Histogram(int n, bool withStats = false, int noBins = -1)
         : _reservoir(n), _withStats(withStats), _noBins(noBins) {}
 
+    /** Create a histogram with a reservoir of a fixed capacity, e.g.
+     * Histogram<FixedSamplingReservoir<double, 1024>> h(FixedCapacity{})
+     * withStats = true if the output must contain stats (stdev, ...)
+     * noBins > 1 if the output must contains bins */
+    explicit Histogram(FixedCapacity, bool withStats = false, int noBins = -1)
+        : _reservoir(), _withStats(withStats), _noBins(noBins) {}
+
+    /** Create a histogram, the reservoir is constructed with args, e.g. its
+     * size, codec and allocator: h(ReservoirArgs{}, false, -1, n, codec)
+     * withStats = true if the output must contain stats (stdev, ...)
+     * noBins > 1 if the output must contains bins */
+    template <typename... Args>
+    Histogram(ReservoirArgs, bool withStats, int noBins, Args &&...args)
+        : _reservoir(std::forward<Args>(args)...), _withStats(withStats),
+          _noBins(noBins) {}
+
     void reset() noexcept override { _reservoir.reset(); }
     void update(U value) noexcept { _reservoir.update(value); }
-    Snapshot<U> getSnapshot() noexcept { return _reservoir.getSnapshot(); }
 
-    std::string toString(int precision = -1) const noexcept override {
-        auto snapshot = _reservoir.getSnapshot();
+    /** add a weighted value, only for reservoirs with weighted sampling */
+    void update(U value, double weight) noexcept {
+        _reservoir.update(value, weight);
+    }
+    typename T::SnapshotType getSnapshot() noexcept {
+        return _reservoir.getSnapshot();
+    }
 
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+    /** get a snapshot with its values allocated by alloc */
+    typename T::SnapshotType
+    getSnapshot(const Allocator &alloc) const noexcept {
+        return _reservoir.getSnapshot(alloc);
+    }
 
-        os << "count(" << snapshot.size() << "), min(" << snapshot.getValue(0)
-           << "), Q25(" << snapshot.getValue(0.25) << "), Q50("
-           << snapshot.getValue(0.50) << "), Q75(" << snapshot.getValue(0.75)
-           << "), max(" << snapshot.getValue(1.00) << ")";
+    /** replace the values of out by a snapshot, reusing its memory */
+    void getSnapshot(typename T::SnapshotType &out) const noexcept {
+        _reservoir.getSnapshot(out);
+    }
 
-        if (_withStats) {
-            Variance<U> stats{};
-            for (auto x : snapshot.values()) {
-                stats.update(x);
-            }
-            os << ", stats: (" << stats.toString(precision) << ")";
-        }
-        if (_noBins > 1) {
-            os << std::endl << "buckets:" << std::endl;
-            dumpBinsToStream(snapshot, os);
-        }
-        return os.str();
+    /** append the samples of the reservoir to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const { _reservoir.serialize(out); }
+
+    /** decode samples written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) { return _reservoir.deserialize(in); }
+
+    std::string toString(int precision = -1) const noexcept override {
+        std::string result;
+        _scratch.apply(_reservoir,
+                       [&](const typename T::SnapshotType &snapshot) {
+                           result = toString(snapshot, precision);
+                       });
+        return result;
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        _scratch.apply(_reservoir,
+                       [&](const typename T::SnapshotType &snapshot) {
+                           visit(snapshot, visitor);
+                       });
     }
 
-    void dumpBinsToStream(const Snapshot<U> &snapshot, std::ostream &os,
-                          int precision = -1) const noexcept {
+    void reuseSnapshots() override {
+        _scratch.enable(_reservoir.getSnapshot());
+    }
+
+    void dumpBinsToStream(const typename T::SnapshotType &snapshot,
+                          std::ostream &os, int precision = -1) const noexcept {
         // get limits of bins
         auto min = snapshot.getValue(0.0);
         auto max = snapshot.getValue(1.0);
@@ -80,11 +126,70 @@ template <typename T, typename U = double> class Histogram : public IMetric {
     }
 
   private:
+    std::string toString(const typename T::SnapshotType &snapshot,
+                         int precision) const noexcept {
+        Internals::Formatter os(precision);
+
+        os << "count(" << snapshot.size() << "), min(" << snapshot.getValue(0)
+           << "), Q25(" << snapshot.getValue(0.25) << "), Q50("
+           << snapshot.getValue(0.50) << "), Q75(" << snapshot.getValue(0.75)
+           << "), max(" << snapshot.getValue(1.00) << ")";
+
+        if (_withStats) {
+            Internals::VarianceNoLock<U> stats{};
+            for (auto x : snapshot.values()) {
+                stats.update(x);
+            }
+            os << ", stats: (" << stats.toString(precision) << ")";
+        }
+        if (_noBins > 1) {
+            // the bins are aligned with stream manipulators
+            std::ostringstream bins;
+            if (precision > -1) {
+                bins << std::fixed << std::setprecision(precision);
+            }
+            dumpBinsToStream(snapshot, bins);
+            os << "\nbuckets:\n" << bins.str();
+        }
+        return os.release();
+    }
+
+    void visit(const typename T::SnapshotType &snapshot,
+               IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", static_cast<int64_t>(snapshot.size()));
+        visitor.field("min", static_cast<double>(snapshot.getValue(0)));
+        for (double q : {0.25, 0.50, 0.75}) {
+            visitor.quantile(q, static_cast<double>(snapshot.getValue(q)));
+        }
+        visitor.field("max", static_cast<double>(snapshot.getValue(1.00)));
+
+        if (_withStats) {
+            Internals::VarianceNoLock<U> stats{};
+            for (auto x : snapshot.values()) {
+                stats.update(x);
+            }
+            visitor.field("mean", static_cast<double>(stats.mean()));
+            visitor.field("sample_stddev",
+                          static_cast<double>(stats.sample_stddev()));
+        }
+
+        const auto min = snapshot.getValue(0.0);
+        const auto width = snapshot.getValue(1.0) - min;
+        if (_noBins > 1 && width > 0.0) {
+            const auto bins = snapshot.getBins(_noBins, min, width);
+            for (int i = 0; i < _noBins; i++) {
+                visitor.bin(min + i * width / _noBins,
+                            min + (i + 1) * width / _noBins, bins[i]);
+            }
+        }
+    }
+
     static constexpr double MAX_BIN_WIDTH =
         50; /** width of the largest bin in the output */
     T _reservoir;
     bool _withStats;
     int _noBins;
+    Internals::ReusedSnapshot<typename T::SnapshotType> _scratch{};
 };
 
 } // namespace Metrics
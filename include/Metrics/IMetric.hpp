@@ -1,14 +1,58 @@
 #ifndef METRICS_IMETRIC_HPP
 #define METRICS_IMETRIC_HPP
 
+#include <cstdint>
 #include <string>
 
 namespace Metrics {
+/** Receives the typed fields of metrics, e.g. to export them without
+ * building intermediate strings. Keys are only valid during the call. */
+class IMetricVisitor {
+  public:
+    virtual ~IMetricVisitor() = default;
+
+    /** start and end of the fields of metric name, called by
+     * Registry::visit() */
+    virtual void beginMetric(const std::string &name) = 0;
+    virtual void endMetric() = 0;
+
+    virtual void field(const char *key, int64_t value) = 0;
+    virtual void field(const char *key, double value) = 0;
+
+    /** element index of a field with multiple values, e.g. the mean per
+     * dimension */
+    virtual void field(const char *key, unsigned index, double value) = 0;
+
+    /** value of quantile q (0..1) */
+    virtual void quantile(double q, double value) = 0;
+
+    /** histogram bin with count values >= lower and < upper */
+    virtual void bin(double lower, double upper, int64_t count) = 0;
+
+    /** counted key, e.g. a heavy hitter of TopK */
+    virtual void entry(const std::string &key, int64_t count) = 0;
+
+    /** field without a numeric value */
+    virtual void text(const char *key, const std::string &value) = 0;
+};
+
 /** Interface of a metric, can be stored in a registry */
 class IMetric {
   public:
     virtual void reset() noexcept = 0;
     virtual std::string toString(int precision = -1) const noexcept = 0;
+
+    /** pass the fields of the metric to visitor. The default passes
+     * toString() as a text field. */
+    virtual void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.text("value", toString());
+    }
+
+    /** keep the snapshot of toString() and visit() between calls to reuse
+     * its memory, see Registry::reportMap(map &). No-op for metrics without
+     * a snapshot. */
+    virtual void reuseSnapshots() {}
+
     virtual ~IMetric() = default;
 };
 
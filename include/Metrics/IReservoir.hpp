@@ -2,16 +2,56 @@
 #define METRICS_IRESERVOIR_HPP
 
 #include "Snapshot.hpp"
+#include <memory>
 
 namespace Metrics {
-template <class T> class IReservoir {
+/** A is the allocator of the snapshots */
+template <class T, class A = std::allocator<T>> class IReservoir {
   public:
+    using SnapshotType = Snapshot<T, A>;
+
     virtual void reset() noexcept = 0;
     virtual void update(T value) noexcept = 0;
     virtual unsigned size() const noexcept = 0;
     virtual unsigned samples() const noexcept = 0;
     virtual const T *data() const noexcept = 0;
-    virtual Snapshot<T> getSnapshot() const noexcept = 0;
+    virtual Snapshot<T, A> getSnapshot() const noexcept = 0;
+
+    /** get a snapshot with its values allocated by alloc, e.g. from an arena
+     * which is cleared after each report */
+    virtual Snapshot<T, A> getSnapshot(const A &alloc) const noexcept {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    /** replace the values of out by a snapshot, reusing its memory. The
+     * default takes a new snapshot. */
+    virtual void getSnapshot(Snapshot<T, A> &out) const noexcept {
+        out = getSnapshot();
+    }
+
+    /** append the samples to out, see Binary.hpp. The default writes a
+     * snapshot. */
+    virtual void serialize(BinaryWriter &out) const {
+        getSnapshot().serialize(out);
+    }
+
+    /** replace the samples by samples written by serialize(), unchanged on
+     * failure. The default updates the reset reservoir with the values of a
+     * snapshot, in sorted order. */
+    virtual bool deserialize(BinaryReader &in) {
+        Snapshot<T, A> snapshot = getSnapshot();
+        if (!snapshot.deserialize(in)) {
+            return false;
+        }
+        reset();
+        for (T value : snapshot.values()) {
+            update(value);
+        }
+        return true;
+    }
+
     virtual ~IReservoir() = default;
 };
 
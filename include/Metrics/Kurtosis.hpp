@@ -1,22 +1,26 @@
 #ifndef METRICS_KURTOSIS_HPP
 #define METRICS_KURTOSIS_HPP
 
+#include "Binary.hpp"
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include "MinMax.hpp"
+#include "Weight.hpp"
 #include <algorithm>
 #include <cmath>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
 #include <string>
 
 namespace Metrics {
 namespace Internals {
-/** Calculate 4th order statistics online */
-template <typename T = double> class KurtosisNoLock {
+/** Calculate 4th order statistics online. WEIGHTED enables
+ * update(value, weight). */
+template <typename T = double, bool WEIGHTED = false>
+class KurtosisNoLock : private WeightSum<T, WEIGHTED> {
   public:
     void reset() noexcept {
         _minmax.reset();
+        this->resetWeight();
         _mean = {};
         _m2 = {};
         _m3 = {};
@@ -24,10 +28,10 @@ template <typename T = double> class KurtosisNoLock {
     }
 
     void update(T value) noexcept {
-        auto n1 = _minmax.count();
+        const T n1 = weight();
         _minmax.update(value);
 
-        const T n = static_cast<T>(n1 + 1);
+        const T n = weight();
         const T delta = value - _mean;
         const T delta_n = delta / n;
         const T delta_n2 = delta_n * delta_n;
@@ -40,8 +44,37 @@ template <typename T = double> class KurtosisNoLock {
         _m2 += term1;
     }
 
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. This is Pebay's
+     * pairwise update with a set of 1 value with the given weight. */
+    void update(T value, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        if (!(weight > 0)) {
+            return;
+        }
+        const T n1 = this->weight();
+        _minmax.update(value);
+        this->addWeight(weight);
+
+        const T n = this->weight();
+        const T delta = value - _mean;
+        const T delta_n = delta / n;
+        const T delta_n2 = delta_n * delta_n;
+        const T term1 = delta * delta_n * n1 * weight;
+
+        _mean += delta_n * weight;
+        _m4 += term1 * delta_n2 * (n1 * n1 - n1 * weight + weight * weight) +
+               6 * delta_n2 * weight * weight * _m2 -
+               4 * delta_n * weight * _m3;
+        _m3 += term1 * delta_n * (n1 - weight) - 3 * delta_n * weight * _m2;
+        _m2 += term1;
+    }
+
     int64_t count() const noexcept { return _minmax.count(); }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept { return this->weightOf(count()); }
+
     T min() const noexcept { return _minmax.min(); }
 
     T mean() const noexcept { return (_minmax.count() == 0) ? NAN : _mean; }
@@ -50,7 +83,7 @@ template <typename T = double> class KurtosisNoLock {
 
     /** variance of a population */
     T variance() const noexcept {
-        return (_minmax.count() < 1) ? NAN : (_m2 / _minmax.count());
+        return (_minmax.count() < 1) ? NAN : (_m2 / weight());
     }
 
     /** standard deviation of a population */
@@ -58,7 +91,7 @@ template <typename T = double> class KurtosisNoLock {
 
     /** variance of a sample from a population */
     T sample_variance() const noexcept {
-        return (_minmax.count() < 2) ? NAN : (_m2 / (_minmax.count() - 1));
+        return (weight() <= 1) ? NAN : (_m2 / (weight() - 1));
     }
 
     /** standard deviation of a sample of a population */
@@ -66,31 +99,56 @@ template <typename T = double> class KurtosisNoLock {
 
     T excess_kurtosis() const noexcept { return kurtosis() - 3; }
 
-    T kurtosis() const noexcept {
-        return (_minmax.count() * _m4) / (_m2 * _m2);
-    }
+    T kurtosis() const noexcept { return (weight() * _m4) / (_m2 * _m2); }
 
-    T skew() const noexcept {
-        return sqrt(static_cast<T>(_minmax.count())) * _m3 / (pow(_m2, 1.5));
-    }
+    T skew() const noexcept { return sqrt(weight()) * _m3 / (pow(_m2, 1.5)); }
 
     /** RMS value of the samples */
     T rms() const noexcept {
-        return (_minmax.count() < 1)
-                   ? NAN
-                   : sqrt(_mean * _mean + _m2 / _minmax.count());
+        return (_minmax.count() < 1) ? NAN
+                                     : sqrt(_mean * _mean + _m2 / weight());
     }
 
     std::string toString(int precision = -1) const noexcept {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << "count(" << count() << ") min(" << min() << ") mean(" << mean()
            << ") max(" << max() << ") sample_stddev(" << sample_stddev()
            << ") skew(" << skew() << ") excess_kurtosis(" << excess_kurtosis()
            << ")";
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("max", static_cast<double>(max()));
+        visitor.field("sample_stddev", static_cast<double>(sample_stddev()));
+        visitor.field("skew", static_cast<double>(skew()));
+        visitor.field("excess_kurtosis",
+                      static_cast<double>(excess_kurtosis()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        _minmax.serialize(out);
+        this->serializeWeight(out);
+        out.write(_mean);
+        out.write(_m2);
+        out.write(_m3);
+        out.write(_m4);
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        KurtosisNoLock result(*this);
+        if (!result._minmax.deserialize(in) || !result.deserializeWeight(in) ||
+            !in.read(result._mean) || !in.read(result._m2) ||
+            !in.read(result._m3) || !in.read(result._m4)) {
+            return false;
+        }
+        *this = result;
+        return true;
     }
 
   private:
@@ -102,8 +160,9 @@ template <typename T = double> class KurtosisNoLock {
 };
 
 } // namespace Internals
-/** Calculate 4th order statistics online */
-template <typename T = double, typename M = std::mutex>
+/** Calculate 4th order statistics online. WEIGHTED enables
+ * update(value, weight). */
+template <typename T = double, typename M = std::mutex, bool WEIGHTED = false>
 class Kurtosis : public IMetric {
     using lock_guard = const std::lock_guard<M>;
 
@@ -141,11 +200,24 @@ class Kurtosis : public IMetric {
         _state.update(value);
     }
 
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value, weight);
+    }
+
     int64_t count() const noexcept {
         lock_guard lock(_mutex);
         return _state.count();
     }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.weight();
+    }
+
     T min() const noexcept {
         lock_guard lock(_mutex);
         return _state.min();
@@ -206,13 +278,23 @@ class Kurtosis : public IMetric {
         return _state.rms();
     }
 
-    std::string toString(int precision = -1) const noexcept override {
+    /** return copy of the state, to read many values with a single lock */
+    Internals::KurtosisNoLock<T, WEIGHTED> state() const noexcept {
         lock_guard lock(_mutex);
-        return _state.toString(precision);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
     }
 
   private:
-    Internals::KurtosisNoLock<T> _state{};
+    Internals::KurtosisNoLock<T, WEIGHTED> _state{};
     mutable M _mutex{};
 };
 
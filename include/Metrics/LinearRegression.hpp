@@ -1,21 +1,25 @@
 #ifndef METRICS_LINEARREGRESSION_HPP
 #define METRICS_LINEARREGRESSION_HPP
 
+#include "Binary.hpp"
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include "Variance.hpp"
 #include <algorithm>
 #include <cmath>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
 #include <string>
 
 namespace Metrics {
 namespace Internals {
 /** Calculate incrementally linear regression coefficients using least squares
  * https://en.wikipedia.org/wiki/Simple_linear_regression
+ * WEIGHTED enables update(x, y, weight).
  */
-template <typename T = double> class LinearRegressionNoLock {
+template <typename T = double, bool WEIGHTED = false>
+class LinearRegressionNoLock {
+    using Stats = VarianceNoLock<T, WelfordAccumulator<T>, WEIGHTED>;
+
   public:
     void reset() noexcept {
         _stats_x = {};
@@ -32,17 +36,31 @@ template <typename T = double> class LinearRegressionNoLock {
         _s_xy += dx * dy;
     }
 
+    /** add a point with a frequency weight, e.g. a point which occurred
+     * weight times. Points with weight <= 0 are ignored. */
+    void update(T x, T y, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        if (!(weight > 0)) {
+            return;
+        }
+        T dx = x - _stats_x.mean0();
+        _stats_x.update(x, weight);
+        _stats_y.update(y, weight);
+        T dy = y - _stats_y.mean0();
+        _s_xy += weight * dx * dy;
+    }
+
     LinearRegressionNoLock &
     operator+=(const LinearRegressionNoLock &rhs) noexcept {
-        const auto count_both = count() + rhs.count();
-        if (count_both == 0) {
+        if (count() + rhs.count() == 0) {
             return *this;
         }
+        const T weight_both = weight() + rhs.weight();
 
         // Note: stats.mean() is 0 when there is no data, OK
         _s_xy += rhs._s_xy + (_stats_x.mean0() - rhs._stats_x.mean0()) *
                                  (_stats_y.mean0() - rhs._stats_y.mean0()) *
-                                 count() * rhs.count() / count_both;
+                                 weight() * rhs.weight() / weight_both;
 
         _stats_x += rhs._stats_x;
         _stats_y += rhs._stats_y;
@@ -52,8 +70,11 @@ template <typename T = double> class LinearRegressionNoLock {
     /** return no of measurements */
     int64_t count() const noexcept { return _stats_x.count(); }
 
-    const VarianceNoLock<T> &stats_x() const noexcept { return _stats_x; }
-    const VarianceNoLock<T> &stats_y() const noexcept { return _stats_y; }
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept { return _stats_x.weight(); }
+
+    const Stats &stats_x() const noexcept { return _stats_x; }
+    const Stats &stats_y() const noexcept { return _stats_y; }
 
     /** slope of least squares best fit, y = slope() * x + intercept(), or NAN
      * when less than 2 measurements */
@@ -78,7 +99,7 @@ template <typename T = double> class LinearRegressionNoLock {
     T correlation() const noexcept {
         return (_stats_x.count() < 2)
                    ? NAN
-                   : _s_xy / (_stats_x.count() * _stats_x.stddev() *
+                   : _s_xy / (_stats_x.weight() * _stats_x.stddev() *
                               _stats_y.stddev());
     }
 
@@ -100,18 +121,39 @@ template <typename T = double> class LinearRegressionNoLock {
     T slope_through_origin() const noexcept { return slope_through(0.0, 0.0); }
 
     std::string toString(int precision = -1) const noexcept {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << "count(" << _stats_x.count() << ") slope(" << slope()
            << ") intercept(" << intercept() << ")";
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", _stats_x.count());
+        visitor.field("slope", static_cast<double>(slope()));
+        visitor.field("intercept", static_cast<double>(intercept()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        _stats_x.serialize(out);
+        _stats_y.serialize(out);
+        out.write(_s_xy);
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        LinearRegressionNoLock result(*this);
+        if (!result._stats_x.deserialize(in) ||
+            !result._stats_y.deserialize(in) || !in.read(result._s_xy)) {
+            return false;
+        }
+        *this = result;
+        return true;
     }
 
   private:
-    VarianceNoLock<T> _stats_x{};
-    VarianceNoLock<T> _stats_y{};
+    Stats _stats_x{};
+    Stats _stats_y{};
     T _s_xy{};
 };
 
@@ -119,8 +161,9 @@ template <typename T = double> class LinearRegressionNoLock {
 
 /** Calculate incrementally linear regression coefficients using least squares
  * https://en.wikipedia.org/wiki/Simple_linear_regression
+ * WEIGHTED enables update(x, y, weight).
  */
-template <typename T = double, typename M = std::mutex>
+template <typename T = double, typename M = std::mutex, bool WEIGHTED = false>
 class LinearRegression : public IMetric {
     using lock_guard = const std::lock_guard<M>;
 
@@ -158,6 +201,13 @@ class LinearRegression : public IMetric {
         _state.update(x, y);
     }
 
+    /** add a point with a frequency weight, e.g. a point which occurred
+     * weight times. Points with weight <= 0 are ignored. */
+    void update(T x, T y, T weight) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(x, y, weight);
+    }
+
     LinearRegression &operator+=(const LinearRegression &rhs) noexcept {
         // In the very unlikely case that 2 threads simultaneously do a+=b and
         // b+=a, regular lock_guard causes a deadlock
@@ -187,6 +237,12 @@ class LinearRegression : public IMetric {
         return _state.count();
     }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.weight();
+    }
+
     const Internals::VarianceNoLock<T> &stats_x() const noexcept {
         lock_guard lock(_mutex);
         return _state.stats_x();
@@ -230,13 +286,23 @@ class LinearRegression : public IMetric {
         return _state.slope_through_origin();
     }
 
-    std::string toString(int precision = -1) const noexcept override {
+    /** return copy of the state, to read many values with a single lock */
+    Internals::LinearRegressionNoLock<T, WEIGHTED> state() const noexcept {
         lock_guard lock(_mutex);
-        return _state.toString(precision);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
     }
 
   private:
-    Internals::LinearRegressionNoLock<T> _state{};
+    Internals::LinearRegressionNoLock<T, WEIGHTED> _state{};
     mutable M _mutex{};
 };
 
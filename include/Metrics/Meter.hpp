@@ -0,0 +1,193 @@
+#ifndef METRICS_METER_HPP
+#define METRICS_METER_HPP
+
+#include "Clock.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include "StripedCounter.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Metrics {
+namespace Internals {
+/** Exponentially weighted moving average of a rate, updated at a fixed tick
+ * interval like the load average of UNIX */
+class RateEwma {
+  public:
+    /** interval = tick interval in seconds, window = time constant in seconds
+     */
+    RateEwma(double interval, double window)
+        : _interval(interval), _alpha(1 - std::exp(-interval / window)) {}
+
+    void reset() noexcept {
+        _rate = 0.0;
+        _initialized = false;
+    }
+
+    /** count = no of events since the previous tick, ticks = no of tick
+     * intervals passed. The events are accounted to the first tick, the
+     * other ticks only decay the rate. */
+    void tick(int64_t count, int64_t ticks) noexcept {
+        const double instant_rate = count / _interval;
+        if (_initialized) {
+            _rate += _alpha * (instant_rate - _rate);
+        } else {
+            _rate = instant_rate;
+            _initialized = true;
+        }
+        if (ticks > 1) {
+            _rate *= std::pow(1 - _alpha, static_cast<double>(ticks - 1));
+        }
+    }
+
+    /** rate in events per second */
+    double rate() const noexcept { return _rate; }
+
+  private:
+    double _interval;
+    double _alpha;
+    double _rate = 0.0;
+    bool _initialized = false;
+};
+
+} // namespace Internals
+
+/** Measure the rate of events: mean rate and 1/5/15 minute exponentially
+ * weighted moving averages. Marking an event is a single atomic add on a
+ * counter cell of the calling thread, the moving averages are only updated
+ * when they are read. C is a std::chrono compatible clock. */
+template <typename M = std::mutex, typename C = CoarseClock>
+class Meter : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    Meter() : _start(C::now()), _lastTick(_start) {}
+    ~Meter() override = default;
+
+    void reset() noexcept override {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        _count.reset();
+        _start = now;
+        _lastTick = now;
+        _lastCount = 0;
+        _m1.reset();
+        _m5.reset();
+        _m15.reset();
+    }
+
+    /** register n events */
+    void mark(int64_t n = 1) noexcept { _count.add(n); }
+
+    /** return no of events */
+    int64_t count() const noexcept { return _count.sum(); }
+
+    /** mean no of events per second since creation or last reset */
+    double mean_rate() const noexcept {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        return meanRate(now);
+    }
+
+    /** 1 minute moving average of events per second */
+    double m1_rate() const noexcept {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        tickIfNecessary(now);
+        return _m1.rate();
+    }
+
+    /** 5 minute moving average of events per second */
+    double m5_rate() const noexcept {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        tickIfNecessary(now);
+        return _m5.rate();
+    }
+
+    /** 15 minute moving average of events per second */
+    double m15_rate() const noexcept {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        tickIfNecessary(now);
+        return _m15.rate();
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format without holding the lock
+        const Rates r = rates();
+        Internals::Formatter os(precision);
+        os << "count(" << r.count << ") mean_rate(" << r.mean << ") m1_rate("
+           << r.m1 << ") m5_rate(" << r.m5 << ") m15_rate(" << r.m15 << ")";
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        const Rates r = rates();
+        visitor.field("count", r.count);
+        visitor.field("mean_rate", r.mean);
+        visitor.field("m1_rate", r.m1);
+        visitor.field("m5_rate", r.m5);
+        visitor.field("m15_rate", r.m15);
+    }
+
+  private:
+    static constexpr int TICK_INTERVAL_S = 5;
+
+    struct Rates {
+        int64_t count;
+        double mean;
+        double m1;
+        double m5;
+        double m15;
+    };
+
+    /** read count and all rates with a single lock */
+    Rates rates() const noexcept {
+        const auto now = C::now();
+        lock_guard lock(_mutex);
+        tickIfNecessary(now);
+        return {_count.sum(), meanRate(now), _m1.rate(), _m5.rate(),
+                _m15.rate()};
+    }
+
+    double meanRate(typename C::time_point now) const noexcept {
+        const double elapsed =
+            std::chrono::duration<double>(now - _start).count();
+        return (elapsed <= 0.0) ? 0.0 : _count.sum() / elapsed;
+    }
+
+    /** feed the moving averages with the events since the last tick */
+    void tickIfNecessary(typename C::time_point now) const noexcept {
+        const typename C::duration interval =
+            std::chrono::seconds(TICK_INTERVAL_S);
+        const auto ticks = (now - _lastTick) / interval;
+        if (ticks <= 0) {
+            return;
+        }
+
+        _lastTick += ticks * interval;
+        const int64_t total = _count.sum();
+        const int64_t delta = total - _lastCount;
+        _lastCount = total;
+        _m1.tick(delta, ticks);
+        _m5.tick(delta, ticks);
+        _m15.tick(delta, ticks);
+    }
+
+    Internals::StripedCounter<> _count{};
+    typename C::time_point _start;
+    mutable typename C::time_point _lastTick;
+    mutable int64_t _lastCount = 0;
+    mutable Internals::RateEwma _m1{TICK_INTERVAL_S, 60};
+    mutable Internals::RateEwma _m5{TICK_INTERVAL_S, 5 * 60};
+    mutable Internals::RateEwma _m15{TICK_INTERVAL_S, 15 * 60};
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
@@ -1,12 +1,12 @@
 #ifndef METRICS_MINMAX_HPP
 #define METRICS_MINMAX_HPP
 
+#include "Binary.hpp"
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include <cmath>
 #include <cstdint>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
 #include <string>
 
 namespace Metrics {
@@ -61,13 +61,39 @@ template <typename T = double> class MinMaxNoLock {
     T max() const noexcept { return (_count == 0) ? NAN : _max; }
 
     std::string toString(int precision = -1) const noexcept {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << "count(" << count() << ") min(" << min() << ") max(" << max()
            << ")";
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("max", static_cast<double>(max()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.write(_count);
+        if (_count != 0) {
+            out.write(_min);
+            out.write(_max);
+        }
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        MinMaxNoLock result;
+        if (!in.read(result._count) || result._count < 0) {
+            return false;
+        }
+        if (result._count != 0 &&
+            !(in.read(result._min) && in.read(result._max))) {
+            return false;
+        }
+        *this = result;
+        return true;
     }
 
   private:
@@ -156,9 +182,19 @@ class MinMax : public IMetric {
         return _state.max();
     }
 
-    std::string toString(int precision = -1) const noexcept override {
+    /** return copy of the state, to read many values with a single lock */
+    Internals::MinMaxNoLock<T> state() const noexcept {
         lock_guard lock(_mutex);
-        return _state.toString(precision);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
     }
 
   private:
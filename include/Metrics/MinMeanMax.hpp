@@ -1,20 +1,24 @@
 #ifndef METRICS_MINMEANMAX_HPP
 #define METRICS_MINMEANMAX_HPP
 
+#include "Binary.hpp"
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include "MinMax.hpp"
+#include "Weight.hpp"
 #include <cmath>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
 #include <string>
 
 namespace Metrics {
 namespace Internals {
-template <typename T = double> class MinMeanMaxNoLock {
+/** WEIGHTED enables update(value, weight) */
+template <typename T = double, bool WEIGHTED = false>
+class MinMeanMaxNoLock : private WeightSum<T, WEIGHTED> {
   public:
     void reset() noexcept {
         _minmax.reset();
+        this->resetWeight();
         _sum = {};
     }
 
@@ -23,8 +27,21 @@ template <typename T = double> class MinMeanMaxNoLock {
         _sum += value;
     }
 
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        if (!(weight > 0)) {
+            return;
+        }
+        _minmax.update(value);
+        this->addWeight(weight);
+        _sum += value * weight;
+    }
+
     MinMeanMaxNoLock &operator+=(const MinMeanMaxNoLock &rhs) noexcept {
         _minmax += rhs._minmax;
+        this->addWeight(rhs);
         _sum += rhs._sum;
         return *this;
     }
@@ -40,26 +57,50 @@ template <typename T = double> class MinMeanMaxNoLock {
     /** return no of measurements */
     int64_t count() const noexcept { return _minmax.count(); }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept { return this->weightOf(count()); }
+
     /** return lowest measured value or NAN when there are no measurements */
     T min() const noexcept { return _minmax.min(); }
 
     /** return mean of measured values or NAN when there are no measurements */
     T mean() const noexcept {
-        auto current_count = _minmax.count();
-        return (current_count == 0) ? NAN : _sum / current_count;
+        return (_minmax.count() == 0) ? NAN : _sum / weight();
     }
 
     /** return highest measured value or NAN when there are no measurements */
     T max() const noexcept { return _minmax.max(); }
 
     std::string toString(int precision = -1) const noexcept {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << "count(" << count() << ") min(" << min() << ") mean(" << mean()
            << ") max(" << max() << ")";
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("max", static_cast<double>(max()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        _minmax.serialize(out);
+        this->serializeWeight(out);
+        out.write(_sum);
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        MinMeanMaxNoLock result(*this);
+        if (!result._minmax.deserialize(in) || !result.deserializeWeight(in) ||
+            !in.read(result._sum)) {
+            return false;
+        }
+        *this = result;
+        return true;
     }
 
   private:
@@ -68,7 +109,8 @@ template <typename T = double> class MinMeanMaxNoLock {
 };
 } // namespace Internals
 
-template <typename T = double, typename M = std::mutex>
+/** WEIGHTED enables update(value, weight) */
+template <typename T = double, typename M = std::mutex, bool WEIGHTED = false>
 class MinMeanMax : public IMetric {
     using lock_guard = const std::lock_guard<M>;
 
@@ -106,6 +148,13 @@ class MinMeanMax : public IMetric {
         _state.update(value);
     }
 
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value, weight);
+    }
+
     MinMeanMax &operator+=(const MinMeanMax &rhs) noexcept {
         // In the very unlikely case that 2 threads simultaneously do a+=b and
         // b+=a, regular lock_guard causes a deadlock
@@ -134,6 +183,12 @@ class MinMeanMax : public IMetric {
         return _state.count();
     }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.weight();
+    }
+
     /** return lowest measured value or NAN when there are no measurements */
     T min() const noexcept {
         lock_guard lock(_mutex);
@@ -152,13 +207,23 @@ class MinMeanMax : public IMetric {
         return _state.max();
     }
 
-    std::string toString(int precision = -1) const noexcept override {
+    /** return copy of the state, to read many values with a single lock */
+    Internals::MinMeanMaxNoLock<T, WEIGHTED> state() const noexcept {
         lock_guard lock(_mutex);
-        return _state.toString(precision);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
     }
 
   private:
-    Internals::MinMeanMaxNoLock<T> _state{};
+    Internals::MinMeanMaxNoLock<T, WEIGHTED> _state{};
     mutable M _mutex{};
 };
 
@@ -0,0 +1,481 @@
+#ifndef METRICS_MOMENTS_HPP
+#define METRICS_MOMENTS_HPP
+
+/* Central moments of arbitrary order online
+   Pebay, Formulas for Robust, One-Pass Parallel Computation of Covariances and
+   Arbitrary-Order Statistical Moments, Sandia report SAND2008-6212
+   https://www.osti.gov/servlets/purl/1028931
+*/
+
+#include "Binary.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include "MinMax.hpp"
+#include "Weight.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace Metrics {
+namespace Internals {
+/** Calculate central moments up to order N >= 2 online. All loops have a
+ * trip count known at compile time, so the compiler unrolls them and folds
+ * the binomial coefficients, which are calculated incrementally. WEIGHTED
+ * enables update(value, weight). */
+template <unsigned N, typename T = double, bool WEIGHTED = false>
+class MomentsNoLock : private WeightSum<T, WEIGHTED> {
+    static_assert(N >= 2, "moments need at least order 2");
+
+  public:
+    void reset() noexcept {
+        _minmax.reset();
+        this->resetWeight();
+        _mean = {};
+        _m.fill(T{});
+    }
+
+    void update(T value) noexcept {
+        const T n1 = weight();
+        _minmax.update(value);
+
+        const T delta_n = (value - _mean) / weight();
+        _mean += delta_n;
+
+        // powers of delta/n and n1, index = exponent
+        T e[N + 1];
+        T n1_pow[N + 1];
+        e[0] = 1;
+        n1_pow[0] = 1;
+        for (unsigned k = 1; k <= N; k++) {
+            e[k] = delta_n * e[k - 1];
+            n1_pow[k] = n1 * n1_pow[k - 1];
+        }
+
+        // M_p uses M_p-k with k >= 1: update from the highest order down
+        for (unsigned p = N; p >= 2; p--) {
+            // n1 * (delta/n)^p * (n1^(p-1) - (-1)^(p-1))
+            T sum = e[p] * (n1_pow[p] + ((p % 2) ? -n1 : n1));
+            unsigned binomial = 1;
+            for (unsigned k = 1; k + 2 <= p; k++) {
+                binomial = binomial * (p - k + 1) / k;
+                const T term = binomial * e[k] * m(p - k);
+                sum += (k % 2) ? -term : term;
+            }
+            m(p) += sum;
+        }
+    }
+
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        if (!(weight > 0)) {
+            return;
+        }
+        const T n1 = this->weight();
+        _minmax.update(value);
+        this->addWeight(weight);
+        std::array<T, N - 1> none{};
+        merge(n1, weight, value, none);
+    }
+
+    /** add count values, faster than separate updates: the central power
+     * sums of the batch are calculated in independent lanes, which the
+     * compiler can vectorize, and then merged. */
+    void updateBatch(const T *values, size_t count) noexcept {
+        constexpr size_t LANES = 8;
+        if (count == 0) {
+            return;
+        }
+
+        const T n1 = weight();
+        T batch_mean{};
+        for (size_t i = 0; i < count; i++) {
+            _minmax.update(values[i]);
+            batch_mean += values[i];
+        }
+        batch_mean /= count;
+
+        // sums[p - 2][lane] = sum of (x - batch_mean)^p
+        T sums[N - 1][LANES] = {};
+        T residual[N - 1] = {};
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            for (size_t lane = 0; lane < LANES; lane++) {
+                const T delta = values[i + lane] - batch_mean;
+                T power = delta;
+                for (unsigned p = 2; p <= N; p++) {
+                    power *= delta;
+                    sums[p - 2][lane] += power;
+                }
+            }
+        }
+        for (; i < count; i++) {
+            const T delta = values[i] - batch_mean;
+            T power = delta;
+            for (unsigned p = 2; p <= N; p++) {
+                power *= delta;
+                residual[p - 2] += power;
+            }
+        }
+
+        std::array<T, N - 1> batch;
+        for (unsigned p = 2; p <= N; p++) {
+            batch[p - 2] = residual[p - 2];
+            for (size_t lane = 0; lane < LANES; lane++) {
+                batch[p - 2] += sums[p - 2][lane];
+            }
+        }
+        merge(n1, static_cast<T>(count), batch_mean, batch);
+    }
+
+    MomentsNoLock &operator+=(const MomentsNoLock &rhs) noexcept {
+        // copy, rhs is modified when doing a+=a
+        const std::array<T, N - 1> rhs_m = rhs._m;
+        const T n1 = weight();
+        const T n2 = rhs.weight();
+        _minmax += rhs._minmax;
+        this->addWeight(rhs);
+        merge(n1, n2, rhs._mean, rhs_m);
+        return *this;
+    }
+
+    friend inline MomentsNoLock operator+(const MomentsNoLock &lhs,
+                                          const MomentsNoLock &rhs) noexcept {
+        MomentsNoLock result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of measurements */
+    int64_t count() const noexcept { return _minmax.count(); }
+
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept { return this->weightOf(count()); }
+
+    /** return lowest measured value or NAN when there are no measurements */
+    T min() const noexcept { return _minmax.min(); }
+
+    /** return mean of measured values or NAN when there are no measurements */
+    T mean() const noexcept { return (count() == 0) ? NAN : _mean; }
+
+    /** return highest measured value or NAN when there are no measurements */
+    T max() const noexcept { return _minmax.max(); }
+
+    /** sum of (x-x_mean)^p, 2 <= p <= N */
+    T sum_moment(unsigned p) const noexcept {
+        return (p < 2 || p > N) ? NAN : _m[p - 2];
+    }
+
+    /** central moment of order p of a population: sum_moment(p) / weight */
+    T central_moment(unsigned p) const noexcept {
+        return (count() < 1) ? NAN : sum_moment(p) / weight();
+    }
+
+    /** central moment of order p divided by stddev^p, e.g. skew for p=3 */
+    T standardized_moment(unsigned p) const noexcept {
+        return central_moment(p) / pow(variance(), p / T{2});
+    }
+
+    /** variance of a population */
+    T variance() const noexcept { return central_moment(2); }
+
+    /** standard deviation of a population */
+    T stddev() const noexcept { return sqrt(variance()); }
+
+    /** variance of a sample from a population */
+    T sample_variance() const noexcept {
+        return (weight() <= 1) ? NAN : (_m[0] / (weight() - 1));
+    }
+
+    /** standard deviation of a sample of a population */
+    T sample_stddev() const noexcept { return sqrt(sample_variance()); }
+
+    template <unsigned P = N>
+    typename std::enable_if<(P >= 3), T>::type skew() const noexcept {
+        return standardized_moment(3);
+    }
+
+    template <unsigned P = N>
+    typename std::enable_if<(P >= 4), T>::type kurtosis() const noexcept {
+        return standardized_moment(4);
+    }
+
+    template <unsigned P = N>
+    typename std::enable_if<(P >= 4), T>::type
+    excess_kurtosis() const noexcept {
+        return standardized_moment(4) - 3;
+    }
+
+    std::string toString(int precision = -1) const noexcept {
+        Internals::Formatter os(precision);
+        os << "count(" << count() << ") min(" << min() << ") mean(" << mean()
+           << ") max(" << max() << ") sample_stddev(" << sample_stddev()
+           << ")";
+        if (N >= 3) {
+            os << " standardized_moments(";
+            for (unsigned p = 3; p <= N; p++) {
+                os << (p == 3 ? "" : ", ") << p << ": "
+                   << standardized_moment(p);
+            }
+            os << ")";
+        }
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("max", static_cast<double>(max()));
+        visitor.field("sample_stddev", static_cast<double>(sample_stddev()));
+        for (unsigned p = 3; p <= N; p++) {
+            visitor.field("standardized_moment", p,
+                          static_cast<double>(standardized_moment(p)));
+        }
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.write(N);
+        _minmax.serialize(out);
+        this->serializeWeight(out);
+        out.write(_mean);
+        for (T m : _m) {
+            out.write(m);
+        }
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        MomentsNoLock result;
+        unsigned order;
+        if (!in.read(order) || order != N || !result._minmax.deserialize(in) ||
+            !result.deserializeWeight(in) || !in.read(result._mean)) {
+            return false;
+        }
+        for (T &m : result._m) {
+            if (!in.read(m)) {
+                return false;
+            }
+        }
+        *this = result;
+        return true;
+    }
+
+  private:
+    T &m(unsigned p) noexcept { return _m[p - 2]; }
+    T m(unsigned p) const noexcept { return _m[p - 2]; }
+
+    /** merge a set with weight n2, mean2 and sums of (x-mean2)^p m2 into
+     * this set with weight n1, the caller updates the weight */
+    void merge(T n1, T n2, T mean2, const std::array<T, N - 1> &m2) noexcept {
+        const T n = n1 + n2;
+        if (n2 == 0) {
+            return;
+        }
+
+        const T delta = mean2 - _mean;
+        _mean += delta * n2 / n;
+
+        // powers, index = exponent
+        T e[N + 1]; /** (delta/n)^k */
+        T n1_pow[N + 1];
+        T n2_pow[N + 1]; /** (-n2)^k */
+        e[0] = n1_pow[0] = n2_pow[0] = 1;
+        for (unsigned k = 1; k <= N; k++) {
+            e[k] = delta / n * e[k - 1];
+            n1_pow[k] = n1 * n1_pow[k - 1];
+            n2_pow[k] = -n2 * n2_pow[k - 1];
+        }
+
+        for (unsigned p = N; p >= 2; p--) {
+            // n1 * n2 * (delta/n)^p * (n1^(p-1) - (-n2)^(p-1))
+            T sum = m2[p - 2] +
+                    n1 * n2 * e[p] * (n1_pow[p - 1] - n2_pow[p - 1]);
+            unsigned binomial = 1;
+            for (unsigned k = 1; k + 2 <= p; k++) {
+                binomial = binomial * (p - k + 1) / k;
+                sum += binomial * e[k] *
+                       (n2_pow[k] * m(p - k) + n1_pow[k] * m2[p - k - 2]);
+            }
+            m(p) += sum;
+        }
+    }
+
+    MinMaxNoLock<T> _minmax{};
+    T _mean{};
+    std::array<T, N - 1> _m{}; /** _m[p-2] = sum of (x-x_mean)^p */
+};
+
+} // namespace Internals
+
+/** Calculate central moments up to order N >= 2 online, e.g. Moments<6>.
+ * WEIGHTED enables update(value, weight). */
+template <unsigned N, typename T = double, typename M = std::mutex,
+          bool WEIGHTED = false>
+class Moments : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    Moments() = default;
+    ~Moments() override = default;
+
+    Moments(const Moments &other) noexcept {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        _state = other._state;
+    }
+
+    Moments &operator=(const Moments &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        _state = other._state;
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+    }
+
+    void update(T value) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value);
+    }
+
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        lock_guard lock(_mutex);
+        _state.update(value, weight);
+    }
+
+    /** add count values with a single lock */
+    void updateBatch(const T *values, size_t count) noexcept {
+        lock_guard lock(_mutex);
+        _state.updateBatch(values, count);
+    }
+
+    Moments &operator+=(const Moments &rhs) noexcept {
+        // In the very unlikely case that 2 threads simultaneously do a+=b and
+        // b+=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{rhs._mutex, std::defer_lock};
+        if (&rhs == this) {
+            // second lock would deadlock when doing a+=a
+            lock1.lock();
+        } else {
+            std::lock(lock1, lock2);
+        }
+        _state += rhs._state;
+        return *this;
+    }
+
+    friend inline Moments operator+(const Moments &lhs,
+                                    const Moments &rhs) noexcept {
+        Moments result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of measurements */
+    int64_t count() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.weight();
+    }
+
+    /** return lowest measured value or NAN when there are no measurements */
+    T min() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.min();
+    }
+
+    /** return mean of measured values or NAN when there are no measurements */
+    T mean() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.mean();
+    }
+
+    /** return highest measured value or NAN when there are no measurements */
+    T max() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.max();
+    }
+
+    /** central moment of order p of a population, 2 <= p <= N */
+    T central_moment(unsigned p) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.central_moment(p);
+    }
+
+    /** central moment of order p divided by stddev^p, e.g. skew for p=3 */
+    T standardized_moment(unsigned p) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.standardized_moment(p);
+    }
+
+    /** variance of a population */
+    T variance() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.variance();
+    }
+
+    /** standard deviation of a population */
+    T stddev() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.stddev();
+    }
+
+    /** variance of a sample from a population */
+    T sample_variance() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.sample_variance();
+    }
+
+    /** standard deviation of a sample of a population */
+    T sample_stddev() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.sample_stddev();
+    }
+
+    /** return copy of the state, to read many values with a single lock */
+    Internals::MomentsNoLock<N, T, WEIGHTED> state() const noexcept {
+        lock_guard lock(_mutex);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
+    }
+
+  private:
+    Internals::MomentsNoLock<N, T, WEIGHTED> _state{};
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
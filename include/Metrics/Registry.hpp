@@ -2,26 +2,136 @@
 #define METRICS_REGISTRY_HPP
 
 #include "IMetric.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <new>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Metrics {
+/** Typed reference to a metric in a Registry, resolved once. Using it is a
+ * plain pointer dereference. A handle to a metric created in the registry
+ * stays valid until the registry is destroyed, also when the registry is
+ * moved or its name is registered again. A handle to a metric added with
+ * Registry::addMetric() follows the lifetime of its shared_ptr. */
+template <typename T> class Handle {
+  public:
+    /** invalid handle */
+    Handle() = default;
+
+    T *get() const noexcept { return _metric; }
+    T *operator->() const noexcept { return _metric; }
+    T &operator*() const noexcept { return *_metric; }
+    explicit operator bool() const noexcept { return _metric != nullptr; }
+
+  private:
+    friend class Registry;
+    explicit Handle(T *metric) noexcept : _metric(metric) {}
+
+    T *_metric = nullptr;
+};
+
+/** Registry of named metrics. Registering a name again replaces its metric:
+ * a replaced metric added with addMetric() is released by the registry, a
+ * replaced metric created in the arena is kept alive for its handles until
+ * the registry is destroyed. */
 class Registry {
   public:
-    /** add a metric to the registry while sharing ownership */
+    Registry() = default;
+    Registry(const Registry &) = delete;
+    Registry &operator=(const Registry &) = delete;
+
+    /** move all metrics, handles stay valid */
+    Registry(Registry &&other) noexcept { swap(other); }
+
+    Registry &operator=(Registry &&other) noexcept {
+        Registry(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~Registry() {
+        // destroy metrics created in the arena, newest first
+        for (auto it = _owned.rbegin(); it != _owned.rend(); ++it) {
+            (*it)->~IMetric();
+        }
+    }
+
+    /** add a metric to the registry while sharing ownership. A metric it
+     * replaces is released by the registry. */
     void addMetric(const std::string &name, std::shared_ptr<IMetric> metric) {
-        _registry[name] = std::move(metric);
+        IMetric *pointer = metric.get();
+        insert(name, pointer, std::move(metric));
+    }
+
+    /** create a metric of type T with constructor arguments args in the
+     * arena of the registry, and return a handle to it. Metrics created one
+     * after the other are stored next to each other. */
+    template <typename T, typename... Args>
+    Handle<T> create(const std::string &name, Args &&...args) {
+        _owned.reserve(_owned.size() + 1);
+        void *memory = allocate(sizeof(T), alignof(T));
+        T *metric = new (memory) T(std::forward<Args>(args)...);
+        _owned.push_back(metric);
+        insert(name, metric, nullptr);
+        return Handle<T>(metric);
     }
 
+    /** return a handle to metric name, or an invalid handle when there is no
+     * metric name of type T */
+    template <typename T> Handle<T> find(const std::string &name) const {
+        const auto it = lowerBound(name);
+        if (it == _metrics.end() || it->name != name) {
+            return Handle<T>();
+        }
+        return Handle<T>(dynamic_cast<T *>(it->metric));
+    }
+
+    /** return no of registered metrics */
+    size_t size() const noexcept { return _metrics.size(); }
+
     std::map<std::string, std::string> reportMap(int precision = -1) {
         std::map<std::string, std::string> result = {};
-        for (const auto &x : _registry) {
-            result[x.first] = x.second->toString(precision);
-        }
+        reportMap(result, precision);
         return result;
     }
 
+    /** report into an existing map, e.g. the map of the previous report:
+     * entries of metrics which are still registered are updated in place,
+     * so a periodic report does not allocate map nodes. Histograms and
+     * timers keep their snapshot to reuse it in the next report, see
+     * IMetric::reuseSnapshots(). */
+    void reportMap(std::map<std::string, std::string> &result,
+                   int precision = -1) {
+        auto it = result.begin();
+        for (const auto &x : _metrics) {
+            // both are sorted: drop entries of removed metrics
+            while (it != result.end() && it->first < x.name) {
+                it = result.erase(it);
+            }
+            if (it == result.end() || it->first != x.name) {
+                it = result.emplace_hint(it, x.name, std::string());
+            }
+            x.metric->reuseSnapshots();
+            it->second = x.metric->toString(precision);
+            ++it;
+        }
+        result.erase(it, result.end());
+    }
+
+    /** pass the fields of all metrics to visitor, sorted on name, without
+     * building strings */
+    void visit(IMetricVisitor &visitor) const {
+        for (const auto &x : _metrics) {
+            visitor.beginMetric(x.name);
+            x.metric->visit(visitor);
+            visitor.endMetric();
+        }
+    }
+
     std::string reportString(int precision = -1) {
         auto map = reportMap(precision);
         std::string result;
@@ -32,13 +142,74 @@ class Registry {
     }
 
     void resetMetrics() {
-        for (const auto &x : _registry) {
-            x.second->reset();
+        for (const auto &x : _metrics) {
+            x.metric->reset();
         }
     }
 
   private:
-    std::map<std::string, std::shared_ptr<IMetric>> _registry{};
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    /** a registered metric, shared is empty for metrics in the arena */
+    struct Entry {
+        std::string name;
+        IMetric *metric;
+        std::shared_ptr<IMetric> shared;
+    };
+
+    std::vector<Entry>::const_iterator
+    lowerBound(const std::string &name) const {
+        return std::lower_bound(
+            _metrics.begin(), _metrics.end(), name,
+            [](const Entry &entry, const std::string &key) {
+                return entry.name < key;
+            });
+    }
+
+    /** add or replace metric name, a replaced shared metric is released */
+    void insert(const std::string &name, IMetric *metric,
+                std::shared_ptr<IMetric> shared) {
+        const auto index = lowerBound(name) - _metrics.begin();
+        if (index < static_cast<ptrdiff_t>(_metrics.size()) &&
+            _metrics[index].name == name) {
+            _metrics[index].metric = metric;
+            _metrics[index].shared = std::move(shared);
+            return;
+        }
+        _metrics.insert(_metrics.begin() + index,
+                        Entry{name, metric, std::move(shared)});
+    }
+
+    void swap(Registry &other) noexcept {
+        _metrics.swap(other._metrics);
+        _owned.swap(other._owned);
+        _chunks.swap(other._chunks);
+        std::swap(_chunkCurrent, other._chunkCurrent);
+        std::swap(_chunkEnd, other._chunkEnd);
+    }
+
+    /** bump allocation in chunks, released by the destructor */
+    void *allocate(size_t size, size_t alignment) {
+        uintptr_t aligned = (_chunkCurrent + alignment - 1) &
+                            ~static_cast<uintptr_t>(alignment - 1);
+        if (_chunks.empty() || aligned + size > _chunkEnd) {
+            const size_t chunkSize =
+                (size + alignment > CHUNK_SIZE) ? size + alignment : CHUNK_SIZE;
+            _chunks.emplace_back(new char[chunkSize]);
+            _chunkCurrent = reinterpret_cast<uintptr_t>(_chunks.back().get());
+            _chunkEnd = _chunkCurrent + chunkSize;
+            aligned = (_chunkCurrent + alignment - 1) &
+                      ~static_cast<uintptr_t>(alignment - 1);
+        }
+        _chunkCurrent = aligned + size;
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    std::vector<Entry> _metrics{}; /** sorted on name */
+    std::vector<IMetric *> _owned{};
+    std::vector<std::unique_ptr<char[]>> _chunks{};
+    uintptr_t _chunkCurrent = 0;
+    uintptr_t _chunkEnd = 0;
 };
 
 } // namespace Metrics
@@ -0,0 +1,374 @@
+#ifndef METRICS_ROLLINGVARIANCE_HPP
+#define METRICS_ROLLINGVARIANCE_HPP
+
+#include "Binary.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+namespace Internals {
+/** Fixed capacity queue of (sequence no, value) with monotonic values, used
+ * for the extreme value of a sliding window in amortized O(1). With
+ * C = std::greater the front is the maximum, with std::less the minimum. */
+template <typename T, typename C> class MonotonicQueue {
+  public:
+    explicit MonotonicQueue(unsigned n) : _entries(n) {}
+
+    void reset() noexcept {
+        _first = 0;
+        _size = 0;
+    }
+
+    /** add a value, drops all values which can never become the extreme */
+    void push(uint64_t seq, T value) noexcept {
+        while (_size > 0 && !C()(_entries[index(_size - 1)].value, value)) {
+            _size--;
+        }
+        _entries[index(_size)] = {seq, value};
+        _size++;
+    }
+
+    /** drop all values with a sequence no lower than oldest */
+    void expire(uint64_t oldest) noexcept {
+        while (_size > 0 && _entries[_first].seq < oldest) {
+            _first = index(1);
+            _size--;
+        }
+    }
+
+    T front() const noexcept { return _entries[_first].value; }
+
+  private:
+    struct Entry {
+        uint64_t seq;
+        T value;
+    };
+
+    unsigned index(unsigned offset) const noexcept {
+        const unsigned i = _first + offset;
+        return (i >= _entries.size()) ? i - _entries.size() : i;
+    }
+
+    std::vector<Entry> _entries;
+    unsigned _first = 0;
+    unsigned _size = 0;
+};
+
+/** Calculate 2nd order statistics of the last n samples. A new sample is
+ * added and the evicted sample is removed with (reverse) Welford steps. The
+ * rounding errors of the removals accumulate, so every n evictions mean and
+ * m2 are recalculated from the window, which is O(1) amortized. */
+template <typename T = double> class RollingVarianceNoLock {
+  public:
+    /** n = window size, a window of size 0 keeps no samples */
+    explicit RollingVarianceNoLock(unsigned n)
+        : _window(n), _min(n), _max(n) {}
+
+    void reset() noexcept {
+        _writePosition = 0;
+        _count = 0;
+        _evictions = 0;
+        _seq = 0;
+        _mean = {};
+        _m2 = {};
+        _min.reset();
+        _max.reset();
+    }
+
+    void update(T value) noexcept {
+        const bool full = (_count == _window.size());
+        if (full) {
+            if (_count == 0) {
+                return;
+            }
+            remove(_window[_writePosition]);
+        }
+        _window[_writePosition] = value;
+        _writePosition++;
+        if (_writePosition == _window.size()) {
+            _writePosition = 0;
+        }
+
+        _count++;
+        const T delta = value - _mean;
+        _mean += delta / _count;
+        _m2 += delta * (value - _mean);
+        if (full && ++_evictions == _window.size()) {
+            _evictions = 0;
+            recalculate();
+        }
+
+        _seq++;
+        if (_seq > _window.size()) {
+            // oldest sample in the window after adding this one
+            const uint64_t oldest = _seq + 1 - _window.size();
+            _min.expire(oldest);
+            _max.expire(oldest);
+        }
+        _min.push(_seq, value);
+        _max.push(_seq, value);
+    }
+
+    /** return window size */
+    unsigned size() const noexcept { return _window.size(); }
+
+    /** return no of measurements in the window */
+    int64_t count() const noexcept { return _count; }
+
+    /** return lowest value in the window or NAN when there are no
+     * measurements */
+    T min() const noexcept { return (_count == 0) ? NAN : _min.front(); }
+
+    /** return mean of the window or NAN when there are no measurements */
+    T mean() const noexcept { return (_count == 0) ? NAN : _mean; }
+
+    /** return highest value in the window or NAN when there are no
+     * measurements */
+    T max() const noexcept { return (_count == 0) ? NAN : _max.front(); }
+
+    /** second order moment: sum of (x-x_mean)^2 */
+    T m2() const noexcept { return _m2; }
+
+    /** return variance of a population or NAN when there are no measurements */
+    T variance() const noexcept {
+        return (_count < 1) ? NAN : (_m2 / _count);
+    }
+
+    /** standard deviation of a population */
+    T stddev() const noexcept { return sqrt(variance()); }
+
+    /** variance of a sample from a population */
+    T sample_variance() const noexcept {
+        return (_count < 2) ? NAN : (_m2 / (_count - 1));
+    }
+
+    /** standard deviation of a sample of a population */
+    T sample_stddev() const noexcept { return sqrt(sample_variance()); }
+
+    /** RMS value of the samples */
+    T rms() const noexcept {
+        return (_count < 1) ? NAN : sqrt(_mean * _mean + _m2 / _count);
+    }
+
+    std::string toString(int precision = -1) const noexcept {
+        Internals::Formatter os(precision);
+        os << "count(" << count() << ") min(" << min() << ") mean(" << mean()
+           << ") max(" << max() << ") sample_stddev(" << sample_stddev()
+           << ")";
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("max", static_cast<double>(max()));
+        visitor.field("sample_stddev", static_cast<double>(sample_stddev()));
+    }
+
+    /** append the values in the window to out, oldest first, see
+     * Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        const unsigned n = _window.size();
+        out.write(_count);
+        for (unsigned i = 0; i < _count; i++) {
+            const unsigned index = _writePosition + n - _count + i;
+            out.write(_window[(index >= n) ? index - n : index]);
+        }
+    }
+
+    /** decode values written by serialize() and replay them, a smaller
+     * window keeps the newest values. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) {
+        size_t count;
+        if (!in.readCount(count)) {
+            return false;
+        }
+        RollingVarianceNoLock result(size());
+        for (size_t i = 0; i < count; i++) {
+            T value;
+            if (!in.read(value)) {
+                return false;
+            }
+            result.update(value);
+        }
+        *this = std::move(result);
+        return true;
+    }
+
+  private:
+    /** reverse Welford step */
+    void remove(T value) noexcept {
+        _count--;
+        if (_count == 0) {
+            _mean = {};
+            _m2 = {};
+            return;
+        }
+        const T delta = value - _mean;
+        _mean -= delta / _count;
+        _m2 -= delta * (value - _mean);
+        if (_m2 < 0) {
+            // rounding errors
+            _m2 = {};
+        }
+    }
+
+    /** two pass calculation of mean and m2 of the full window */
+    void recalculate() noexcept {
+        T sum{};
+        for (T x : _window) {
+            sum += x;
+        }
+        _mean = sum / _count;
+        T m2{};
+        for (T x : _window) {
+            const T delta = x - _mean;
+            m2 += delta * delta;
+        }
+        _m2 = m2;
+    }
+
+    std::vector<T> _window;
+    unsigned _writePosition = 0;
+    unsigned _count = 0;
+    unsigned _evictions = 0; /** since the last recalculation */
+    uint64_t _seq = 0; /** sequence no of the last sample, starts at 1 */
+    T _mean{};
+    T _m2{};
+    MonotonicQueue<T, std::less<T>> _min;
+    MonotonicQueue<T, std::greater<T>> _max;
+};
+
+} // namespace Internals
+
+/** Calculate 2nd order statistics of the last n samples */
+template <typename T = double, typename M = std::mutex>
+class RollingVariance : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    /** n = window size */
+    explicit RollingVariance(unsigned n) : _state(n) {}
+    ~RollingVariance() override = default;
+
+    RollingVariance(const RollingVariance &other) noexcept : _state(0) {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        _state = other._state;
+    }
+
+    RollingVariance &operator=(const RollingVariance &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        _state = other._state;
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+    }
+
+    void update(T value) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value);
+    }
+
+    /** return window size */
+    unsigned size() const noexcept { return _state.size(); }
+
+    /** return no of measurements in the window */
+    int64_t count() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return lowest value in the window or NAN when there are no
+     * measurements */
+    T min() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.min();
+    }
+
+    /** return mean of the window or NAN when there are no measurements */
+    T mean() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.mean();
+    }
+
+    /** return highest value in the window or NAN when there are no
+     * measurements */
+    T max() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.max();
+    }
+
+    /** second order moment: sum of (x-x_mean)^2 */
+    T m2() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.m2();
+    }
+
+    /** return variance of a population or NAN when there are no measurements */
+    T variance() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.variance();
+    }
+
+    /** standard deviation of a population */
+    T stddev() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.stddev();
+    }
+
+    /** variance of a sample from a population */
+    T sample_variance() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.sample_variance();
+    }
+
+    /** standard deviation of a sample of a population */
+    T sample_stddev() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.sample_stddev();
+    }
+
+    /** RMS value of the samples */
+    T rms() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.rms();
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        lock_guard lock(_mutex);
+        return _state.toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        lock_guard lock(_mutex);
+        _state.visit(visitor);
+    }
+
+  private:
+    Internals::RollingVarianceNoLock<T> _state;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
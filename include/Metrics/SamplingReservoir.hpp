@@ -3,93 +3,354 @@
 
 /* Reservoir sampling in C++
    https://en.wikipedia.org/wiki/Reservoir_sampling
+   Weighted: Efraimidis and Spirakis, Weighted random sampling with a
+   reservoir - https://doi.org/10.1016/j.ipl.2005.11.003
 */
 
+#include "Codec.hpp"
 #include "IReservoir.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <mutex>
 #include <random>
+#include <utility>
 #include <vector>
 
 namespace Metrics {
-/** create sample reservoir on a stream of data */
-template <typename T = double, typename M = std::mutex>
-class SamplingReservoir : public IReservoir<T> {
+namespace Internals {
+/** Reservoir sampling on storage S, e.g. a std::vector or std::array of the
+ * values encoded by codec E. Unweighted updates use algorithm L, weighted
+ * updates algorithm A-ExpJ. A is the allocator of the keys of weighted
+ * sampling and of the snapshots. The codec is a base class, so an empty
+ * codec takes no memory. */
+template <typename T, typename E, typename S, typename A>
+class SamplingReservoirNoLock : private E {
   public:
-    explicit SamplingReservoir(unsigned n)
-        : _distribution_index(0, n - 1), _reservoir(n) {
-        reinitialize();
+    /** storageArgs are the constructor arguments of the storage */
+    template <typename... Args>
+    SamplingReservoirNoLock(E codec, const A &alloc, Args &&...storageArgs)
+        : E(codec), _storage(std::forward<Args>(storageArgs)...),
+          _heap(EntryAllocator(alloc)) {
+        reset();
     }
 
-    void reset() noexcept override {
-        const std::lock_guard<M> lock(_mutex);
-        reinitialize();
+    void reset() noexcept {
+        _count = 0;
+        _heap.clear();
+
+        const unsigned n = size();
+        _next = n - 1;
+        _w = std::exp(std::log(getRandom()) / n);
+        skip();
     }
 
     /** Update reservoir using fast algorithm L */
-    void update(T value) noexcept override {
-        const std::lock_guard<M> lock(_mutex);
-        auto n = static_cast<unsigned>(_reservoir.size());
-        if (_count < n) {
-            _reservoir[_count] = value;
+    void update(T value) noexcept {
+        if (weighted()) {
+            updateWeighted(value, 1.0);
+            return;
+        }
+        if (_count < size()) {
+            _storage[_count] = codec().encode(value);
         } else if (_count == _next) {
-            int index = _distribution_index(_random);
-            _reservoir[index] = value;
+            std::uniform_int_distribution<unsigned> index(0, size() - 1);
+            _storage[index(_random)] = codec().encode(value);
             skip();
         }
         _count++;
     }
 
+    /** Update reservoir with a weighted value using algorithm A-ExpJ: a
+     * value with weight w is w times more likely to be sampled than a value
+     * with weight 1. Values with weight <= 0 are ignored. The first weighted
+     * update switches the reservoir to weighted sampling until reset. */
+    void update(T value, double weight) noexcept {
+        if (!(weight > 0)) {
+            return;
+        }
+        if (!weighted()) {
+            toWeighted();
+        }
+        updateWeighted(value, weight);
+    }
+
     unsigned count() const noexcept { return _count; }
-    unsigned size() const noexcept override { return _reservoir.size(); }
-    unsigned samples() const noexcept override {
-        const std::lock_guard<M> lock(_mutex);
-        return samples_nolock();
+    unsigned size() const noexcept {
+        return static_cast<unsigned>(_storage.size());
+    }
+    unsigned samples() const noexcept {
+        return (_count < size()) ? _count : size();
+    }
+    /** return stored values, or nullptr when they are encoded */
+    const T *data() const noexcept {
+        return ValuesOf<T, typename E::Stored>::data(_storage.data());
     }
-    const T *data() const noexcept override { return _reservoir.data(); }
 
-    Snapshot<T> getSnapshot() const noexcept override {
-        const std::lock_guard<M> lock(_mutex);
-        return Snapshot<T>(_reservoir.cbegin(),
-                           _reservoir.cbegin() + samples_nolock());
+    /** return the allocator of the snapshots */
+    A allocator() const noexcept { return A(_heap.get_allocator()); }
+
+    /** append the decoded samples to out */
+    template <typename B> void decodeTo(std::vector<T, B> &out) const {
+        Internals::decode(codec(), _storage.cbegin(),
+                          _storage.cbegin() + samples(), out);
+    }
+
+    /** append the no of updates and the samples to out. With weighted
+     * sampling, the keys of the samples are included. */
+    void serialize(BinaryWriter &out) const {
+        out.write(_count);
+        out.write(weighted());
+        out.write(samples());
+        for (unsigned i = 0; i < samples(); i++) {
+            out.write(codec().decode(_storage[i]));
+        }
+        for (const auto &entry : _heap) {
+            out.write(entry.slot);
+            out.write(entry.key);
+        }
+    }
+
+    /** replace the samples by samples written by serialize() of a reservoir
+     * of the same size, sampling continues as if all updates were done on
+     * this reservoir. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) {
+        unsigned count;
+        bool weighted;
+        size_t samples;
+        if (!in.read(count) || !in.read(weighted) || !in.readCount(samples) ||
+            samples != std::min<size_t>(count, size())) {
+            return false;
+        }
+        // check on a copy of the reader, then decode in place
+        BinaryReader check = in;
+        T value;
+        for (size_t i = 0; i < samples; i++) {
+            if (!check.read(value)) {
+                in = check;
+                return false;
+            }
+        }
+        std::vector<bool> used(weighted ? samples : 0);
+        Entry entry;
+        for (size_t i = 0; i < used.size(); i++) {
+            if (!check.read(entry.slot) || !check.read(entry.key) ||
+                entry.slot >= samples || used[entry.slot]) {
+                in = check;
+                return false;
+            }
+            used[entry.slot] = true;
+        }
+
+        reset();
+        _count = count;
+        for (size_t i = 0; i < samples; i++) {
+            in.read(value);
+            _storage[i] = codec().encode(value);
+        }
+        if (weighted) {
+            _heap.resize(samples);
+            for (auto &x : _heap) {
+                in.read(x.slot);
+                in.read(x.key);
+            }
+            std::make_heap(_heap.begin(), _heap.end(), compare);
+            if (samples == size()) {
+                skipWeighted();
+            }
+        } else if (count >= size()) {
+            // W of algorithm L after count values is the n-th lowest of
+            // count uniform keys: Beta(n, count - n + 1) distributed
+            std::gamma_distribution<> a(size());
+            std::gamma_distribution<> b(count - size() + 1);
+            const double x = a(_random);
+            _w = x / (x + b(_random));
+            _next = count - 1;
+            skip();
+        }
+        return true;
     }
 
   private:
+    /** log of the key of a sample in the reservoir, and its index in
+     * _storage */
+    struct Entry {
+        double key;
+        unsigned slot;
+    };
+
+    using EntryAllocator =
+        typename std::allocator_traits<A>::template rebind_alloc<Entry>;
+
+    /** ordering for a min-heap on key */
+    static bool compare(const Entry &lhs, const Entry &rhs) noexcept {
+        return lhs.key > rhs.key;
+    }
+
+    const E &codec() const noexcept { return *this; }
+
+    /** weighted sampling keeps the keys of the samples */
+    bool weighted() const noexcept { return !_heap.empty(); }
+
     /** get a random number in range ]0:1[ */
     double getRandom() noexcept {
+        std::uniform_real_distribution<> distribution(0.0, 1.0);
         double r;
         do {
-            r = _distribution_real(_random);
+            r = distribution(_random);
         } while (r == 0.0);
         return r;
     }
 
     void skip() noexcept {
         _next += std::floor(std::log(getRandom()) / std::log(1 - _w)) + 1;
-        _w *= std::exp(std::log(getRandom()) / _reservoir.size());
+        _w *= std::exp(std::log(getRandom()) / size());
     }
 
-    /** non-virtual function to initialize, can be caled from constructor */
-    void reinitialize() noexcept {
-        _count = 0;
+    /** A-ExpJ: a value gets key u^(1/weight), the reservoir keeps the values
+     * with the largest keys. Keys are stored as logarithm to avoid underflow
+     * with large weights. Instead of drawing a key for each value, the weight
+     * to skip before the next insertion is drawn. */
+    void updateWeighted(T value, double weight) noexcept {
+        if (_heap.size() < size()) {
+            auto slot = static_cast<unsigned>(_heap.size());
+            _storage[slot] = codec().encode(value);
+            _heap.push_back({std::log(getRandom()) / weight, slot});
+            std::push_heap(_heap.begin(), _heap.end(), compare);
+            if (_heap.size() == size()) {
+                skipWeighted();
+            }
+        } else {
+            _w -= weight;
+            if (_w <= 0) {
+                // key is uniform in ]threshold^weight, 1[, so above threshold
+                const double t = std::exp(_heap.front().key * weight);
+                const double key = std::log(t + (1 - t) * getRandom()) / weight;
+                std::pop_heap(_heap.begin(), _heap.end(), compare);
+                _storage[_heap.back().slot] = codec().encode(value);
+                _heap.back().key = key;
+                std::push_heap(_heap.begin(), _heap.end(), compare);
+                skipWeighted();
+            }
+        }
+        _count++;
+    }
 
-        auto n = static_cast<int>(_reservoir.size());
-        _next = n - 1;
-        _w = std::exp(std::log(getRandom()) / n);
-        skip();
+    void skipWeighted() noexcept {
+        _w = std::log(getRandom()) / _heap.front().key;
     }
 
-    unsigned samples_nolock() const noexcept {
-        return (count() < size()) ? count() : size();
+    /** assign keys to the samples of algorithm L: the keys of the m values
+     * with weight 1 seen so far are the largest of m uniform keys */
+    void toWeighted() noexcept {
+        const unsigned samples = this->samples();
+        _heap.clear();
+        double key = 0.0;
+        for (unsigned i = 0; i < samples; i++) {
+            key += std::log(getRandom()) / (_count - i);
+            _heap.push_back({key, i});
+        }
+        // samples are exchangeable, any sample can have the largest key
+        for (unsigned i = samples; i > 1; i--) {
+            std::uniform_int_distribution<unsigned> pick(0, i - 1);
+            std::swap(_heap[i - 1].slot, _heap[pick(_random)].slot);
+        }
+        std::make_heap(_heap.begin(), _heap.end(), compare);
+        if (samples == size()) {
+            skipWeighted();
+        }
     }
 
     unsigned _count{};
     unsigned _next{};
+    /** W of algorithm L, or with weighted sampling the weight to skip before
+     * the next insertion */
     double _w{};
     /// Fast random generator, seeded
     std::minstd_rand _random{std::random_device{}()};
-    std::uniform_real_distribution<> _distribution_real{0.0, 1.0};
-    std::uniform_int_distribution<> _distribution_index;
-    std::vector<T> _reservoir;
+    S _storage;
+    std::vector<Entry, EntryAllocator> _heap; /** keys of weighted sampling */
+};
+
+} // namespace Internals
+
+/** create sample reservoir on a stream of data. E is the codec of the stored
+ * values, e.g. NarrowCodec<double> to store doubles as floats. A is the
+ * allocator of the stored values and the snapshots. */
+template <typename T = double, typename M = std::mutex,
+          typename E = IdentityCodec<T>, typename A = std::allocator<T>>
+class SamplingReservoir : public IReservoir<T, A> {
+    using Stored = typename E::Stored;
+    using StoredAllocator =
+        typename std::allocator_traits<A>::template rebind_alloc<Stored>;
+    using Storage = std::vector<Stored, StoredAllocator>;
+
+  public:
+    explicit SamplingReservoir(unsigned n, E codec = E(), const A &alloc = A())
+        : _state(codec, alloc, n, Stored{}, StoredAllocator(alloc)) {}
+
+    void reset() noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.reset();
+    }
+
+    /** Update reservoir using fast algorithm L */
+    void update(T value) noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.update(value);
+    }
+
+    /** Update reservoir with a weighted value using algorithm A-ExpJ: a
+     * value with weight w is w times more likely to be sampled than a value
+     * with weight 1. Values with weight <= 0 are ignored. The first weighted
+     * update switches the reservoir to weighted sampling until reset. */
+    void update(T value, double weight) noexcept {
+        const std::lock_guard<M> lock(_mutex);
+        _state.update(value, weight);
+    }
+
+    unsigned count() const noexcept { return _state.count(); }
+    unsigned size() const noexcept override { return _state.size(); }
+    unsigned samples() const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        return _state.samples();
+    }
+    /** return stored values, or nullptr when they are encoded */
+    const T *data() const noexcept override { return _state.data(); }
+
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(_state.allocator());
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        out.fill(
+            [this](std::vector<T, A> &values) { _state.decodeTo(values); });
+    }
+
+    /** append the no of updates and the samples to out. With weighted
+     * sampling, the keys of the samples are included. */
+    void serialize(BinaryWriter &out) const override {
+        const std::lock_guard<M> lock(_mutex);
+        _state.serialize(out);
+    }
+
+    /** replace the samples by samples written by serialize() of a reservoir
+     * of the same size, sampling continues as if all updates were done on
+     * this reservoir. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) override {
+        const std::lock_guard<M> lock(_mutex);
+        return _state.deserialize(in);
+    }
+
+  private:
+    Internals::SamplingReservoirNoLock<T, E, Storage, A> _state;
     mutable M _mutex{};
 };
 
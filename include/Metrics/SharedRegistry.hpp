@@ -0,0 +1,472 @@
+#ifndef METRICS_SHAREDREGISTRY_HPP
+#define METRICS_SHAREDREGISTRY_HPP
+
+/* Registry in POSIX shared memory (shm_open + mmap), e.g. /dev/shm/<name> on
+   Linux. Layout of the file:
+   - SharedHeader
+   - directory of SharedHeader::capacity SharedEntry
+   - data area with the states, a state is never moved
+   All fields are written by one process and read by any other process on
+   the same host, compiled with the same version of this header. */
+
+#include "EwmaVariance.hpp"
+#include "Kurtosis.hpp"
+#include "LinearRegression.hpp"
+#include "MinMax.hpp"
+#include "MinMeanMax.hpp"
+#include "Moments.hpp"
+#include "Variance.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace Metrics {
+namespace Internals {
+/** type of a state in the directory, only these types can be decoded by
+ * SharedRegistryReader */
+template <typename S> struct SharedStateType;
+
+template <> struct SharedStateType<MinMaxNoLock<double>> {
+    static const char *name() noexcept { return "MinMax"; }
+};
+template <> struct SharedStateType<MinMeanMaxNoLock<double>> {
+    static const char *name() noexcept { return "MinMeanMax"; }
+};
+template <> struct SharedStateType<VarianceNoLock<double>> {
+    static const char *name() noexcept { return "Variance"; }
+};
+template <> struct SharedStateType<KurtosisNoLock<double>> {
+    static const char *name() noexcept { return "Kurtosis"; }
+};
+template <> struct SharedStateType<LinearRegressionNoLock<double>> {
+    static const char *name() noexcept { return "LinearRegression"; }
+};
+template <> struct SharedStateType<EwmaVarianceNoLock<double>> {
+    static const char *name() noexcept { return "EwmaVariance"; }
+};
+template <> struct SharedStateType<MomentsNoLock<4, double>> {
+    static const char *name() noexcept { return "Moments4"; }
+};
+
+struct SharedHeader {
+    static constexpr uint32_t MAGIC = 0x5352544d; /** "MTRS" */
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity; /** no of entries in the directory */
+    uint32_t size;     /** size of the file */
+    std::atomic<uint32_t> entries; /** no of published entries */
+    uint32_t reserved;
+};
+
+/** directory entry, published by incrementing SharedHeader::entries */
+struct SharedEntry {
+    static constexpr unsigned MAX_RETRIES = 1000;
+
+    /** odd while the state is written */
+    std::atomic<uint32_t> sequence;
+    uint32_t offset; /** of the state from the start of the file */
+    uint32_t size;   /** sizeof the state */
+    char type[20];
+    char name[96];
+
+    void beginWrite() noexcept {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite() noexcept {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+    }
+
+    /** copy a consistent version of the state at base + offset into out,
+     * false when the writer did not finish an update in time, e.g. because
+     * it died during the update */
+    bool read(const uint8_t *base, void *out) const noexcept {
+        for (unsigned i = 0; i < MAX_RETRIES; i++) {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                std::memcpy(out, base + offset, size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    return true;
+                }
+            }
+            std::this_thread::yield();
+        }
+        return false;
+    }
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "shared memory needs lock free atomics");
+static_assert(sizeof(SharedHeader) == 24, "layout of SharedHeader changed");
+static_assert(sizeof(SharedEntry) == 128, "layout of SharedEntry changed");
+
+/** copy value into a fixed size field, zero padded */
+template <size_t N>
+void copyField(char (&field)[N], const std::string &value,
+               const char *what) {
+    if (value.size() >= N) {
+        throw std::length_error(std::string(what) + " too long: " + value);
+    }
+    std::memset(field, 0, N);
+    std::memcpy(field, value.data(), value.size());
+}
+
+template <size_t N> std::string readField(const char (&field)[N]) {
+    return std::string(field, strnlen(field, N));
+}
+
+/** read entry as state S and format it into out, false when entry has
+ * another type */
+template <typename S>
+bool formatShared(const SharedEntry &entry, const uint8_t *base,
+                  int precision, std::string &out) {
+    if (readField(entry.type) != SharedStateType<S>::name() ||
+        entry.size != sizeof(S)) {
+        return false;
+    }
+    S state;
+    out = entry.read(base, &state) ? state.toString(precision) : "(busy)";
+    return true;
+}
+
+inline std::string formatShared(const SharedEntry &entry, const uint8_t *base,
+                                int precision) {
+    std::string result;
+    if (formatShared<MinMaxNoLock<double>>(entry, base, precision, result) ||
+        formatShared<MinMeanMaxNoLock<double>>(entry, base, precision,
+                                               result) ||
+        formatShared<VarianceNoLock<double>>(entry, base, precision,
+                                             result) ||
+        formatShared<KurtosisNoLock<double>>(entry, base, precision,
+                                             result) ||
+        formatShared<LinearRegressionNoLock<double>>(entry, base, precision,
+                                                     result) ||
+        formatShared<EwmaVarianceNoLock<double>>(entry, base, precision,
+                                                 result) ||
+        formatShared<MomentsNoLock<4, double>>(entry, base, precision,
+                                               result)) {
+        return result;
+    }
+    return "(unknown type " + readField(entry.type) + ")";
+}
+
+/** mapping of a shared memory object, unmapped and closed on destruction */
+class SharedMapping {
+  public:
+    SharedMapping() = default;
+    SharedMapping(const SharedMapping &) = delete;
+    SharedMapping &operator=(const SharedMapping &) = delete;
+
+    ~SharedMapping() {
+        if (_data != nullptr) {
+            munmap(_data, _size);
+        }
+        if (_fd >= 0) {
+            close(_fd);
+        }
+    }
+
+    /** create object name with size bytes, mapped read-write. Fails when
+     * the object exists already: truncating an object which another
+     * process has mapped crashes that process. */
+    void create(const std::string &name, size_t size) {
+        _fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (_fd < 0) {
+            if (errno == EEXIST) {
+                throw std::system_error(EEXIST, std::generic_category(),
+                                        "shared registry " + name +
+                                            " exists already");
+            }
+            throwError("shm_open " + name);
+        }
+        if (ftruncate(_fd, static_cast<off_t>(size)) != 0) {
+            const int error = errno;
+            shm_unlink(name.c_str());
+            errno = error;
+            throwError("ftruncate " + name);
+        }
+        map(size, PROT_READ | PROT_WRITE, name);
+    }
+
+    /** map existing object name read-only */
+    void open(const std::string &name) {
+        _fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (_fd < 0) {
+            throwError("shm_open " + name);
+        }
+        struct stat info;
+        if (fstat(_fd, &info) != 0) {
+            throwError("fstat " + name);
+        }
+        map(static_cast<size_t>(info.st_size), PROT_READ, name);
+    }
+
+    uint8_t *data() const noexcept { return _data; }
+    size_t size() const noexcept { return _size; }
+
+  private:
+    static void throwError(const std::string &what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    void map(size_t size, int protection, const std::string &name) {
+        void *data = mmap(nullptr, size, protection, MAP_SHARED, _fd, 0);
+        if (data == MAP_FAILED) {
+            throwError("mmap " + name);
+        }
+        _data = static_cast<uint8_t *>(data);
+        _size = size;
+    }
+
+    int _fd = -1;
+    uint8_t *_data = nullptr;
+    size_t _size = 0;
+};
+
+} // namespace Internals
+
+/** Reference to a state in a SharedRegistry. Updates are visible to readers
+ * in other processes, which get consistent copies through the sequence
+ * counter of the entry. */
+template <typename S, typename M = std::mutex> class SharedHandle {
+  public:
+    /** invalid handle */
+    SharedHandle() = default;
+
+    /** update the state, e.g. update(value) or update(value, weight) */
+    template <typename... Args> void update(Args &&...args) noexcept {
+        const std::lock_guard<M> lock(*_mutex);
+        _entry->beginWrite();
+        _state->update(std::forward<Args>(args)...);
+        _entry->endWrite();
+    }
+
+    void reset() noexcept {
+        const std::lock_guard<M> lock(*_mutex);
+        _entry->beginWrite();
+        _state->reset();
+        _entry->endWrite();
+    }
+
+    /** return a copy of the state */
+    S state() const noexcept {
+        const std::lock_guard<M> lock(*_mutex);
+        return *_state;
+    }
+
+    explicit operator bool() const noexcept { return _state != nullptr; }
+
+  private:
+    template <typename> friend class SharedRegistry;
+    SharedHandle(S *state, Internals::SharedEntry *entry, M *mutex) noexcept
+        : _state(state), _entry(entry), _mutex(mutex) {}
+
+    S *_state = nullptr;
+    Internals::SharedEntry *_entry = nullptr;
+    M *_mutex = nullptr;
+};
+
+/** Registry with the metric states in shared memory, so another process can
+ * compute the report, e.g. with SharedRegistryReader or the ShmReader tool.
+ * Only NoLock states with a Internals::SharedStateType can be stored. The
+ * shared memory object is removed when the registry is destroyed. */
+template <typename M = std::mutex> class SharedRegistry {
+  public:
+    /** create shared memory object name, e.g. "/myservice.metrics", with
+     * room for capacity metrics and dataSize bytes of states. Throws
+     * std::system_error when name exists already, e.g. when it is used by
+     * another registry or was left behind by a crashed process: remove a
+     * stale object with shm_unlink, or from /dev/shm on Linux. */
+    explicit SharedRegistry(const std::string &name, unsigned capacity = 256,
+                            size_t dataSize = 64 * 1024)
+        : _name(name) {
+        const size_t size = sizeof(Internals::SharedHeader) +
+                            capacity * sizeof(Internals::SharedEntry) +
+                            dataSize;
+        if (size > UINT32_MAX) {
+            throw std::length_error("shared registry too large");
+        }
+        _mapping.create(name, size);
+        auto header = new (_mapping.data()) Internals::SharedHeader();
+        header->capacity = capacity;
+        header->size = static_cast<uint32_t>(size);
+        header->entries.store(0, std::memory_order_relaxed);
+        header->version = Internals::SharedHeader::VERSION;
+        header->magic = Internals::SharedHeader::MAGIC;
+        _used = sizeof(Internals::SharedHeader) +
+                capacity * sizeof(Internals::SharedEntry);
+    }
+
+    SharedRegistry(const SharedRegistry &) = delete;
+    SharedRegistry &operator=(const SharedRegistry &) = delete;
+
+    ~SharedRegistry() { shm_unlink(_name.c_str()); }
+
+    /** create state S with constructor arguments args in shared memory.
+     * Throws std::length_error when the directory or data area is full, or
+     * when name is longer than 95 characters. */
+    template <typename S, typename... Args>
+    SharedHandle<S, M> create(const std::string &name, Args &&...args) {
+        static_assert(std::is_trivially_copyable<S>::value,
+                      "shared state must be trivially copyable");
+        const std::lock_guard<std::mutex> lock(_createMutex);
+        auto header = this->header();
+        const uint32_t index =
+            header->entries.load(std::memory_order_relaxed);
+        const size_t offset = (_used + alignof(S) - 1) & ~(alignof(S) - 1);
+        if (index == header->capacity) {
+            throw std::length_error("shared registry directory is full");
+        }
+        if (offset + sizeof(S) > _mapping.size()) {
+            throw std::length_error("shared registry data area is full");
+        }
+
+        auto entry = new (entries() + index) Internals::SharedEntry();
+        Internals::copyField(entry->name, name, "metric name");
+        Internals::copyField(entry->type,
+                             Internals::SharedStateType<S>::name(),
+                             "type name");
+        entry->sequence.store(0, std::memory_order_relaxed);
+        entry->offset = static_cast<uint32_t>(offset);
+        entry->size = sizeof(S);
+        S *state =
+            new (_mapping.data() + offset) S(std::forward<Args>(args)...);
+        _used = offset + sizeof(S);
+        _mutexes.emplace_back();
+        header->entries.store(index + 1, std::memory_order_release);
+        return SharedHandle<S, M>(state, entry, &_mutexes.back());
+    }
+
+    /** return no of created metrics */
+    size_t size() const noexcept {
+        return header()->entries.load(std::memory_order_relaxed);
+    }
+
+  private:
+    Internals::SharedHeader *header() const noexcept {
+        return reinterpret_cast<Internals::SharedHeader *>(_mapping.data());
+    }
+
+    Internals::SharedEntry *entries() const noexcept {
+        return reinterpret_cast<Internals::SharedEntry *>(
+            _mapping.data() + sizeof(Internals::SharedHeader));
+    }
+
+    std::string _name;
+    Internals::SharedMapping _mapping{};
+    size_t _used = 0;        /** bytes in use from the start of the file */
+    std::deque<M> _mutexes{}; /** per entry, addresses are stable */
+    std::mutex _createMutex{};
+};
+
+/** Reads the metrics of a SharedRegistry of another process. Formatting is
+ * done by the reader, the writing process only updates its states. */
+class SharedRegistryReader {
+  public:
+    /** map shared memory object name read-only. Throws std::system_error
+     * when it does not exist, std::runtime_error when it is not a registry
+     * of this version. */
+    explicit SharedRegistryReader(const std::string &name) {
+        _mapping.open(name);
+        const auto header = this->header();
+        if (_mapping.size() < sizeof(Internals::SharedHeader) ||
+            header->magic != Internals::SharedHeader::MAGIC ||
+            header->version != Internals::SharedHeader::VERSION ||
+            header->size != _mapping.size() ||
+            sizeof(Internals::SharedHeader) +
+                    header->capacity * sizeof(Internals::SharedEntry) >
+                _mapping.size()) {
+            throw std::runtime_error(name + " is not a shared registry");
+        }
+    }
+
+    /** return no of published metrics */
+    size_t size() const noexcept {
+        const uint32_t entries =
+            header()->entries.load(std::memory_order_acquire);
+        return std::min(entries, header()->capacity);
+    }
+
+    std::map<std::string, std::string> reportMap(int precision = -1) const {
+        std::map<std::string, std::string> result = {};
+        const size_t n = size();
+        for (size_t i = 0; i < n; i++) {
+            const auto &entry = entries()[i];
+            std::string &value = result[Internals::readField(entry.name)];
+            if (static_cast<size_t>(entry.offset) + entry.size >
+                _mapping.size()) {
+                value = "(invalid entry)";
+                continue;
+            }
+            value = Internals::formatShared(entry, _mapping.data(), precision);
+        }
+        return result;
+    }
+
+    /** copy a consistent version of metric name into state, false when
+     * there is no metric name of type S or its writer is busy */
+    template <typename S> bool read(const std::string &name, S &state) const {
+        const size_t n = size();
+        for (size_t i = 0; i < n; i++) {
+            const auto &entry = entries()[i];
+            if (Internals::readField(entry.name) == name) {
+                return Internals::readField(entry.type) ==
+                           Internals::SharedStateType<S>::name() &&
+                       entry.size == sizeof(S) &&
+                       static_cast<size_t>(entry.offset) + entry.size <=
+                           _mapping.size() &&
+                       entry.read(_mapping.data(), &state);
+            }
+        }
+        return false;
+    }
+
+    std::string reportString(int precision = -1) const {
+        auto map = reportMap(precision);
+        std::string result;
+        for (const auto &x : map) {
+            result += x.first + ": " + x.second + "\n";
+        }
+        return result;
+    }
+
+  private:
+    const Internals::SharedHeader *header() const noexcept {
+        return reinterpret_cast<const Internals::SharedHeader *>(
+            _mapping.data());
+    }
+
+    const Internals::SharedEntry *entries() const noexcept {
+        return reinterpret_cast<const Internals::SharedEntry *>(
+            _mapping.data() + sizeof(Internals::SharedHeader));
+    }
+
+    Internals::SharedMapping _mapping{};
+};
+
+} // namespace Metrics
+
+#endif
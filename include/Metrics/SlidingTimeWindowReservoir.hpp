@@ -0,0 +1,237 @@
+#ifndef METRICS_SLIDINGTIMEWINDOWRESERVOIR_HPP
+#define METRICS_SLIDINGTIMEWINDOWRESERVOIR_HPP
+
+#include "Clock.hpp"
+#include "IReservoir.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+/** sliding time window on a stream of data: stores the measurements of the
+ * last <window>, but never more than n. The storage is a ring of fixed size
+ * chunks, a chunk is dropped as a whole when all its samples are expired or
+ * when its space is needed for new samples. C is a std::chrono compatible
+ * clock. A is the allocator of the stored values and the snapshots. */
+template <typename T = double, typename M = std::mutex,
+          typename C = CoarseClock, typename A = std::allocator<T>>
+class SlidingTimeWindowReservoir : public IReservoir<T, A> {
+    using TimePoint = typename C::time_point;
+    using TimePointAllocator =
+        typename std::allocator_traits<A>::template rebind_alloc<TimePoint>;
+
+  public:
+    /** n = max no of samples to store
+     * window = max age of a sample
+     * chunks = no of chunks in the ring */
+    explicit SlidingTimeWindowReservoir(
+        unsigned n,
+        typename C::duration window = std::chrono::seconds(60),
+        unsigned chunks = 16, const A &alloc = A())
+        : _window(window), _chunkSize((n + chunks - 1) / chunks),
+          _noChunks((n + _chunkSize - 1) / _chunkSize),
+          _values(_noChunks * _chunkSize, T{}, alloc),
+          _timestamps(_noChunks * _chunkSize, TimePoint{},
+                      TimePointAllocator(alloc)) {}
+
+    void reset() noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        _first = 0;
+        _used = 0;
+        _fill = 0;
+    }
+
+    /** Update sliding window. The clock is read under the lock, so the
+     * timestamps in the ring are sorted. */
+    void update(T value) noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        insert(value, C::now());
+    }
+
+    unsigned size() const noexcept override { return _values.size(); }
+    unsigned samples() const noexcept override {
+        const auto cutoff = C::now() - _window;
+        const std::lock_guard<M> lock(_mutex);
+        unsigned result = 0;
+        forEachLive(cutoff, [&result](unsigned begin, unsigned end) {
+            result += end - begin;
+        });
+        return result;
+    }
+    const T *data() const noexcept override { return _values.data(); }
+
+    /** get the samples of the window, only live chunks are copied */
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(_values.get_allocator());
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    /** get the samples of the window, only live chunks are copied */
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const auto cutoff = C::now() - _window;
+        const std::lock_guard<M> lock(_mutex);
+        out.fill([this, cutoff](std::vector<T, A> &values) {
+            values.reserve(_used * _chunkSize);
+            forEachLive(cutoff, [this, &values](unsigned begin, unsigned end) {
+                values.insert(values.end(), _values.cbegin() + begin,
+                              _values.cbegin() + end);
+            });
+        });
+    }
+
+    /** append the samples of the window to out, oldest first, each with its
+     * age in ns */
+    void serialize(BinaryWriter &out) const override {
+        const auto now = C::now();
+        const auto cutoff = now - _window;
+        const std::lock_guard<M> lock(_mutex);
+        unsigned samples = 0;
+        forEachLive(cutoff, [&samples](unsigned begin, unsigned end) {
+            samples += end - begin;
+        });
+        out.write(samples);
+        forEachLive(cutoff, [this, now, &out](unsigned begin, unsigned end) {
+            for (unsigned i = begin; i < end; i++) {
+                const auto age = (now > _timestamps[i])
+                                     ? nanoseconds(now - _timestamps[i])
+                                     : 0;
+                out.write(_values[i]);
+                out.write(age);
+            }
+        });
+    }
+
+    /** replace the samples by samples written by serialize(), keeping their
+     * age. Samples older than the window are dropped. Unchanged on failure.
+     */
+    bool deserialize(BinaryReader &in) override {
+        size_t samples;
+        if (!in.readCount(samples)) {
+            return false;
+        }
+        std::vector<std::pair<T, uint64_t>> decoded(samples);
+        for (auto &x : decoded) {
+            if (!in.read(x.first) || !in.read(x.second)) {
+                return false;
+            }
+        }
+
+        const uint64_t window = nanoseconds(_window);
+        const std::lock_guard<M> lock(_mutex);
+        const auto now = C::now();
+        _first = 0;
+        _used = 0;
+        _fill = 0;
+        auto previous = TimePoint::min();
+        for (const auto &x : decoded) {
+            if (x.second > window) {
+                continue;
+            }
+            auto timestamp =
+                now - std::chrono::duration_cast<typename C::duration>(
+                          std::chrono::nanoseconds(x.second));
+            // timestamps in the ring must be sorted
+            timestamp = (timestamp < previous) ? previous : timestamp;
+            insert(x.first, timestamp);
+            previous = timestamp;
+        }
+        return true;
+    }
+
+  private:
+    static uint64_t nanoseconds(typename C::duration d) noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+
+    /** add a sample with timestamp, not older than the newest sample */
+    void insert(T value, TimePoint timestamp) noexcept {
+        expire(timestamp - _window);
+        if (_used == 0 || _fill == _chunkSize) {
+            if (_used == _noChunks) {
+                // ring full, drop oldest chunk
+                _first = nextChunk(_first);
+                _used--;
+            }
+            _used++;
+            _fill = 0;
+        }
+
+        const unsigned slot = newestChunk() * _chunkSize + _fill;
+        _values[slot] = value;
+        _timestamps[slot] = timestamp;
+        _fill++;
+    }
+
+    unsigned nextChunk(unsigned chunk) const noexcept {
+        return (chunk + 1 == _noChunks) ? 0 : chunk + 1;
+    }
+
+    unsigned newestChunk() const noexcept {
+        const unsigned chunk = _first + _used - 1;
+        return (chunk >= _noChunks) ? chunk - _noChunks : chunk;
+    }
+
+    /** no of samples stored in a chunk in use */
+    unsigned chunkFill(unsigned chunk) const noexcept {
+        return (chunk == newestChunk()) ? _fill : _chunkSize;
+    }
+
+    /** timestamp of the newest sample in a chunk in use */
+    typename C::time_point chunkNewest(unsigned chunk) const noexcept {
+        return _timestamps[chunk * _chunkSize + chunkFill(chunk) - 1];
+    }
+
+    /** drop all chunks with only samples older than cutoff */
+    void expire(typename C::time_point cutoff) noexcept {
+        while (_used > 0 && chunkNewest(_first) < cutoff) {
+            _first = nextChunk(_first);
+            _used--;
+        }
+    }
+
+    /** call f(begin, end) for each range of samples not older than cutoff,
+     * oldest first */
+    template <typename F>
+    void forEachLive(typename C::time_point cutoff, F f) const noexcept {
+        unsigned chunk = _first;
+        bool first_live = true;
+        for (unsigned i = 0; i < _used; i++, chunk = nextChunk(chunk)) {
+            if (chunkNewest(chunk) < cutoff) {
+                continue;
+            }
+
+            unsigned begin = chunk * _chunkSize;
+            const unsigned end = begin + chunkFill(chunk);
+            if (first_live) {
+                // timestamps in a chunk are sorted, trim expired samples
+                begin = std::lower_bound(_timestamps.cbegin() + begin,
+                                         _timestamps.cbegin() + end, cutoff) -
+                        _timestamps.cbegin();
+                first_live = false;
+            }
+            f(begin, end);
+        }
+    }
+
+    const typename C::duration _window;
+    const unsigned _chunkSize;
+    const unsigned _noChunks;
+    unsigned _first = 0; /** index of oldest chunk in use */
+    unsigned _used = 0;  /** no of chunks in use */
+    unsigned _fill = 0;  /** no of samples in newest chunk */
+    std::vector<T, A> _values;
+    std::vector<TimePoint, TimePointAllocator> _timestamps;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+#endif
@@ -1,16 +1,27 @@
 #ifndef METRICS_SLIDINGWINDOWRESERVOIR_HPP
 #define METRICS_SLIDINGWINDOWRESERVOIR_HPP
 
+#include "Codec.hpp"
 #include "IReservoir.hpp"
+#include <memory>
 #include <mutex>
 #include <vector>
 
 namespace Metrics {
-/** sliding windows on a stream of data */
-template <typename T = double, typename M = std::mutex>
-class SlidingWindowReservoir : public IReservoir<T> {
+/** sliding windows on a stream of data. E is the codec of the stored values,
+ * e.g. NarrowCodec<double> to store doubles as floats. A is the allocator of
+ * the stored values and the snapshots. */
+template <typename T = double, typename M = std::mutex,
+          typename E = IdentityCodec<T>, typename A = std::allocator<T>>
+class SlidingWindowReservoir : public IReservoir<T, A> {
+    using Stored = typename E::Stored;
+    using StoredAllocator =
+        typename std::allocator_traits<A>::template rebind_alloc<Stored>;
+
   public:
-    explicit SlidingWindowReservoir(unsigned n) : _reservoir(n) {}
+    explicit SlidingWindowReservoir(unsigned n, E codec = E(),
+                                    const A &alloc = A())
+        : _codec(codec), _reservoir(n, Stored{}, StoredAllocator(alloc)) {}
 
     void reset() noexcept override {
         const std::lock_guard<M> lock(_mutex);
@@ -21,14 +32,7 @@ class SlidingWindowReservoir : public IReservoir<T> {
     /** Update sliding window */
     void update(T value) noexcept override {
         const std::lock_guard<M> lock(_mutex);
-        _reservoir[_writePosition] = value;
-        _writePosition++;
-
-        auto reservoir_size = static_cast<unsigned>(_reservoir.size());
-        if (_writePosition >= reservoir_size) {
-            _full = true;
-            _writePosition = 0;
-        }
+        update_nolock(value);
     }
 
     unsigned size() const noexcept override { return _reservoir.size(); }
@@ -36,22 +40,84 @@ class SlidingWindowReservoir : public IReservoir<T> {
         const std::lock_guard<M> lock(_mutex);
         return samples_nolock();
     }
-    const T *data() const noexcept override { return _reservoir.data(); }
+    /** return stored values, or nullptr when they are encoded */
+    const T *data() const noexcept override {
+        return Internals::ValuesOf<T, Stored>::data(_reservoir.data());
+    }
+
+    Snapshot<T, A> getSnapshot() const noexcept override {
+        return getSnapshot(A(_reservoir.get_allocator()));
+    }
+
+    Snapshot<T, A> getSnapshot(const A &alloc) const noexcept override {
+        Snapshot<T, A> result(alloc);
+        getSnapshot(result);
+        return result;
+    }
+
+    void getSnapshot(Snapshot<T, A> &out) const noexcept override {
+        const std::lock_guard<M> lock(_mutex);
+        out.fill([this](std::vector<T, A> &values) {
+            Internals::decode(_codec, _reservoir.cbegin(),
+                              _reservoir.cbegin() + samples_nolock(), values);
+        });
+    }
+
+    /** append the samples to out, oldest first */
+    void serialize(BinaryWriter &out) const override {
+        const std::lock_guard<M> lock(_mutex);
+        const unsigned n = _reservoir.size();
+        const unsigned samples = samples_nolock();
+        const unsigned first = _full ? _writePosition : 0;
+        out.write(samples);
+        for (unsigned i = 0; i < samples; i++) {
+            const unsigned index = (first + i < n) ? first + i : first + i - n;
+            out.write(_codec.decode(_reservoir[index]));
+        }
+    }
 
-    Snapshot<T> getSnapshot() const noexcept override {
+    /** replace the samples by samples written by serialize(), a smaller
+     * window keeps the newest samples. Unchanged on failure. */
+    bool deserialize(BinaryReader &in) override {
+        size_t samples;
+        if (!in.readCount(samples)) {
+            return false;
+        }
+        std::vector<T> values(samples);
+        for (T &value : values) {
+            if (!in.read(value)) {
+                return false;
+            }
+        }
         const std::lock_guard<M> lock(_mutex);
-        return Snapshot<T>(_reservoir.cbegin(),
-                           _reservoir.cbegin() + samples_nolock());
+        _writePosition = 0;
+        _full = false;
+        for (T value : values) {
+            update_nolock(value);
+        }
+        return true;
     }
 
   private:
+    void update_nolock(T value) noexcept {
+        _reservoir[_writePosition] = _codec.encode(value);
+        _writePosition++;
+
+        auto reservoir_size = static_cast<unsigned>(_reservoir.size());
+        if (_writePosition >= reservoir_size) {
+            _full = true;
+            _writePosition = 0;
+        }
+    }
+
     unsigned samples_nolock() const noexcept {
         return _full ? _reservoir.size() : _writePosition;
     }
 
     unsigned _writePosition = 0;
     bool _full = false;
-    std::vector<T> _reservoir;
+    E _codec;
+    std::vector<Stored, StoredAllocator> _reservoir;
     mutable M _mutex{};
 };
 
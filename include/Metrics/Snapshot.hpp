@@ -1,25 +1,80 @@
 #ifndef METRICS_SNAPSHOT_HPP
 #define METRICS_SNAPSHOT_HPP
 
+#include "Binary.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
 namespace Metrics {
-/** Sorted data samples with quantiles */
-template <typename T = double> class Snapshot {
+/** Sorted data samples with quantiles. A is the allocator of the values and
+ * bins, e.g. to take them from an arena instead of the heap. */
+template <typename T = double, typename A = std::allocator<T>> class Snapshot {
   public:
-    using Bins = std::vector<uint32_t>;
+    using Values = std::vector<T, A>;
+    using Bins = std::vector<
+        uint32_t,
+        typename std::allocator_traits<A>::template rebind_alloc<uint32_t>>;
 
-    Snapshot(typename std::vector<T>::const_iterator begin,
-             typename std::vector<T>::const_iterator end)
-        : _snapshot(begin, end) {
+    /** empty snapshot, e.g. to pass to IReservoir::getSnapshot(Snapshot &) */
+    explicit Snapshot(const A &alloc = A()) : _snapshot(alloc) {}
+
+    template <typename It>
+    Snapshot(It begin, It end, const A &alloc = A())
+        : _snapshot(begin, end, alloc) {
         std::sort(_snapshot.begin(), _snapshot.end());
     }
 
+    explicit Snapshot(Values values) : _snapshot(std::move(values)) {
+        std::sort(_snapshot.begin(), _snapshot.end());
+    }
+
+    /** replace the values by [begin, end[, reusing the allocated memory */
+    template <typename It> void assign(It begin, It end) {
+        _snapshot.assign(begin, end);
+        std::sort(_snapshot.begin(), _snapshot.end());
+    }
+
+    /** replace the values by the values which fill(values) appends to the
+     * emptied values, reusing the allocated memory */
+    template <typename F> void fill(F fill) {
+        _snapshot.clear();
+        fill(_snapshot);
+        std::sort(_snapshot.begin(), _snapshot.end());
+    }
+
+    /** append the values to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.writeVarint(_snapshot.size());
+        for (T x : _snapshot) {
+            out.write(x);
+        }
+    }
+
+    /** decode values written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        size_t size;
+        if (!in.readCount(size)) {
+            return false;
+        }
+        Values values(size, T{}, _snapshot.get_allocator());
+        for (T &x : values) {
+            if (!in.read(x)) {
+                return false;
+            }
+        }
+        _snapshot.swap(values);
+        std::sort(_snapshot.begin(), _snapshot.end());
+        return true;
+    }
+
     int size() const { return _snapshot.size(); }
-    const std::vector<T> &values() const { return _snapshot; }
+    const Values &values() const { return _snapshot; }
 
     T getValue(double quantile) const {
         if (quantile < 0.0 || quantile > 1.0) {
@@ -49,7 +104,8 @@ template <typename T = double> class Snapshot {
 
     /** get vector with no of elements per bin */
     Bins getBins(int noBins, T min, T width) const {
-        Bins bins(noBins);
+        Bins bins(noBins, 0, typename Bins::allocator_type(
+                                 _snapshot.get_allocator()));
         for (auto x : _snapshot) {
             int binIndex = std::floor(noBins * (x - min) / width);
             if (binIndex < 0) {
@@ -64,8 +120,61 @@ template <typename T = double> class Snapshot {
     }
 
   private:
-    std::vector<T> _snapshot;
+    Values _snapshot;
+};
+
+namespace Internals {
+/** Snapshot S of a histogram or timer which is kept between reports, to
+ * reuse its memory. It is only allocated when enabled, as it doubles the
+ * memory of the samples, so otherwise it costs a pointer. */
+template <typename S> class ReusedSnapshot {
+  public:
+    ReusedSnapshot() = default;
+    ReusedSnapshot(const ReusedSnapshot &) = delete;
+    ReusedSnapshot &operator=(const ReusedSnapshot &) = delete;
+    ~ReusedSnapshot() { delete _scratch.load(); }
+
+    /** start keeping the snapshot, initial is its first value. Safe to call
+     * concurrently with apply(). */
+    void enable(S initial) {
+        if (_scratch.load(std::memory_order_acquire) != nullptr) {
+            return;
+        }
+        Scratch *scratch = new Scratch(std::move(initial));
+        Scratch *expected = nullptr;
+        if (!_scratch.compare_exchange_strong(expected, scratch,
+                                              std::memory_order_acq_rel)) {
+            delete scratch;
+        }
+    }
+
+    /** call f with a snapshot of reservoir: the kept snapshot, unless it is
+     * not enabled or in use by another thread */
+    template <typename R, typename F>
+    void apply(const R &reservoir, F f) const noexcept {
+        Scratch *scratch = _scratch.load(std::memory_order_acquire);
+        if (scratch != nullptr) {
+            std::unique_lock<std::mutex> lock(scratch->mutex,
+                                              std::try_to_lock);
+            if (lock.owns_lock()) {
+                reservoir.getSnapshot(scratch->snapshot);
+                f(scratch->snapshot);
+                return;
+            }
+        }
+        f(reservoir.getSnapshot());
+    }
+
+  private:
+    struct Scratch {
+        explicit Scratch(S initial) : mutex(), snapshot(std::move(initial)) {}
+        std::mutex mutex;
+        S snapshot;
+    };
+
+    std::atomic<Scratch *> _scratch{nullptr};
 };
+} // namespace Internals
 
 } // namespace Metrics
 #endif
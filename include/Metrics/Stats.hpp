@@ -0,0 +1,569 @@
+#ifndef METRICS_STATS_HPP
+#define METRICS_STATS_HPP
+
+#include "Binary.hpp"
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace Metrics {
+/** Features which can be selected in Stats<...>. Mean needs the count, M2
+ * needs the mean and the count: they are added implicitly. */
+namespace Feature {
+struct Count {};
+struct Min {};
+struct Max {};
+struct Mean {};
+struct M2 {};
+} // namespace Feature
+
+namespace Internals {
+/** true if F is one of Fs */
+template <typename F, typename... Fs> struct HasFeature : std::false_type {};
+template <typename F, typename... Fs>
+struct HasFeature<F, F, Fs...> : std::true_type {};
+template <typename F, typename G, typename... Fs>
+struct HasFeature<F, G, Fs...> : HasFeature<F, Fs...> {};
+
+/** Each part of the state is a slot. A disabled slot is an empty class, so
+ * it takes no space as base class, and its update is a no-op. */
+template <bool ENABLED> class CountSlot {
+  protected:
+    void resetCount() noexcept {}
+    void updateCount() noexcept {}
+    void mergeCount(const CountSlot &) noexcept {}
+    void printCount(Formatter &) const {}
+    void visitCount(IMetricVisitor &) const noexcept {}
+    void serializeCount(BinaryWriter &) const {}
+    bool deserializeCount(BinaryReader &) { return true; }
+};
+
+template <> class CountSlot<true> {
+  public:
+    /** return no of measurements */
+    int64_t count() const noexcept { return _count; }
+
+  protected:
+    void resetCount() noexcept { _count = 0; }
+    void updateCount() noexcept { _count++; }
+    void mergeCount(const CountSlot &rhs) noexcept { _count += rhs._count; }
+    void printCount(Formatter &os) const {
+        os << "count(" << _count << ")";
+    }
+    void visitCount(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", _count);
+    }
+    void serializeCount(BinaryWriter &out) const { out.write(_count); }
+    bool deserializeCount(BinaryReader &in) {
+        return in.read(_count) && _count >= 0;
+    }
+
+  private:
+    int64_t _count = 0;
+};
+
+/** min and max start at +inf and -inf, so updating needs no branch on the
+ * count. A stream of only +inf (resp. -inf) values has no min (resp. max). */
+template <typename T, bool ENABLED> class MinSlot {
+  protected:
+    void resetMin() noexcept {}
+    void updateMin(T) noexcept {}
+    void mergeMin(const MinSlot &) noexcept {}
+    void printMin(Formatter &) const {}
+    void visitMin(IMetricVisitor &) const noexcept {}
+    void serializeMin(BinaryWriter &) const {}
+    bool deserializeMin(BinaryReader &) { return true; }
+};
+
+template <typename T> class MinSlot<T, true> {
+  public:
+    /** return lowest measured value or NAN when there are no measurements */
+    T min() const noexcept { return (_min == EMPTY()) ? NAN : _min; }
+
+  protected:
+    void resetMin() noexcept { _min = EMPTY(); }
+    void updateMin(T value) noexcept { _min = std::min(value, _min); }
+    void mergeMin(const MinSlot &rhs) noexcept {
+        _min = std::min(_min, rhs._min);
+    }
+    void printMin(Formatter &os) const { os << " min(" << min() << ")"; }
+    void visitMin(IMetricVisitor &visitor) const noexcept {
+        visitor.field("min", static_cast<double>(min()));
+    }
+    void serializeMin(BinaryWriter &out) const { out.write(_min); }
+    bool deserializeMin(BinaryReader &in) { return in.read(_min); }
+
+  private:
+    static constexpr T EMPTY() noexcept {
+        return std::numeric_limits<T>::infinity();
+    }
+
+    T _min = EMPTY();
+};
+
+template <typename T, bool ENABLED> class MaxSlot {
+  protected:
+    void resetMax() noexcept {}
+    void updateMax(T) noexcept {}
+    void mergeMax(const MaxSlot &) noexcept {}
+    void printMax(Formatter &) const {}
+    void visitMax(IMetricVisitor &) const noexcept {}
+    void serializeMax(BinaryWriter &) const {}
+    bool deserializeMax(BinaryReader &) { return true; }
+};
+
+template <typename T> class MaxSlot<T, true> {
+  public:
+    /** return highest measured value or NAN when there are no measurements */
+    T max() const noexcept { return (_max == EMPTY()) ? NAN : _max; }
+
+  protected:
+    void resetMax() noexcept { _max = EMPTY(); }
+    void updateMax(T value) noexcept { _max = std::max(value, _max); }
+    void mergeMax(const MaxSlot &rhs) noexcept {
+        _max = std::max(_max, rhs._max);
+    }
+    void printMax(Formatter &os) const { os << " max(" << max() << ")"; }
+    void visitMax(IMetricVisitor &visitor) const noexcept {
+        visitor.field("max", static_cast<double>(max()));
+    }
+    void serializeMax(BinaryWriter &out) const { out.write(_max); }
+    bool deserializeMax(BinaryReader &in) { return in.read(_max); }
+
+  private:
+    static constexpr T EMPTY() noexcept {
+        return -std::numeric_limits<T>::infinity();
+    }
+
+    T _max = EMPTY();
+};
+
+/** mean and second order moment with Welford's algorithm, n is the count
+ * after the update */
+template <typename T, bool MEAN, bool M2> class MomentSlot {
+  protected:
+    void resetMoments() noexcept {}
+    void updateMoments(T, int64_t) noexcept {}
+    void mergeMoments(const MomentSlot &, int64_t, int64_t) noexcept {}
+    void printMean(Formatter &, int64_t) const {}
+    void printStddev(Formatter &, int64_t) const {}
+    void visitMean(IMetricVisitor &, int64_t) const noexcept {}
+    void visitStddev(IMetricVisitor &, int64_t) const noexcept {}
+    void serializeMoments(BinaryWriter &) const {}
+    bool deserializeMoments(BinaryReader &) { return true; }
+};
+
+template <typename T> class MomentSlot<T, true, false> {
+  protected:
+    void resetMoments() noexcept { _mean = {}; }
+    void updateMoments(T value, int64_t n) noexcept {
+        _mean += (value - _mean) / n;
+    }
+    void mergeMoments(const MomentSlot &rhs, int64_t n_lhs,
+                      int64_t n_rhs) noexcept {
+        if (n_rhs != 0) {
+            _mean += (rhs._mean - _mean) * n_rhs / (n_lhs + n_rhs);
+        }
+    }
+    void printMean(Formatter &os, int64_t n) const {
+        os << " mean(" << mean(n) << ")";
+    }
+    void printStddev(Formatter &, int64_t) const {}
+    void visitMean(IMetricVisitor &visitor, int64_t n) const noexcept {
+        visitor.field("mean", static_cast<double>(mean(n)));
+    }
+    void visitStddev(IMetricVisitor &, int64_t) const noexcept {}
+    void serializeMoments(BinaryWriter &out) const { out.write(_mean); }
+    bool deserializeMoments(BinaryReader &in) { return in.read(_mean); }
+
+    T mean(int64_t n) const noexcept { return (n == 0) ? NAN : _mean; }
+
+  private:
+    T _mean{};
+};
+
+template <typename T> class MomentSlot<T, true, true> {
+  protected:
+    void resetMoments() noexcept {
+        _mean = {};
+        _m2 = {};
+    }
+    void updateMoments(T value, int64_t n) noexcept {
+        const T delta = value - _mean;
+        _mean += delta / n;
+        _m2 += delta * (value - _mean);
+    }
+    void mergeMoments(const MomentSlot &rhs, int64_t n_lhs,
+                      int64_t n_rhs) noexcept {
+        if (n_rhs == 0) {
+            return;
+        }
+        const T n_both = static_cast<T>(n_lhs + n_rhs);
+        const T delta = rhs._mean - _mean;
+        _mean += delta * n_rhs / n_both;
+        _m2 += rhs._m2 + delta * delta * n_lhs * n_rhs / n_both;
+    }
+    void printMean(Formatter &os, int64_t n) const {
+        os << " mean(" << mean(n) << ")";
+    }
+    void printStddev(Formatter &os, int64_t n) const {
+        os << " sample_stddev(" << sqrt(sample_variance(n)) << ")";
+    }
+    void visitMean(IMetricVisitor &visitor, int64_t n) const noexcept {
+        visitor.field("mean", static_cast<double>(mean(n)));
+    }
+    void visitStddev(IMetricVisitor &visitor, int64_t n) const noexcept {
+        visitor.field("sample_stddev",
+                      static_cast<double>(sqrt(sample_variance(n))));
+    }
+    void serializeMoments(BinaryWriter &out) const {
+        out.write(_mean);
+        out.write(_m2);
+    }
+    bool deserializeMoments(BinaryReader &in) {
+        return in.read(_mean) && in.read(_m2);
+    }
+
+    T mean(int64_t n) const noexcept { return (n == 0) ? NAN : _mean; }
+    T m2() const noexcept { return _m2; }
+    T variance(int64_t n) const noexcept { return (n < 1) ? NAN : _m2 / n; }
+    T sample_variance(int64_t n) const noexcept {
+        return (n < 2) ? NAN : _m2 / (n - 1);
+    }
+
+  private:
+    T _mean{};
+    T _m2{};
+};
+
+/** Statistics composed at compile time from the features F in namespace
+ * Feature. Only the selected features are stored and updated, e.g.
+ * StatsNoLock<double, Feature::Min, Feature::Max> holds 2 doubles. */
+template <typename T, typename... F>
+class StatsNoLock
+    : public CountSlot<HasFeature<Feature::Count, F...>::value ||
+                       HasFeature<Feature::Mean, F...>::value ||
+                       HasFeature<Feature::M2, F...>::value>,
+      public MinSlot<T, HasFeature<Feature::Min, F...>::value>,
+      public MaxSlot<T, HasFeature<Feature::Max, F...>::value>,
+      public MomentSlot<T,
+                        HasFeature<Feature::Mean, F...>::value ||
+                            HasFeature<Feature::M2, F...>::value,
+                        HasFeature<Feature::M2, F...>::value> {
+  public:
+    static constexpr bool HAS_M2 = HasFeature<Feature::M2, F...>::value;
+    static constexpr bool HAS_MEAN =
+        HasFeature<Feature::Mean, F...>::value || HAS_M2;
+    static constexpr bool HAS_COUNT =
+        HasFeature<Feature::Count, F...>::value || HAS_MEAN;
+
+  private:
+    using Moments = MomentSlot<T, HAS_MEAN, HAS_M2>;
+
+  public:
+    void reset() noexcept {
+        this->resetCount();
+        this->resetMin();
+        this->resetMax();
+        this->resetMoments();
+    }
+
+    void update(T value) noexcept {
+        this->updateCount();
+        this->updateMin(value);
+        this->updateMax(value);
+        this->updateMoments(value, countOrZero());
+    }
+
+    StatsNoLock &operator+=(const StatsNoLock &rhs) noexcept {
+        // moments need the counts before merging
+        this->mergeMoments(rhs, countOrZero(), rhs.countOrZero());
+        this->mergeCount(rhs);
+        this->mergeMin(rhs);
+        this->mergeMax(rhs);
+        return *this;
+    }
+
+    friend inline StatsNoLock operator+(const StatsNoLock &lhs,
+                                        const StatsNoLock &rhs) noexcept {
+        StatsNoLock result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return mean of measured values or NAN when there are no measurements */
+    template <bool B = HAS_MEAN>
+    typename std::enable_if<B, T>::type mean() const noexcept {
+        return Moments::mean(countOrZero());
+    }
+
+    /** second order moment: sum of (x-x_mean)^2 */
+    template <bool B = HAS_M2>
+    typename std::enable_if<B, T>::type m2() const noexcept {
+        return Moments::m2();
+    }
+
+    /** return variance of a population or NAN when there are no measurements */
+    template <bool B = HAS_M2>
+    typename std::enable_if<B, T>::type variance() const noexcept {
+        return Moments::variance(countOrZero());
+    }
+
+    /** standard deviation of a population */
+    template <bool B = HAS_M2>
+    typename std::enable_if<B, T>::type stddev() const noexcept {
+        return sqrt(variance());
+    }
+
+    /** variance of a sample from a population */
+    template <bool B = HAS_M2>
+    typename std::enable_if<B, T>::type sample_variance() const noexcept {
+        return Moments::sample_variance(countOrZero());
+    }
+
+    /** standard deviation of a sample of a population */
+    template <bool B = HAS_M2>
+    typename std::enable_if<B, T>::type sample_stddev() const noexcept {
+        return sqrt(sample_variance());
+    }
+
+    std::string toString(int precision = -1) const noexcept {
+        Internals::Formatter os(precision);
+        this->printCount(os);
+        this->printMin(os);
+        this->printMean(os, countOrZero());
+        this->printMax(os);
+        this->printStddev(os, countOrZero());
+        std::string result = os.release();
+        // features after count start with a space
+        if (!HAS_COUNT && !result.empty()) {
+            result.erase(0, 1);
+        }
+        return result;
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        this->visitCount(visitor);
+        this->visitMin(visitor);
+        this->visitMean(visitor, countOrZero());
+        this->visitMax(visitor);
+        this->visitStddev(visitor, countOrZero());
+    }
+
+    /** append the state to out, preceded by the selected features, see
+     * Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        out.write(features());
+        this->serializeCount(out);
+        this->serializeMin(out);
+        this->serializeMax(out);
+        this->serializeMoments(out);
+    }
+
+    /** decode a state written by serialize() of Stats with the same
+     * features, unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        StatsNoLock result(*this);
+        unsigned encoded;
+        if (!in.read(encoded) || encoded != features() ||
+            !result.deserializeCount(in) || !result.deserializeMin(in) ||
+            !result.deserializeMax(in) || !result.deserializeMoments(in)) {
+            return false;
+        }
+        *this = result;
+        return true;
+    }
+
+  private:
+    /** bit mask of the stored features */
+    static constexpr unsigned features() noexcept {
+        return (HAS_COUNT ? 1U : 0U) |
+               (HasFeature<Feature::Min, F...>::value ? 2U : 0U) |
+               (HasFeature<Feature::Max, F...>::value ? 4U : 0U) |
+               (HAS_MEAN ? 8U : 0U) | (HAS_M2 ? 16U : 0U);
+    }
+
+    template <bool B = HAS_COUNT>
+    typename std::enable_if<B, int64_t>::type countOrZero() const noexcept {
+        return this->count();
+    }
+    template <bool B = HAS_COUNT>
+    typename std::enable_if<!B, int64_t>::type countOrZero() const noexcept {
+        return 0;
+    }
+};
+
+template <typename T, typename... F>
+constexpr bool StatsNoLock<T, F...>::HAS_M2;
+template <typename T, typename... F>
+constexpr bool StatsNoLock<T, F...>::HAS_MEAN;
+template <typename T, typename... F>
+constexpr bool StatsNoLock<T, F...>::HAS_COUNT;
+
+} // namespace Internals
+
+/** Statistics composed at compile time from the features F, e.g.
+ * BasicStats<float, std::mutex, Feature::Mean, Feature::M2>. Accessors of
+ * features which are not selected do not compile. */
+template <typename T, typename M, typename... F>
+class BasicStats : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+    using State = Internals::StatsNoLock<T, F...>;
+
+  public:
+    BasicStats() = default;
+    ~BasicStats() override = default;
+
+    BasicStats(const BasicStats &other) noexcept {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        _state = other._state;
+    }
+
+    BasicStats &operator=(const BasicStats &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        _state = other._state;
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+    }
+
+    void update(T value) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value);
+    }
+
+    BasicStats &operator+=(const BasicStats &rhs) noexcept {
+        // In the very unlikely case that 2 threads simultaneously do a+=b and
+        // b+=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{rhs._mutex, std::defer_lock};
+        if (&rhs == this) {
+            // second lock would deadlock when doing a+=a
+            lock1.lock();
+        } else {
+            std::lock(lock1, lock2);
+        }
+        _state += rhs._state;
+        return *this;
+    }
+
+    friend inline BasicStats operator+(const BasicStats &lhs,
+                                       const BasicStats &rhs) noexcept {
+        BasicStats result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of measurements */
+    template <typename S = State>
+    auto count() const noexcept -> decltype(std::declval<const S &>().count()) {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return lowest measured value or NAN when there are no measurements */
+    template <typename S = State>
+    auto min() const noexcept -> decltype(std::declval<const S &>().min()) {
+        lock_guard lock(_mutex);
+        return _state.min();
+    }
+
+    /** return mean of measured values or NAN when there are no measurements */
+    template <typename S = State>
+    auto mean() const noexcept -> decltype(std::declval<const S &>().mean()) {
+        lock_guard lock(_mutex);
+        return _state.mean();
+    }
+
+    /** return highest measured value or NAN when there are no measurements */
+    template <typename S = State>
+    auto max() const noexcept -> decltype(std::declval<const S &>().max()) {
+        lock_guard lock(_mutex);
+        return _state.max();
+    }
+
+    /** second order moment: sum of (x-x_mean)^2 */
+    template <typename S = State>
+    auto m2() const noexcept -> decltype(std::declval<const S &>().m2()) {
+        lock_guard lock(_mutex);
+        return _state.m2();
+    }
+
+    /** return variance of a population or NAN when there are no measurements */
+    template <typename S = State>
+    auto variance() const noexcept
+        -> decltype(std::declval<const S &>().variance()) {
+        lock_guard lock(_mutex);
+        return _state.variance();
+    }
+
+    /** standard deviation of a population */
+    template <typename S = State>
+    auto stddev() const noexcept
+        -> decltype(std::declval<const S &>().stddev()) {
+        lock_guard lock(_mutex);
+        return _state.stddev();
+    }
+
+    /** variance of a sample from a population */
+    template <typename S = State>
+    auto sample_variance() const noexcept
+        -> decltype(std::declval<const S &>().sample_variance()) {
+        lock_guard lock(_mutex);
+        return _state.sample_variance();
+    }
+
+    /** standard deviation of a sample of a population */
+    template <typename S = State>
+    auto sample_stddev() const noexcept
+        -> decltype(std::declval<const S &>().sample_stddev()) {
+        lock_guard lock(_mutex);
+        return _state.sample_stddev();
+    }
+
+    /** return copy of the state, to read many values with a single lock */
+    State state() const noexcept {
+        lock_guard lock(_mutex);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
+    }
+
+  private:
+    State _state{};
+    mutable M _mutex{};
+};
+
+/** BasicStats of doubles protected by a std::mutex, e.g.
+ * Stats<Feature::Count, Feature::Mean, Feature::M2, Feature::Max> */
+template <typename... F> using Stats = BasicStats<double, std::mutex, F...>;
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef METRICS_STRIPEDCOUNTER_HPP
+#define METRICS_STRIPEDCOUNTER_HPP
+
+#include "Hash.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <thread>
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#include <sched.h>
+#endif
+
+namespace Metrics {
+namespace Internals {
+/** cell index policy: hash of the thread id, calculated once per thread */
+struct ThreadCellIndex {
+    static unsigned get() noexcept {
+        static thread_local const unsigned index = static_cast<unsigned>(
+            mix64(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+        return index;
+    }
+};
+
+/** cell index policy: the CPU the thread runs on, so threads on different
+ * CPUs never share a cell. Falls back to ThreadCellIndex when sched_getcpu()
+ * is not available. */
+struct CpuCellIndex {
+    static unsigned get() noexcept {
+#if defined(__linux__) && defined(_GNU_SOURCE)
+        const int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return static_cast<unsigned>(cpu);
+        }
+#endif
+        return ThreadCellIndex::get();
+    }
+};
+
+/** Counter striped over N cells of a cache line each. Each thread adds to the
+ * cell selected by index policy I, so concurrent updates don't bounce a single
+ * cache line between cores. Reading sums all cells. */
+template <unsigned N = 16, typename I = ThreadCellIndex> class StripedCounter {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+  public:
+    StripedCounter() noexcept {
+        for (unsigned i = 0; i < N; i++) {
+            new (cells() + i) Cell();
+        }
+    }
+
+    StripedCounter(const StripedCounter &) = delete;
+    StripedCounter &operator=(const StripedCounter &) = delete;
+
+    void reset() noexcept {
+        for (unsigned i = 0; i < N; i++) {
+            cells()[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(int64_t n) noexcept {
+        cells()[I::get() & (N - 1)].value.fetch_add(n,
+                                                    std::memory_order_relaxed);
+    }
+
+    int64_t sum() const noexcept {
+        int64_t result = 0;
+        for (unsigned i = 0; i < N; i++) {
+            result += cells()[i].value.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+  private:
+    static constexpr unsigned CACHE_LINE = 64;
+
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<int64_t> value{0};
+    };
+    static_assert(sizeof(Cell) == CACHE_LINE, "a cell fills a cache line");
+
+    /** return the first cell. Before C++17, new and make_shared ignore the
+     * alignment of over-aligned types, so the cells are placed on the first
+     * cache line boundary in a buffer with room for one more cell. */
+    Cell *cells() noexcept {
+        const uintptr_t aligned =
+            (reinterpret_cast<uintptr_t>(_storage) + CACHE_LINE - 1) &
+            ~static_cast<uintptr_t>(CACHE_LINE - 1);
+        return reinterpret_cast<Cell *>(aligned);
+    }
+
+    const Cell *cells() const noexcept {
+        return const_cast<StripedCounter *>(this)->cells();
+    }
+
+    unsigned char _storage[(N + 1) * sizeof(Cell)];
+};
+
+} // namespace Internals
+} // namespace Metrics
+
+#endif
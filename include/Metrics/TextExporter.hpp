@@ -0,0 +1,106 @@
+#ifndef METRICS_TEXTEXPORTER_HPP
+#define METRICS_TEXTEXPORTER_HPP
+
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include <cstdint>
+#include <string>
+
+namespace Metrics {
+/** Visitor writing metrics as text into a buffer, one line per metric, e.g.
+ * "latency: count(3) min(1) Q50(2) max(3)". The buffer keeps its memory when
+ * cleared, so a periodic report without new metrics does not allocate.
+ * Numbers are formatted like toString(). */
+class TextExporter : public IMetricVisitor {
+  public:
+    /** precision = no of digits after the decimal point, -1 for the
+     * shortest representation (printf %g) */
+    explicit TextExporter(int precision = -1) : _precision(precision) {}
+
+    /** return the output of all visited metrics */
+    const std::string &str() const noexcept { return _buffer; }
+
+    /** clear the output, keeping the memory of the buffer */
+    void clear() noexcept { _buffer.clear(); }
+
+    void beginMetric(const std::string &name) override {
+        _buffer += name;
+        _buffer += ':';
+    }
+
+    void endMetric() override { _buffer += '\n'; }
+
+    void field(const char *key, int64_t value) override {
+        openField(key);
+        appendInteger(value);
+        _buffer += ')';
+    }
+
+    void field(const char *key, double value) override {
+        openField(key);
+        appendDouble(value);
+        _buffer += ')';
+    }
+
+    void field(const char *key, unsigned index, double value) override {
+        _buffer += ' ';
+        _buffer += key;
+        _buffer += '[';
+        appendInteger(index);
+        _buffer += "](";
+        appendDouble(value);
+        _buffer += ')';
+    }
+
+    void quantile(double q, double value) override {
+        _buffer += " Q";
+        Internals::appendNumber(_buffer, q * 100, -1);
+        _buffer += '(';
+        appendDouble(value);
+        _buffer += ')';
+    }
+
+    void bin(double lower, double upper, int64_t count) override {
+        _buffer += " [";
+        appendDouble(lower);
+        _buffer += ", ";
+        appendDouble(upper);
+        _buffer += "):";
+        appendInteger(count);
+    }
+
+    void entry(const std::string &key, int64_t count) override {
+        _buffer += ' ';
+        _buffer += key;
+        _buffer += ':';
+        appendInteger(count);
+    }
+
+    void text(const char *key, const std::string &value) override {
+        openField(key);
+        _buffer += value;
+        _buffer += ')';
+    }
+
+  private:
+    void openField(const char *key) {
+        _buffer += ' ';
+        _buffer += key;
+        _buffer += '(';
+    }
+
+    void appendInteger(int64_t value) {
+        Internals::appendNumber(_buffer, static_cast<long long>(value));
+    }
+
+    void appendDouble(double value) {
+        Internals::appendNumber(_buffer, value, _precision);
+    }
+
+    int _precision;
+    std::string _buffer{};
+};
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef METRICS_TIMEWINDOW_HPP
+#define METRICS_TIMEWINDOW_HPP
+
+#include "Clock.hpp"
+#include "IMetric.hpp"
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Metrics {
+/** Statistics over a sliding time window, e.g. the last 5 minutes. The window
+ * is a ring of buckets of a fixed duration, each holding a mergeable state S
+ * (e.g. Internals::VarianceNoLock<>). An update goes to the bucket of the
+ * current time, reading merges the live buckets with S::operator+=. Memory
+ * is proportional to the no of buckets, not to the event rate. C is a
+ * std::chrono compatible clock. */
+template <typename S, typename M = std::mutex, typename C = CoarseClock>
+class TimeWindow : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    /** noBuckets = no of buckets in the window
+     * width = duration of a bucket */
+    explicit TimeWindow(unsigned noBuckets,
+                        typename C::duration width = std::chrono::seconds(1))
+        : _width(width), _buckets(noBuckets) {}
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        for (auto &bucket : _buckets) {
+            bucket.epoch = NO_EPOCH;
+        }
+    }
+
+    /** update the bucket of the current time, arguments are forwarded to
+     * S::update() */
+    template <typename... Args> void update(Args... args) noexcept {
+        // read the clock under the lock: a thread preempted between reading
+        // and locking would write into a bucket reused by a newer epoch
+        lock_guard lock(_mutex);
+        const int64_t epoch = epochOf(C::now());
+        Bucket &bucket = _buckets[index(epoch)];
+        if (bucket.epoch != epoch) {
+            bucket.state.reset();
+            bucket.epoch = epoch;
+        }
+        bucket.state.update(args...);
+    }
+
+    /** return the merged state of all buckets in the window */
+    S state() const noexcept {
+        S result{};
+        lock_guard lock(_mutex);
+        const int64_t epoch = epochOf(C::now());
+        for (const auto &bucket : _buckets) {
+            if (isLive(bucket, epoch)) {
+                result += bucket.state;
+            }
+        }
+        return result;
+    }
+
+    /** return duration of the window */
+    typename C::duration window() const noexcept {
+        return _width * static_cast<int64_t>(_buckets.size());
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
+    }
+
+  private:
+    static constexpr int64_t NO_EPOCH = std::numeric_limits<int64_t>::min();
+
+    struct Bucket {
+        int64_t epoch = NO_EPOCH; /** time / width of the bucket */
+        S state{};
+    };
+
+    int64_t epochOf(typename C::time_point t) const noexcept {
+        return t.time_since_epoch() / _width;
+    }
+
+    unsigned index(int64_t epoch) const noexcept {
+        return static_cast<uint64_t>(epoch) % _buckets.size();
+    }
+
+    bool isLive(const Bucket &bucket, int64_t epoch) const noexcept {
+        return bucket.epoch != NO_EPOCH && bucket.epoch <= epoch &&
+               epoch - bucket.epoch < static_cast<int64_t>(_buckets.size());
+    }
+
+    const typename C::duration _width;
+    std::vector<Bucket> _buckets;
+    mutable M _mutex{};
+};
+
+template <typename S, typename M, typename C>
+constexpr int64_t TimeWindow<S, M, C>::NO_EPOCH;
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef METRICS_TIMER_HPP
+#define METRICS_TIMER_HPP
+
+#include "Format.hpp"
+#include "IMetric.hpp"
+#include "Meter.hpp"
+#include "SlidingWindowReservoir.hpp"
+#include <chrono>
+#include <string>
+
+namespace Metrics {
+/** Measure the rate of events and the distribution of their durations. R is
+ * a reservoir of doubles, durations are stored in nanoseconds. C is the
+ * std::chrono compatible clock used for timing, e.g. std::chrono::steady_clock,
+ * CoarseClock or TscClock. After reuseSnapshots(), toString() reuses the
+ * memory of the snapshot of the previous call. */
+template <typename R = SlidingWindowReservoir<double>,
+          typename C = std::chrono::steady_clock>
+class Timer : public IMetric {
+  public:
+    /** Time a scope: the duration from construction until destruction or
+     * stop() is added to the timer */
+    class Scope {
+      public:
+        explicit Scope(Timer &timer) noexcept
+            : _timer(&timer), _start(C::now()) {}
+        Scope(Scope &&other) noexcept
+            : _timer(other._timer), _start(other._start) {
+            other._timer = nullptr;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        Scope &operator=(Scope &&) = delete;
+        ~Scope() { stop(); }
+
+        /** stop timing before the end of the scope */
+        void stop() noexcept {
+            if (_timer != nullptr) {
+                _timer->update(C::now() - _start);
+                _timer = nullptr;
+            }
+        }
+
+      private:
+        Timer *_timer;
+        typename C::time_point _start;
+    };
+
+    /** n = reservoir size */
+    explicit Timer(unsigned n)
+        : _reservoir(n) {}
+
+    void reset() noexcept override {
+        _meter.reset();
+        _reservoir.reset();
+    }
+
+    /** add a measured duration */
+    void update(typename C::duration duration) noexcept {
+        _meter.mark();
+        _reservoir.update(
+            std::chrono::duration<double, std::nano>(duration).count());
+    }
+
+    /** start timing, stops when the returned object goes out of scope */
+    Scope time() noexcept { return Scope(*this); }
+
+    /** return no of measured durations */
+    int64_t count() const noexcept { return _meter.count(); }
+
+    /** mean no of events per second since creation or last reset */
+    double mean_rate() const noexcept { return _meter.mean_rate(); }
+
+    /** 1 minute moving average of events per second */
+    double m1_rate() const noexcept { return _meter.m1_rate(); }
+
+    /** 5 minute moving average of events per second */
+    double m5_rate() const noexcept { return _meter.m5_rate(); }
+
+    /** 15 minute moving average of events per second */
+    double m15_rate() const noexcept { return _meter.m15_rate(); }
+
+    /** sorted durations in the reservoir, in nanoseconds */
+    typename R::SnapshotType getSnapshot() const noexcept {
+        return _reservoir.getSnapshot();
+    }
+
+    /** replace the values of out by the sorted durations, reusing its
+     * memory */
+    void getSnapshot(typename R::SnapshotType &out) const noexcept {
+        _reservoir.getSnapshot(out);
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        std::string result;
+        _scratch.apply(_reservoir,
+                       [&](const typename R::SnapshotType &snapshot) {
+                           result = toString(snapshot, precision);
+                       });
+        return result;
+    }
+
+    /** the fields of the meter, followed by the distribution of the
+     * durations in nanoseconds */
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        _meter.visit(visitor);
+        _scratch.apply(_reservoir,
+                       [&](const typename R::SnapshotType &snapshot) {
+                           visit(snapshot, visitor);
+                       });
+    }
+
+    void reuseSnapshots() override {
+        _scratch.enable(_reservoir.getSnapshot());
+    }
+
+  private:
+    std::string toString(const typename R::SnapshotType &snapshot,
+                         int precision) const noexcept {
+        Internals::Formatter os(precision);
+        // the separator of Meter::toString() is used for all fields
+        os << _meter.toString(precision) << " min(" << snapshot.getValue(0)
+           << ") Q25(" << snapshot.getValue(0.25) << ") Q50("
+           << snapshot.getValue(0.50) << ") Q75(" << snapshot.getValue(0.75)
+           << ") max(" << snapshot.getValue(1.00) << ")";
+        return os.release();
+    }
+
+    void visit(const typename R::SnapshotType &snapshot,
+               IMetricVisitor &visitor) const noexcept {
+        visitor.field("min", snapshot.getValue(0));
+        for (double q : {0.25, 0.50, 0.75}) {
+            visitor.quantile(q, snapshot.getValue(q));
+        }
+        visitor.field("max", snapshot.getValue(1.00));
+    }
+
+    Meter<> _meter{};
+    R _reservoir;
+    Internals::ReusedSnapshot<typename R::SnapshotType> _scratch{};
+};
+
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef METRICS_TOPK_HPP
+#define METRICS_TOPK_HPP
+
+/* Space-Saving heavy hitters in C++
+   Metwally et al., Efficient Computation of Frequent and Top-k Elements in
+   Data Streams - https://www.cs.ucsb.edu/research/tech-reports/2005-23
+   Merging: Agarwal et al., Mergeable Summaries -
+   https://www.cs.utah.edu/~jeffp/papers/merge-summ.pdf
+*/
+
+#include "Binary.hpp"
+#include "IMetric.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Metrics {
+namespace Internals {
+/** Find the most frequent keys in a stream with k counters. The counters are
+ * kept in a stream-summary: a list of buckets sorted on count, each with a
+ * list of counters with that count, so a unit increment is O(1). */
+template <typename K = std::string> class TopKNoLock {
+  public:
+    /** key with its estimated count, the true count is in
+     * [count - error, count] */
+    struct Entry {
+        K key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    /** k = no of counters. An increment allocates the new bucket before the
+     * old one is freed, so there is 1 bucket more than counters. */
+    explicit TopKNoLock(unsigned k) : _counters(k), _buckets(k + 1) {
+        _index.reserve(k);
+        reset();
+    }
+
+    void reset() noexcept {
+        _index.clear();
+        _used = 0;
+        _total = 0;
+        _minBucket = NONE;
+        _freeBucket = NONE;
+        for (unsigned i = 0; i < _buckets.size(); i++) {
+            _buckets[i].next = _freeBucket;
+            _freeBucket = i;
+        }
+    }
+
+    /** count n occurrences of key, O(1) for n = 1 */
+    void update(const K &key, uint64_t n = 1) noexcept {
+        if (_counters.empty() || n == 0) {
+            return;
+        }
+        _total += n;
+
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            increment(it->second, n);
+            return;
+        }
+
+        unsigned c;
+        if (_used < _counters.size()) {
+            // free counter, attach it to a bucket with count 0 at the head
+            c = _used++;
+            _counters[c].count = 0;
+            _counters[c].error = 0;
+            const unsigned b = insertBucket(NONE, 0);
+            attach(c, b);
+        } else {
+            // replace a key with the lowest count
+            c = _buckets[_minBucket].head;
+            _index.erase(_counters[c].key);
+            _counters[c].error = _counters[c].count;
+        }
+        _counters[c].key = key;
+        _index[key] = c;
+        increment(c, n);
+    }
+
+    TopKNoLock &operator+=(const TopKNoLock &rhs) noexcept {
+        // a key missing in a full summary has at most its minimum count
+        const uint64_t lhs_min = isFull() ? minCount() : 0;
+        const uint64_t rhs_min = rhs.isFull() ? rhs.minCount() : 0;
+
+        std::vector<Entry> merged;
+        merged.reserve(_used + rhs._used);
+        for (unsigned c = 0; c < _used; c++) {
+            const auto &counter = _counters[c];
+            auto it = rhs._index.find(counter.key);
+            if (it == rhs._index.end()) {
+                merged.push_back({counter.key, counter.count + rhs_min,
+                                  counter.error + rhs_min});
+            } else {
+                const auto &other = rhs._counters[it->second];
+                merged.push_back({counter.key, counter.count + other.count,
+                                  counter.error + other.error});
+            }
+        }
+        for (unsigned c = 0; c < rhs._used; c++) {
+            const auto &counter = rhs._counters[c];
+            if (_index.find(counter.key) == _index.end()) {
+                merged.push_back({counter.key, counter.count + lhs_min,
+                                  counter.error + lhs_min});
+            }
+        }
+
+        const uint64_t total = _total + rhs._total;
+        assign(merged);
+        _total = total;
+        return *this;
+    }
+
+    friend inline TopKNoLock operator+(const TopKNoLock &lhs,
+                                       const TopKNoLock &rhs) noexcept {
+        TopKNoLock result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of counters */
+    unsigned size() const noexcept { return _counters.size(); }
+
+    /** return no of occurrences of all keys */
+    uint64_t count() const noexcept { return _total; }
+
+    /** return counted keys, highest count first */
+    std::vector<Entry> top() const noexcept {
+        std::vector<Entry> result;
+        result.reserve(_used);
+        for (unsigned b = _minBucket; b != NONE; b = _buckets[b].next) {
+            for (unsigned c = _buckets[b].head; c != NONE;
+                 c = _counters[c].next) {
+                result.push_back(
+                    {_counters[c].key, _counters[c].count, _counters[c].error});
+            }
+        }
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /** return estimated count of a key, 0 when not counted */
+    uint64_t count(const K &key) const noexcept {
+        auto it = _index.find(key);
+        return (it == _index.end()) ? 0 : _counters[it->second].count;
+    }
+
+    std::string toString(int /* precision */ = -1) const noexcept {
+        std::ostringstream os;
+        os << "count(" << count() << ") top(";
+        bool first = true;
+        for (const auto &entry : top()) {
+            os << (first ? "" : ", ") << entry.key << ": " << entry.count;
+            first = false;
+        }
+        os << ")";
+        return os.str();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", static_cast<int64_t>(count()));
+        for (const auto &entry : top()) {
+            visitor.entry(keyToString(entry.key),
+                          static_cast<int64_t>(entry.count));
+        }
+    }
+
+    /** append the counted keys to out, see Binary.hpp. K must be an
+     * arithmetic type or std::string. */
+    void serialize(BinaryWriter &out) const {
+        out.write(_total);
+        out.write(_used);
+        for (unsigned c = 0; c < _used; c++) {
+            out.write(_counters[c].key);
+            out.write(_counters[c].count);
+            out.write(_counters[c].error);
+        }
+    }
+
+    /** decode counted keys written by serialize(), a summary with less
+     * counters keeps the keys with the highest count. Unchanged on failure.
+     */
+    bool deserialize(BinaryReader &in) {
+        uint64_t total;
+        size_t used;
+        if (!in.read(total) || !in.readCount(used)) {
+            return false;
+        }
+        std::vector<Entry> entries(used);
+        for (auto &entry : entries) {
+            if (!in.read(entry.key) || !in.read(entry.count) ||
+                !in.read(entry.error)) {
+                return false;
+            }
+        }
+        TopKNoLock result(*this);
+        result.assign(entries);
+        result._total = total;
+        *this = std::move(result);
+        return true;
+    }
+
+  private:
+    static constexpr unsigned NONE = ~0U;
+
+    static const std::string &keyToString(const std::string &key) noexcept {
+        return key;
+    }
+
+    template <typename U> static std::string keyToString(const U &key) {
+        std::ostringstream os;
+        os << key;
+        return os.str();
+    }
+
+    struct Counter {
+        K key{};
+        uint64_t count = 0;
+        uint64_t error = 0;
+        unsigned bucket = NONE;
+        unsigned prev = NONE; /** counters in the same bucket */
+        unsigned next = NONE;
+    };
+
+    struct Bucket {
+        uint64_t count = 0;
+        unsigned head = NONE; /** first counter */
+        unsigned prev = NONE; /** bucket with lower count */
+        unsigned next = NONE; /** bucket with higher count */
+    };
+
+    bool isFull() const noexcept { return _used == _counters.size(); }
+
+    uint64_t minCount() const noexcept {
+        return (_minBucket == NONE) ? 0 : _buckets[_minBucket].count;
+    }
+
+    /** return bucket with count after bucket b (or at the head when b is
+     * NONE), reuses the next bucket when it has that count */
+    unsigned insertBucket(unsigned b, uint64_t count) noexcept {
+        const unsigned next = (b == NONE) ? _minBucket : _buckets[b].next;
+        if (next != NONE && _buckets[next].count == count) {
+            return next;
+        }
+
+        const unsigned nb = _freeBucket;
+        _freeBucket = _buckets[nb].next;
+        _buckets[nb].count = count;
+        _buckets[nb].head = NONE;
+        _buckets[nb].prev = b;
+        _buckets[nb].next = next;
+        if (next != NONE) {
+            _buckets[next].prev = nb;
+        }
+        if (b == NONE) {
+            _minBucket = nb;
+        } else {
+            _buckets[b].next = nb;
+        }
+        return nb;
+    }
+
+    void attach(unsigned c, unsigned b) noexcept {
+        auto &counter = _counters[c];
+        counter.bucket = b;
+        counter.prev = NONE;
+        counter.next = _buckets[b].head;
+        if (counter.next != NONE) {
+            _counters[counter.next].prev = c;
+        }
+        _buckets[b].head = c;
+    }
+
+    /** remove counter from its bucket, frees the bucket when empty */
+    void detach(unsigned c) noexcept {
+        auto &counter = _counters[c];
+        const unsigned b = counter.bucket;
+        if (counter.prev != NONE) {
+            _counters[counter.prev].next = counter.next;
+        } else {
+            _buckets[b].head = counter.next;
+        }
+        if (counter.next != NONE) {
+            _counters[counter.next].prev = counter.prev;
+        }
+
+        auto &bucket = _buckets[b];
+        if (bucket.head != NONE) {
+            return;
+        }
+        if (bucket.prev != NONE) {
+            _buckets[bucket.prev].next = bucket.next;
+        } else {
+            _minBucket = bucket.next;
+        }
+        if (bucket.next != NONE) {
+            _buckets[bucket.next].prev = bucket.prev;
+        }
+        bucket.next = _freeBucket;
+        _freeBucket = b;
+    }
+
+    /** add n to a counter, moves it to the bucket with the new count */
+    void increment(unsigned c, uint64_t n) noexcept {
+        const uint64_t count = _counters[c].count + n;
+        const unsigned b = _counters[c].bucket;
+        _counters[c].count = count;
+
+        // last bucket with a count not above the new count
+        unsigned last = b;
+        while (_buckets[last].next != NONE &&
+               _buckets[_buckets[last].next].count <= count) {
+            last = _buckets[last].next;
+        }
+
+        if (last == b && _buckets[b].head == c &&
+            _counters[c].next == NONE) {
+            // only counter in its bucket and no bucket in between
+            _buckets[b].count = count;
+            return;
+        }
+
+        const unsigned target = (_buckets[last].count == count)
+                                    ? last
+                                    : insertBucket(last, count);
+        detach(c);
+        attach(c, target);
+    }
+
+    /** rebuild from entries, keeps the k entries with the highest count */
+    void assign(std::vector<Entry> &entries) noexcept {
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry &lhs, const Entry &rhs) {
+                      return lhs.count > rhs.count;
+                  });
+        if (entries.size() > _counters.size()) {
+            entries.resize(_counters.size());
+        }
+
+        reset();
+        unsigned b = NONE;
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            const unsigned c = _used++;
+            _counters[c].key = it->key;
+            _counters[c].count = it->count;
+            _counters[c].error = it->error;
+            if (b == NONE || _buckets[b].count != it->count) {
+                b = insertBucket(b, it->count);
+            }
+            attach(c, b);
+            _index[it->key] = c;
+        }
+    }
+
+    std::vector<Counter> _counters;
+    std::vector<Bucket> _buckets;
+    std::unordered_map<K, unsigned> _index{};
+    unsigned _used = 0;          /** no of counters in use */
+    unsigned _minBucket = NONE;  /** bucket with lowest count */
+    unsigned _freeBucket = NONE; /** list of unused buckets */
+    uint64_t _total = 0;
+};
+
+template <typename K> constexpr unsigned TopKNoLock<K>::NONE;
+
+} // namespace Internals
+
+/** Find the most frequent keys in a stream with k counters (Space-Saving).
+ * For multi-threaded ingest, count per thread and merge with +=. */
+template <typename K = std::string, typename M = std::mutex>
+class TopK : public IMetric {
+    using lock_guard = const std::lock_guard<M>;
+
+  public:
+    using Entry = typename Internals::TopKNoLock<K>::Entry;
+
+    /** k = no of counters */
+    explicit TopK(unsigned k) : _state(k) {}
+    ~TopK() override = default;
+
+    TopK(const TopK &other) noexcept : _state(0) {
+        // copy constructor
+        lock_guard lock_other(other._mutex);
+        _state = other._state;
+    }
+
+    TopK &operator=(const TopK &other) noexcept {
+        // copy assignment
+        if (this == &other) {
+            return *this;
+        }
+        // In the very unlikely case that 2 threads simultaneously do a=b and
+        // b=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{other._mutex, std::defer_lock};
+        std::lock(lock1, lock2);
+        _state = other._state;
+        return *this;
+    }
+
+    void reset() noexcept override {
+        lock_guard lock(_mutex);
+        _state.reset();
+    }
+
+    /** count n occurrences of key */
+    void update(const K &key, uint64_t n = 1) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(key, n);
+    }
+
+    TopK &operator+=(const TopK &rhs) noexcept {
+        // In the very unlikely case that 2 threads simultaneously do a+=b and
+        // b+=a, regular lock_guard causes a deadlock
+        std::unique_lock<M> lock1{_mutex, std::defer_lock};
+        std::unique_lock<M> lock2{rhs._mutex, std::defer_lock};
+        if (&rhs == this) {
+            // second lock would deadlock when doing a+=a
+            lock1.lock();
+        } else {
+            std::lock(lock1, lock2);
+        }
+        _state += rhs._state;
+        return *this;
+    }
+
+    friend inline TopK operator+(const TopK &lhs, const TopK &rhs) noexcept {
+        TopK result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    /** return no of counters */
+    unsigned size() const noexcept { return _state.size(); }
+
+    /** return no of occurrences of all keys */
+    uint64_t count() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count();
+    }
+
+    /** return estimated count of a key, 0 when not counted */
+    uint64_t count(const K &key) const noexcept {
+        lock_guard lock(_mutex);
+        return _state.count(key);
+    }
+
+    /** return counted keys, highest count first */
+    std::vector<Entry> top() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.top();
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        lock_guard lock(_mutex);
+        return _state.toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        lock_guard lock(_mutex);
+        _state.visit(visitor);
+    }
+
+  private:
+    Internals::TopKNoLock<K> _state;
+    mutable M _mutex{};
+};
+
+} // namespace Metrics
+
+#endif
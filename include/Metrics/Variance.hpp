@@ -1,71 +1,272 @@
 #ifndef METRICS_VARIANCE_HPP
 #define METRICS_VARIANCE_HPP
 
+#include "Binary.hpp"
+#include "Format.hpp"
 #include "IMetric.hpp"
 #include "MinMax.hpp"
+#include "Weight.hpp"
 #include <algorithm>
 #include <cmath>
-#include <iomanip>
 #include <mutex>
-#include <sstream>
 #include <string>
+#include <type_traits>
 
 namespace Metrics {
 namespace Internals {
-/** Calculate 2nd order statistics incrementally using Welford's algorithm */
-template <typename T = double> class VarianceNoLock {
+/** Accumulate mean and second order moment using Welford's algorithm. Keeps
+ * errors low when there is a large offset, at the cost of a division per
+ * update. The owner keeps the no of values: n is the sum of the weights,
+ * including the value being added. */
+template <typename T = double> class WelfordAccumulator {
   public:
     void reset() noexcept {
-        _minmax.reset();
         _mean = {};
         _m2 = {};
     }
 
-    void update(T value) noexcept {
-        _minmax.update(value);
+    /** called with the first value after a reset, before update() */
+    void first(T) noexcept {}
 
-        // use Welford's algorithm to keep errors low when there is a large
-        // offset
+    void update(T value, T n) noexcept {
         const T delta = value - _mean;
-        _mean += delta / _minmax.count();
+        _mean += delta / n;
 
         const T delta2 = value - _mean;
         _m2 += delta * delta2;
     }
 
-    VarianceNoLock &operator+=(const VarianceNoLock &rhs) noexcept {
-        const auto count_both = count() + rhs.count();
-        if (count_both == 0) {
-            return *this;
+    void update(T value, T weight, T n) noexcept {
+        // West's weighted version of Welford's algorithm
+        const T delta = value - _mean;
+        _mean += delta * weight / n;
+
+        const T delta2 = value - _mean;
+        _m2 += weight * delta * delta2;
+    }
+
+    /** add rhs, n and n_rhs are the sums of the weights of both */
+    void merge(const WelfordAccumulator &rhs, T n, T n_rhs) noexcept {
+        const T n_both = n + n_rhs;
+        if (n_both == 0) {
+            return;
         }
         const T delta = rhs._mean - _mean;
-        _mean = (count() * _mean + rhs.count() * rhs._mean) / count_both;
-        _m2 += rhs._m2 + delta * delta * count() * rhs.count() / count_both;
+        _mean = (n * _mean + n_rhs * rhs._mean) / n_both;
+        _m2 += rhs._m2 + delta * delta * n * n_rhs / n_both;
+    }
+
+    T mean(T) const noexcept { return _mean; }
+    T m2(T) const noexcept { return _m2; }
+
+    void serialize(BinaryWriter &out) const {
+        out.write(_mean);
+        out.write(_m2);
+    }
+
+    bool deserialize(BinaryReader &in) {
+        WelfordAccumulator result;
+        if (!in.read(result._mean) || !in.read(result._m2)) {
+            return false;
+        }
+        *this = result;
+        return true;
+    }
+
+  private:
+    T _mean{};
+    T _m2{};
+};
+
+/** Accumulate shifted sums: the first value is the pivot K, updating adds
+ * x-K and (x-K)^2 without any division. Mean and second order moment are
+ * only calculated when read. Subtracting the pivot keeps the accuracy with a
+ * large offset, as long as the first value is representative. With
+ * COMPENSATED, the sums use Neumaier summation, so rounding errors do not
+ * grow with the no of values. */
+template <typename T = double, bool COMPENSATED = false>
+class ShiftedSumAccumulator {
+  public:
+    void reset() noexcept {
+        _pivot = {};
+        _sum = {};
+        _sum2 = {};
+    }
+
+    /** called with the first value after a reset, before update() */
+    void first(T value) noexcept { _pivot = value; }
+
+    void update(T value, T) noexcept {
+        const T shifted = value - _pivot;
+        _sum.add(shifted);
+        _sum2.add(shifted * shifted);
+    }
+
+    void update(T value, T weight, T) noexcept {
+        const T shifted = value - _pivot;
+        _sum.add(weight * shifted);
+        _sum2.add(weight * shifted * shifted);
+    }
+
+    /** add rhs, n and n_rhs are the sums of the weights of both */
+    void merge(const ShiftedSumAccumulator &rhs, T n, T n_rhs) noexcept {
+        if (n_rhs == 0) {
+            return;
+        }
+        if (n == 0) {
+            *this = rhs;
+            return;
+        }
+        // move the sums of rhs to our pivot: x-K = (x-K_rhs) + d
+        const T d = rhs._pivot - _pivot;
+        const T rhs_sum = rhs._sum.value();
+        _sum2.add(rhs._sum2.value());
+        _sum2.add(2 * d * rhs_sum + n_rhs * d * d);
+        _sum.add(rhs_sum);
+        _sum.add(n_rhs * d);
+    }
+
+    T mean(T n) const noexcept {
+        return (n == 0) ? T{} : _pivot + _sum.value() / n;
+    }
+
+    T m2(T n) const noexcept {
+        if (n == 0) {
+            return {};
+        }
+        const T sum = _sum.value();
+        const T m2 = _sum2.value() - sum * sum / n;
+        // rounding errors
+        return (m2 < 0) ? T{} : m2;
+    }
+
+    void serialize(BinaryWriter &out) const {
+        out.write(_pivot);
+        _sum.serialize(out);
+        _sum2.serialize(out);
+    }
+
+    bool deserialize(BinaryReader &in) {
+        ShiftedSumAccumulator result;
+        if (!in.read(result._pivot) || !result._sum.deserialize(in) ||
+            !result._sum2.deserialize(in)) {
+            return false;
+        }
+        *this = result;
+        return true;
+    }
+
+  private:
+    /** plain sum */
+    struct Sum {
+        void add(T value) noexcept { sum += value; }
+        T value() const noexcept { return sum; }
+        void serialize(BinaryWriter &out) const { out.write(sum); }
+        bool deserialize(BinaryReader &in) { return in.read(sum); }
+        T sum{};
+    };
+
+    /** Neumaier's improved Kahan summation
+     * https://en.wikipedia.org/wiki/Kahan_summation_algorithm */
+    struct CompensatedSum {
+        void add(T value) noexcept {
+            const T t = sum + value;
+            if (std::abs(sum) >= std::abs(value)) {
+                compensation += (sum - t) + value;
+            } else {
+                compensation += (value - t) + sum;
+            }
+            sum = t;
+        }
+        T value() const noexcept { return sum + compensation; }
+        void serialize(BinaryWriter &out) const {
+            out.write(sum);
+            out.write(compensation);
+        }
+        bool deserialize(BinaryReader &in) {
+            return in.read(sum) && in.read(compensation);
+        }
+        T sum{};
+        T compensation{};
+    };
+
+    using Accumulator =
+        typename std::conditional<COMPENSATED, CompensatedSum, Sum>::type;
+
+    T _pivot{};
+    Accumulator _sum{};
+    Accumulator _sum2{};
+};
+
+/** Calculate 2nd order statistics incrementally. A accumulates the mean and
+ * second order moment: WelfordAccumulator (default) or
+ * ShiftedSumAccumulator. WEIGHTED enables update(value, weight). */
+template <typename T = double, typename A = WelfordAccumulator<T>,
+          bool WEIGHTED = false>
+class VarianceNoLock : private WeightSum<T, WEIGHTED> {
+  public:
+    void reset() noexcept {
+        _minmax.reset();
+        this->resetWeight();
+        _acc.reset();
+    }
+
+    void update(T value) noexcept {
+        if (_minmax.count() == 0) {
+            _acc.first(value);
+        }
+        _minmax.update(value);
+        _acc.update(value, weight());
+    }
+
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        static_assert(WEIGHTED, "weighted updates need WEIGHTED = true");
+        if (!(weight > 0)) {
+            return;
+        }
+        if (_minmax.count() == 0) {
+            _acc.first(value);
+        }
+        _minmax.update(value);
+        this->addWeight(weight);
+        _acc.update(value, weight, this->weight());
+    }
+
+    VarianceNoLock &operator+=(const VarianceNoLock &rhs) noexcept {
+        _acc.merge(rhs._acc, weight(), rhs.weight());
         _minmax += rhs._minmax;
+        this->addWeight(rhs);
         return *this;
     }
 
     /** return no of measurements */
     int64_t count() const noexcept { return _minmax.count(); }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept { return this->weightOf(_minmax.count()); }
+
     /** return lowest measured value or NAN when there are no measurements */
     T min() const noexcept { return _minmax.min(); }
 
     /** return mean of measured values or NAN when there are no measurements */
-    T mean() const noexcept { return (_minmax.count() == 0) ? NAN : _mean; }
+    T mean() const noexcept {
+        return (_minmax.count() == 0) ? NAN : _acc.mean(weight());
+    }
 
     /** return mean of measured values or 0 when there are no measurements */
-    T mean0() const noexcept { return _mean; }
+    T mean0() const noexcept { return _acc.mean(weight()); }
 
     /** return highest measured value or NAN when there are no measurements */
     T max() const noexcept { return _minmax.max(); }
 
     /** second order moment: sum of (x-x_mean)^2 */
-    T m2() const noexcept { return _m2; }
+    T m2() const noexcept { return _acc.m2(weight()); }
 
     /** return variance of a population or NAN when there are no measurements */
     T variance() const noexcept {
-        return (_minmax.count() < 1) ? NAN : (_m2 / _minmax.count());
+        return (_minmax.count() < 1) ? NAN : (m2() / weight());
     }
 
     /** standard deviation of a population */
@@ -73,7 +274,7 @@ template <typename T = double> class VarianceNoLock {
 
     /** variance of a sample from a population */
     T sample_variance() const noexcept {
-        return (_minmax.count() < 2) ? NAN : (_m2 / (_minmax.count() - 1));
+        return (weight() <= 1) ? NAN : (m2() / (weight() - 1));
     }
 
     /** standard deviation of a sample of a population */
@@ -81,31 +282,56 @@ template <typename T = double> class VarianceNoLock {
 
     /** RMS value of the samples */
     T rms() const noexcept {
-        return (_minmax.count() < 1)
-                   ? NAN
-                   : sqrt(_mean * _mean + _m2 / _minmax.count());
+        const T mean = _acc.mean(weight());
+        return (_minmax.count() < 1) ? NAN
+                                     : sqrt(mean * mean + m2() / weight());
     }
 
     std::string toString(int precision = -1) const noexcept {
-        std::ostringstream os;
-        if (precision > -1) {
-            os << std::fixed << std::setprecision(precision);
-        }
+        Internals::Formatter os(precision);
         os << "count(" << _minmax.count() << ") min(" << min() << ") mean("
            << mean() << ") max(" << max() << ") sample_stddev("
            << sample_stddev() << ")";
-        return os.str();
+        return os.release();
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept {
+        visitor.field("count", _minmax.count());
+        visitor.field("min", static_cast<double>(min()));
+        visitor.field("mean", static_cast<double>(mean()));
+        visitor.field("max", static_cast<double>(max()));
+        visitor.field("sample_stddev", static_cast<double>(sample_stddev()));
+    }
+
+    /** append the state to out, see Binary.hpp */
+    void serialize(BinaryWriter &out) const {
+        _minmax.serialize(out);
+        this->serializeWeight(out);
+        _acc.serialize(out);
+    }
+
+    /** decode a state written by serialize(), unchanged on failure */
+    bool deserialize(BinaryReader &in) {
+        VarianceNoLock result(*this);
+        if (!result._minmax.deserialize(in) ||
+            !result.deserializeWeight(in) || !result._acc.deserialize(in)) {
+            return false;
+        }
+        *this = result;
+        return true;
     }
 
   private:
     MinMaxNoLock<T> _minmax{};
-    T _mean{};
-    T _m2{};
+    A _acc{};
 };
 
 } // namespace Internals
-/** Calculate 2nd order statistics incrementally using Welford's algorithm */
-template <typename T = double, typename M = std::mutex>
+/** Calculate 2nd order statistics incrementally, by default using Welford's
+ * algorithm. A = Internals::ShiftedSumAccumulator<T> avoids the division
+ * per update. WEIGHTED enables update(value, weight). */
+template <typename T = double, typename M = std::mutex,
+          typename A = Internals::WelfordAccumulator<T>, bool WEIGHTED = false>
 class Variance : public IMetric {
     using lock_guard = const std::lock_guard<M>;
 
@@ -143,6 +369,13 @@ class Variance : public IMetric {
         _state.update(value);
     }
 
+    /** add a value with a frequency weight, e.g. a value which occurred
+     * weight times. Values with weight <= 0 are ignored. */
+    void update(T value, T weight) noexcept {
+        lock_guard lock(_mutex);
+        _state.update(value, weight);
+    }
+
     Variance &operator+=(const Variance &rhs) noexcept {
         // In the very unlikely case that 2 threads simultaneously do a+=b and
         // b+=a, regular lock_guard causes a deadlock
@@ -171,6 +404,12 @@ class Variance : public IMetric {
         return _state.count();
     }
 
+    /** return sum of the weights, equal to count() without weighted updates */
+    T weight() const noexcept {
+        lock_guard lock(_mutex);
+        return _state.weight();
+    }
+
     /** return lowest measured value or NAN when there are no measurements */
     T min() const noexcept {
         lock_guard lock(_mutex);
@@ -231,13 +470,23 @@ class Variance : public IMetric {
         return _state.rms();
     }
 
-    std::string toString(int precision = -1) const noexcept override {
+    /** return copy of the state, to read many values with a single lock */
+    Internals::VarianceNoLock<T, A, WEIGHTED> state() const noexcept {
         lock_guard lock(_mutex);
-        return _state.toString(precision);
+        return _state;
+    }
+
+    std::string toString(int precision = -1) const noexcept override {
+        // format a copy of the state, without holding the lock
+        return state().toString(precision);
+    }
+
+    void visit(IMetricVisitor &visitor) const noexcept override {
+        state().visit(visitor);
     }
 
   private:
-    Internals::VarianceNoLock<T> _state{};
+    Internals::VarianceNoLock<T, A, WEIGHTED> _state{};
     mutable M _mutex{};
 };
 
@@ -0,0 +1,45 @@
+#ifndef METRICS_WEIGHT_HPP
+#define METRICS_WEIGHT_HPP
+
+#include "Binary.hpp"
+#include <cstdint>
+
+namespace Metrics {
+namespace Internals {
+/** Sum of the frequency weights of a statistic, derived from its no of
+ * updates. Only with WEIGHTED, the sum of weight - 1 of the weighted updates
+ * is stored, so unweighted updates only increment an integer count and a
+ * float T keeps counting past 2^24. Without WEIGHTED the class is empty, so a
+ * statistic inheriting from it does not grow. */
+template <typename T, bool WEIGHTED> class WeightSum {
+  protected:
+    /** return the sum of the weights of count updates */
+    T weightOf(int64_t count) const noexcept {
+        return (_extra == 0) ? static_cast<T>(count)
+                             : static_cast<T>(count + _extra);
+    }
+
+    void resetWeight() noexcept { _extra = 0; }
+    void addWeight(T weight) noexcept { _extra += weight - 1; }
+    void addWeight(const WeightSum &rhs) noexcept { _extra += rhs._extra; }
+    void serializeWeight(BinaryWriter &out) const { out.write(_extra); }
+    bool deserializeWeight(BinaryReader &in) { return in.read(_extra); }
+
+  private:
+    double _extra{};
+};
+
+template <typename T> class WeightSum<T, false> {
+  protected:
+    T weightOf(int64_t count) const noexcept { return static_cast<T>(count); }
+
+    void resetWeight() noexcept {}
+    void addWeight(const WeightSum &) noexcept {}
+    void serializeWeight(BinaryWriter &) const {}
+    bool deserializeWeight(BinaryReader &) { return true; }
+};
+
+} // namespace Internals
+} // namespace Metrics
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TESTS_MANUALCLOCK_HPP
+#define TESTS_MANUALCLOCK_HPP
+
+#include <chrono>
+
+/** std::chrono compatible clock which only advances when told so */
+struct ManualClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<ManualClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept { return current(); }
+    static void advance(duration d) noexcept { current() += d; }
+
+  private:
+    static time_point &current() noexcept {
+        static time_point t{};
+        return t;
+    }
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "Metrics/Arena.hpp"
+#include "Metrics/FixedSamplingReservoir.hpp"
+#include "Metrics/FixedSlidingWindowReservoir.hpp"
+#include "Metrics/Histogram.hpp"
+#include "Metrics/SamplingReservoir.hpp"
+#include "Metrics/SlidingWindowReservoir.hpp"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+using Allocator = Metrics::ArenaAllocator<double>;
+
+TEST(TestArena, allocateInBuffer) {
+    alignas(8) char buffer[64];
+    Metrics::Arena dut(buffer, sizeof buffer);
+
+    void *p1 = dut.allocate(3, 1);
+    void *p2 = dut.allocate(8, 8);
+    EXPECT_EQ(buffer, p1);
+    EXPECT_EQ(buffer + 8, p2);
+    EXPECT_EQ(16, dut.used());
+    EXPECT_EQ(0, dut.overflows());
+
+    dut.deallocate(p1);
+    EXPECT_EQ(16, dut.used());
+    dut.clear();
+    EXPECT_EQ(0, dut.used());
+    EXPECT_EQ(buffer, dut.allocate(8, 8));
+}
+
+TEST(TestArena, overflowToHeap) {
+    alignas(8) char buffer[16];
+    Metrics::Arena dut(buffer, sizeof buffer);
+
+    void *p = dut.allocate(32, 8);
+    EXPECT_NE(nullptr, p);
+    EXPECT_EQ(1, dut.overflows());
+    EXPECT_EQ(0, dut.used());
+    dut.deallocate(p);
+}
+
+TEST(TestArena, vector) {
+    alignas(8) char buffer[256];
+    Metrics::Arena arena(buffer, sizeof buffer);
+    std::vector<double, Allocator> dut{Allocator(arena)};
+
+    dut.reserve(10);
+    for (int i = 0; i < 10; i++) {
+        dut.push_back(i);
+    }
+    EXPECT_EQ(10 * sizeof(double), arena.used());
+    EXPECT_EQ(0, arena.overflows());
+}
+
+TEST(TestArena, snapshotPerReport) {
+    // reservoir storage and snapshots use different arenas, the snapshot
+    // arena is cleared after each report
+    alignas(8) char storage[1024];
+    alignas(8) char scratch[1024];
+    Metrics::Arena storageArena(storage, sizeof storage);
+    Metrics::Arena reportArena(scratch, sizeof scratch);
+    Metrics::SamplingReservoir<double, std::mutex,
+                               Metrics::IdentityCodec<double>, Allocator>
+        dut(10, Metrics::IdentityCodec<double>(), Allocator(storageArena));
+    const size_t storageUsed = storageArena.used();
+    EXPECT_GE(storageUsed, 10 * sizeof(double));
+
+    for (int report = 0; report < 3; report++) {
+        for (int i = 0; i < 100; i++) {
+            dut.update(i);
+        }
+        auto snapshot = dut.getSnapshot(Allocator(reportArena));
+        EXPECT_EQ(10, snapshot.size());
+        EXPECT_EQ(10 * sizeof(double), reportArena.used());
+        auto bins = snapshot.getBins(2, 0, 100);
+        EXPECT_EQ(10, bins[0] + bins[1]);
+        reportArena.clear();
+    }
+    EXPECT_EQ(storageUsed, storageArena.used());
+    EXPECT_EQ(0, storageArena.overflows());
+    EXPECT_EQ(0, reportArena.overflows());
+}
+
+TEST(TestArena, histogram) {
+    alignas(8) char buffer[1024];
+    Metrics::Arena arena(buffer, sizeof buffer);
+    Metrics::Histogram<Metrics::SlidingWindowReservoir<
+        double, std::mutex, Metrics::IdentityCodec<double>, Allocator>>
+        dut(Metrics::ReservoirArgs{}, false, -1, 4,
+            Metrics::IdentityCodec<double>(), Allocator(arena));
+
+    dut.update(3);
+    dut.update(1);
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(1, snapshot.getValue(0));
+    EXPECT_EQ(3, snapshot.getValue(1));
+    EXPECT_EQ(&arena, snapshot.values().get_allocator().arena());
+    EXPECT_EQ(0, arena.overflows());
+}
+
+TEST(TestArena, fixedReservoirs) {
+    alignas(8) char buffer[1024];
+    Metrics::Arena arena(buffer, sizeof buffer);
+    Metrics::FixedSamplingReservoir<double, 4, std::mutex,
+                                    Metrics::IdentityCodec<double>, Allocator>
+        sampling(Metrics::IdentityCodec<double>(), Allocator{arena});
+    Metrics::Histogram<
+        Metrics::FixedSlidingWindowReservoir<double, 4, std::mutex, Allocator>>
+        window(Metrics::ReservoirArgs{}, false, -1, Allocator{arena});
+
+    sampling.update(3);
+    window.update(1);
+    auto samplingSnapshot = sampling.getSnapshot();
+    auto windowSnapshot = window.getSnapshot();
+    EXPECT_EQ(3, samplingSnapshot.getValue(0));
+    EXPECT_EQ(1, windowSnapshot.getValue(0));
+    EXPECT_EQ(&arena, samplingSnapshot.values().get_allocator().arena());
+    EXPECT_EQ(&arena, windowSnapshot.values().get_allocator().arena());
+    EXPECT_EQ(0, arena.overflows());
+}
+
+} // namespace
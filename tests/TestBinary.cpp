@@ -0,0 +1,492 @@
+#include "ManualClock.hpp"
+#include "Metrics/Binary.hpp"
+#include "Metrics/Covariance.hpp"
+#include "Metrics/EwmaVariance.hpp"
+#include "Metrics/ExponentiallyDecayingReservoir.hpp"
+#include "Metrics/FixedSamplingReservoir.hpp"
+#include "Metrics/FixedSlidingWindowReservoir.hpp"
+#include "Metrics/Histogram.hpp"
+#include "Metrics/Kurtosis.hpp"
+#include "Metrics/LinearRegression.hpp"
+#include "Metrics/MinMax.hpp"
+#include "Metrics/MinMeanMax.hpp"
+#include "Metrics/Moments.hpp"
+#include "Metrics/RollingVariance.hpp"
+#include "Metrics/SamplingReservoir.hpp"
+#include "Metrics/SlidingTimeWindowReservoir.hpp"
+#include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Snapshot.hpp"
+#include "Metrics/Stats.hpp"
+#include "Metrics/TopK.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+using namespace Metrics::Internals;
+using namespace Metrics::Feature;
+
+/** serialize from, deserialize into to, and compare the text output */
+template <typename S> void expectRoundTrip(const S &from, S &to) {
+    const auto data = Metrics::serialize(from);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ(from.toString(17), to.toString(17));
+}
+
+template <typename T, typename A>
+std::vector<T> snapshotValues(const Metrics::IReservoir<T, A> &reservoir) {
+    const auto snapshot = reservoir.getSnapshot();
+    return std::vector<T>(snapshot.values().begin(), snapshot.values().end());
+}
+
+/** reservoir with only the pure virtual functions of IReservoir */
+class MinimalReservoir : public Metrics::IReservoir<double> {
+  public:
+    void reset() noexcept override { _values.clear(); }
+    void update(double value) noexcept override { _values.push_back(value); }
+    unsigned size() const noexcept override { return 100; }
+    unsigned samples() const noexcept override { return _values.size(); }
+    const double *data() const noexcept override { return _values.data(); }
+    Metrics::Snapshot<double> getSnapshot() const noexcept override {
+        return Metrics::Snapshot<double>(_values.begin(), _values.end());
+    }
+
+  private:
+    std::vector<double> _values;
+};
+
+TEST(TestBinary, varint) {
+    std::vector<uint8_t> out;
+    Metrics::BinaryWriter writer(out);
+    writer.write(0u);
+    writer.write(127u);
+    writer.write(300u);
+    EXPECT_EQ((std::vector<uint8_t>{0x00, 0x7f, 0xac, 0x02}), out);
+
+    Metrics::BinaryReader reader(out.data(), out.size());
+    unsigned a, b, c;
+    EXPECT_TRUE(reader.read(a) && reader.read(b) && reader.read(c));
+    EXPECT_EQ(0, a);
+    EXPECT_EQ(127, b);
+    EXPECT_EQ(300, c);
+    EXPECT_EQ(0, reader.remaining());
+    EXPECT_FALSE(reader.read(a));
+}
+
+TEST(TestBinary, zigzag) {
+    std::vector<uint8_t> out;
+    Metrics::BinaryWriter writer(out);
+    writer.write(int64_t{0});
+    writer.write(int64_t{-1});
+    writer.write(int64_t{1});
+    writer.write(int64_t{-64});
+    writer.write(INT64_MIN);
+    EXPECT_EQ(0x00, out[0]);
+    EXPECT_EQ(0x01, out[1]);
+    EXPECT_EQ(0x02, out[2]);
+    EXPECT_EQ(0x7f, out[3]);
+
+    Metrics::BinaryReader reader(out.data(), out.size());
+    int64_t values[5];
+    for (auto &value : values) {
+        EXPECT_TRUE(reader.read(value));
+    }
+    EXPECT_EQ(-1, values[1]);
+    EXPECT_EQ(-64, values[3]);
+    EXPECT_EQ(INT64_MIN, values[4]);
+}
+
+TEST(TestBinary, doubleLittleEndian) {
+    std::vector<uint8_t> out;
+    Metrics::BinaryWriter writer(out);
+    writer.write(1.0);
+    writer.write(-2.5f);
+    EXPECT_EQ((std::vector<uint8_t>{0, 0, 0, 0, 0, 0, 0xf0, 0x3f, 0, 0, 0x20,
+                                    0xc0}),
+              out);
+
+    Metrics::BinaryReader reader(out.data(), out.size());
+    double d;
+    float f;
+    EXPECT_TRUE(reader.read(d) && reader.read(f));
+    EXPECT_EQ(1.0, d);
+    EXPECT_EQ(-2.5f, f);
+}
+
+TEST(TestBinary, readerRejectsOutOfRange) {
+    std::vector<uint8_t> out;
+    Metrics::BinaryWriter writer(out);
+    writer.write(300u);
+    writer.write(1u);
+
+    Metrics::BinaryReader reader(out.data(), out.size());
+    uint8_t value;
+    EXPECT_FALSE(reader.read(value));
+    // all further reads fail
+    EXPECT_FALSE(reader.read(value));
+}
+
+TEST(TestBinary, string) {
+    std::vector<uint8_t> out;
+    Metrics::BinaryWriter writer(out);
+    writer.write(std::string("abc"));
+    EXPECT_EQ(4, out.size());
+
+    Metrics::BinaryReader reader(out.data(), out.size());
+    std::string value;
+    EXPECT_TRUE(reader.read(value));
+    EXPECT_EQ("abc", value);
+
+    Metrics::BinaryReader truncated(out.data(), out.size() - 1);
+    EXPECT_FALSE(truncated.read(value));
+}
+
+TEST(TestBinary, version) {
+    MinMaxNoLock<double> dut;
+    const auto data = Metrics::serialize(dut);
+    EXPECT_EQ((std::vector<uint8_t>{Metrics::BINARY_VERSION, 0}), data);
+
+    auto wrongVersion = data;
+    wrongVersion[0]++;
+    EXPECT_FALSE(Metrics::deserialize(dut, wrongVersion));
+}
+
+TEST(TestBinary, invalidDataLeavesStateUnchanged) {
+    VarianceNoLock<double> from;
+    for (int i = 0; i < 10; i++) {
+        from.update(i);
+    }
+    const auto data = Metrics::serialize(from);
+
+    VarianceNoLock<double> dut;
+    dut.update(42.0);
+    const auto expected = dut.toString(17);
+    for (size_t size = 0; size < data.size(); size++) {
+        EXPECT_FALSE(Metrics::deserialize(dut, data.data(), size));
+        EXPECT_EQ(expected, dut.toString(17));
+    }
+
+    auto trailing = data;
+    trailing.push_back(0);
+    EXPECT_FALSE(Metrics::deserialize(dut, trailing));
+}
+
+TEST(TestBinary, compact) {
+    VarianceNoLock<double> dut;
+    for (int i = 0; i < 1000; i++) {
+        dut.update(i);
+    }
+    // version, count, min, max, mean, m2
+    EXPECT_EQ(1 + 2 + 4 * 8, Metrics::serialize(dut).size());
+}
+
+TEST(TestBinary, minMax) {
+    MinMaxNoLock<double> from, to;
+    expectRoundTrip(from, to);
+    from.update(3);
+    from.update(-1);
+    expectRoundTrip(from, to);
+}
+
+TEST(TestBinary, minMeanMax) {
+    MinMeanMaxNoLock<float, true> from, to;
+    from.update(3);
+    from.update(4, 2);
+    expectRoundTrip(from, to);
+}
+
+TEST(TestBinary, kurtosis) {
+    KurtosisNoLock<double> from, to;
+    for (int i = 0; i < 10; i++) {
+        from.update(i * i);
+    }
+    expectRoundTrip(from, to);
+}
+
+TEST(TestBinary, linearRegression) {
+    LinearRegressionNoLock<double> from, to;
+    from.update(1, 3);
+    from.update(2, 5);
+    from.update(4, 8);
+    expectRoundTrip(from, to);
+}
+
+TEST(TestBinary, variance) {
+    VarianceNoLock<double> welford, welfordTo;
+    VarianceNoLock<double, ShiftedSumAccumulator<double, true>> shifted,
+        shiftedTo;
+    for (int i = 0; i < 10; i++) {
+        welford.update(1e6 + i);
+        shifted.update(1e6 + i);
+    }
+    expectRoundTrip(welford, welfordTo);
+    expectRoundTrip(shifted, shiftedTo);
+}
+
+TEST(TestBinary, mergeAfterDeserialize) {
+    VarianceNoLock<double> a, b, all;
+    for (int i = 0; i < 10; i++) {
+        ((i % 2) ? a : b).update(i);
+        all.update(i);
+    }
+
+    VarianceNoLock<double> merged, other;
+    ASSERT_TRUE(Metrics::deserialize(merged, Metrics::serialize(a)));
+    ASSERT_TRUE(Metrics::deserialize(other, Metrics::serialize(b)));
+    merged += other;
+    EXPECT_EQ(all.count(), merged.count());
+    EXPECT_DOUBLE_EQ(all.mean(), merged.mean());
+    EXPECT_DOUBLE_EQ(all.variance(), merged.variance());
+    EXPECT_EQ(all.min(), merged.min());
+    EXPECT_EQ(all.max(), merged.max());
+}
+
+TEST(TestBinary, ewmaVariance) {
+    EwmaVarianceNoLock<double> from(0.2), to(0.5);
+    from.update(1);
+    from.update(3);
+    expectRoundTrip(from, to);
+
+    // alpha is part of the state
+    from.update(5);
+    to.update(5);
+    EXPECT_EQ(from.toString(17), to.toString(17));
+}
+
+TEST(TestBinary, moments) {
+    MomentsNoLock<4, double> from, to;
+    for (int i = 0; i < 10; i++) {
+        from.update(i * i);
+    }
+    expectRoundTrip(from, to);
+
+    MomentsNoLock<3, double> other;
+    EXPECT_FALSE(Metrics::deserialize(other, Metrics::serialize(from)));
+}
+
+TEST(TestBinary, covariance) {
+    CovarianceNoLock<double> from(3), to(1);
+    from.update(std::vector<double>{1, 2, 3});
+    from.update(std::vector<double>{2, 5, 1});
+    expectRoundTrip(from, to);
+    EXPECT_EQ(from.correlation(0, 1), to.correlation(0, 1));
+}
+
+TEST(TestBinary, rollingVariance) {
+    RollingVarianceNoLock<double> from(4), to(4);
+    for (int i = 0; i < 10; i++) {
+        from.update(i * i);
+    }
+    expectRoundTrip(from, to);
+
+    // the window is restored: the oldest value leaves first
+    from.update(-1);
+    to.update(-1);
+    EXPECT_EQ(from.toString(17), to.toString(17));
+
+    // a smaller window keeps the newest values
+    RollingVarianceNoLock<double> smaller(3);
+    ASSERT_TRUE(Metrics::deserialize(smaller, Metrics::serialize(from)));
+    EXPECT_EQ(3, smaller.count());
+    EXPECT_EQ(-1, smaller.min());
+    EXPECT_EQ(81, smaller.max());
+    EXPECT_DOUBLE_EQ((64 + 81 - 1) / 3.0, smaller.mean());
+}
+
+TEST(TestBinary, stats) {
+    StatsNoLock<double, Count, Min, Max, M2> from, to;
+    from.update(2);
+    from.update(7);
+    expectRoundTrip(from, to);
+
+    StatsNoLock<double, Count, Min> other;
+    EXPECT_FALSE(Metrics::deserialize(other, Metrics::serialize(from)));
+}
+
+TEST(TestBinary, topK) {
+    TopKNoLock<std::string> from(3), to(3);
+    for (int i = 0; i < 20; i++) {
+        from.update(std::string(1, static_cast<char>('a' + i % 5)), i);
+    }
+    expectRoundTrip(from, to);
+
+    TopKNoLock<int> numbers(2), numbersTo(2);
+    numbers.update(-5, 3);
+    numbers.update(7);
+    expectRoundTrip(numbers, numbersTo);
+}
+
+TEST(TestBinary, snapshot) {
+    Metrics::Snapshot<double> from({3, 1, 2}), to;
+    const auto data = Metrics::serialize(from);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ(3, to.size());
+    EXPECT_EQ(from.values(), to.values());
+}
+
+TEST(TestBinary, slidingWindowReservoir) {
+    Metrics::SlidingWindowReservoir<double> from(3), to(5);
+    for (int i = 0; i < 5; i++) {
+        from.update(i);
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    EXPECT_EQ(snapshotValues(from), snapshotValues(to));
+
+    // samples are restored oldest first
+    to.update(5);
+    to.update(6);
+    to.update(7);
+    EXPECT_EQ((std::vector<double>{3, 4, 5, 6, 7}), snapshotValues(to));
+}
+
+TEST(TestBinary, fixedSlidingWindowReservoir) {
+    Metrics::FixedSlidingWindowReservoir<double, 3> from;
+    Metrics::FixedSlidingWindowReservoir<double, 2> to;
+    for (int i = 0; i < 5; i++) {
+        from.update(i);
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    EXPECT_EQ((std::vector<double>{3, 4}), snapshotValues(to));
+}
+
+TEST(TestBinary, samplingReservoir) {
+    Metrics::SamplingReservoir<double> from(4), to(4);
+    for (int i = 0; i < 100; i++) {
+        from.update(i);
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    EXPECT_EQ(100, to.count());
+    EXPECT_EQ(snapshotValues(from), snapshotValues(to));
+
+    Metrics::SamplingReservoir<double> otherSize(5);
+    EXPECT_FALSE(Metrics::deserialize(otherSize, Metrics::serialize(from)));
+}
+
+TEST(TestBinary, samplingContinuesAfterDeserialize) {
+    constexpr unsigned N = 1000;
+    Metrics::SamplingReservoir<double> from(N), to(N);
+    for (unsigned i = 0; i < 10 * N; i++) {
+        from.update(0);
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    for (unsigned i = 0; i < 10 * N; i++) {
+        to.update(1);
+    }
+
+    // half of all values are 1
+    double ones = 0;
+    for (double value : snapshotValues(to)) {
+        ones += value;
+    }
+    EXPECT_NEAR(0.5, ones / N, 0.1);
+}
+
+TEST(TestBinary, weightedSamplingReservoir) {
+    Metrics::SamplingReservoir<double> from(4), to(4);
+    for (int i = 0; i < 100; i++) {
+        from.update(i, 1 + i % 3);
+    }
+    const auto data = Metrics::serialize(from);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ(snapshotValues(from), snapshotValues(to));
+}
+
+TEST(TestBinary, reservoirDefaults) {
+    MinimalReservoir from, to;
+    from.update(3);
+    from.update(1);
+    to.update(7);
+    const Metrics::IReservoir<double> &reservoir = from;
+    Metrics::Snapshot<double> snapshot;
+    reservoir.getSnapshot(snapshot);
+    EXPECT_EQ(2, snapshot.size());
+    EXPECT_EQ(2, reservoir.getSnapshot(std::allocator<double>()).size());
+
+    const auto data = Metrics::serialize(from);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ((std::vector<double>{1, 3}), snapshotValues(to));
+    const std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+    EXPECT_FALSE(Metrics::deserialize(to, truncated));
+    EXPECT_EQ((std::vector<double>{1, 3}), snapshotValues(to));
+}
+
+TEST(TestBinary, fixedSamplingReservoir) {
+    Metrics::FixedSamplingReservoir<double, 4> from, to;
+    for (int i = 0; i < 100; i++) {
+        from.update(i);
+    }
+    const auto data = Metrics::serialize(from);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ(100, to.count());
+    EXPECT_EQ(snapshotValues(from), snapshotValues(to));
+
+    Metrics::FixedSamplingReservoir<double, 4> unchanged;
+    unchanged.update(-1);
+    const std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+    EXPECT_FALSE(Metrics::deserialize(unchanged, truncated));
+    EXPECT_EQ(1, unchanged.count());
+    EXPECT_EQ(std::vector<double>{-1}, snapshotValues(unchanged));
+}
+
+TEST(TestBinary, exponentiallyDecayingReservoir) {
+    using Reservoir =
+        Metrics::ExponentiallyDecayingReservoir<double, std::mutex,
+                                                ManualClock>;
+    Reservoir from(4), to(4), smaller(2);
+    for (int i = 0; i < 10; i++) {
+        from.update(i);
+        ManualClock::advance(std::chrono::seconds(10));
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    EXPECT_EQ(10, to.count());
+    auto expected = snapshotValues(from);
+    EXPECT_EQ(expected, snapshotValues(to));
+
+    // the samples with the highest priority are kept
+    ASSERT_TRUE(Metrics::deserialize(smaller, Metrics::serialize(from)));
+    EXPECT_EQ(2, smaller.samples());
+    for (double value : snapshotValues(smaller)) {
+        EXPECT_NE(expected.end(),
+                  std::find(expected.begin(), expected.end(), value));
+    }
+
+    Reservoir empty(0);
+    empty.update(1);
+    ASSERT_TRUE(Metrics::deserialize(empty, Metrics::serialize(from)));
+    EXPECT_EQ(10, empty.count());
+    EXPECT_EQ(0, empty.samples());
+}
+
+TEST(TestBinary, slidingTimeWindowReservoir) {
+    using Reservoir =
+        Metrics::SlidingTimeWindowReservoir<double, std::mutex, ManualClock>;
+    Reservoir from(100), to(100);
+    for (int i = 0; i < 10; i++) {
+        from.update(i);
+        ManualClock::advance(std::chrono::seconds(10));
+    }
+    ASSERT_TRUE(Metrics::deserialize(to, Metrics::serialize(from)));
+    EXPECT_EQ((std::vector<double>{4, 5, 6, 7, 8, 9}), snapshotValues(to));
+
+    // samples keep their age
+    ManualClock::advance(std::chrono::seconds(20));
+    EXPECT_EQ(snapshotValues(from), snapshotValues(to));
+    EXPECT_EQ((std::vector<double>{6, 7, 8, 9}), snapshotValues(to));
+}
+
+TEST(TestBinary, histogram) {
+    Metrics::Histogram<Metrics::SlidingWindowReservoir<double>> from(10),
+        to(10);
+    from.update(1);
+    from.update(2);
+    std::vector<uint8_t> data;
+    Metrics::serialize(from, data);
+    ASSERT_TRUE(Metrics::deserialize(to, data));
+    EXPECT_EQ(from.toString(), to.toString());
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+#include "Metrics/Codec.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+TEST(TestCodec, identity) {
+    Metrics::IdentityCodec<double> dut;
+
+    EXPECT_EQ(1.25, dut.decode(dut.encode(1.25)));
+    EXPECT_EQ(sizeof(double), sizeof(decltype(dut)::Stored));
+}
+
+TEST(TestCodec, narrow) {
+    Metrics::NarrowCodec<double> dut;
+
+    EXPECT_EQ(sizeof(float), sizeof(decltype(dut)::Stored));
+    EXPECT_EQ(1.25, dut.decode(dut.encode(1.25)));
+    EXPECT_NEAR(0.1, dut.decode(dut.encode(0.1)), 1e-8);
+}
+
+TEST(TestCodec, fixedPoint) {
+    Metrics::FixedPointCodec<double> dut{0.001};
+
+    EXPECT_EQ(1235, dut.encode(1.2345001));
+    EXPECT_DOUBLE_EQ(1.235, dut.decode(dut.encode(1.2345001)));
+    EXPECT_DOUBLE_EQ(-2.0, dut.decode(dut.encode(-2.0)));
+
+    // clamped
+    EXPECT_EQ(std::numeric_limits<int32_t>::max(), dut.encode(1e10));
+    EXPECT_EQ(std::numeric_limits<int32_t>::min(), dut.encode(-1e10));
+}
+
+TEST(TestCodec, fixedPoint16) {
+    Metrics::FixedPointCodec<double, int16_t> dut{0.5};
+
+    EXPECT_EQ(sizeof(int16_t), sizeof(decltype(dut)::Stored));
+    EXPECT_DOUBLE_EQ(100.5, dut.decode(dut.encode(100.4)));
+    EXPECT_EQ(32767, dut.encode(1e6));
+}
+
+TEST(TestCodec, log16) {
+    Metrics::Log16Codec<double> dut;
+
+    EXPECT_EQ(sizeof(uint16_t), sizeof(decltype(dut)::Stored));
+    for (double value : {1e-9, 3.3e-6, 0.1, 1.0, 42.0, 1234567.0, 1e9}) {
+        EXPECT_NEAR(value, dut.decode(dut.encode(value)), value * 7e-4);
+        EXPECT_NEAR(-value, dut.decode(dut.encode(-value)), value * 7e-4);
+    }
+
+    // out of range
+    EXPECT_EQ(0, dut.decode(dut.encode(0.0)));
+    EXPECT_EQ(0, dut.decode(dut.encode(1e-12)));
+    EXPECT_NEAR(1e9, dut.decode(dut.encode(1e12)), 1e9 * 7e-4);
+    EXPECT_EQ(0, dut.decode(dut.encode(NAN)));
+}
+
+TEST(TestCodec, log16Monotonic) {
+    Metrics::Log16Codec<double> dut{1e-3, 1e3};
+
+    double previous = -1e4;
+    for (double value = -1e3; value <= 1e3; value += 0.37) {
+        const double decoded = dut.decode(dut.encode(value));
+        EXPECT_GE(decoded, previous);
+        previous = decoded;
+    }
+}
+
+} // namespace
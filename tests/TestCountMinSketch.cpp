@@ -0,0 +1,132 @@
+#include "Metrics/CountMinSketch.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(TestCountMinSketch, empty) {
+    Metrics::CountMinSketch dut{1000, 5};
+
+    EXPECT_EQ(1024, dut.width());
+    EXPECT_EQ(5, dut.depth());
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.estimate(42));
+    EXPECT_EQ("count(0) width(1024) depth(5)", dut.toString());
+}
+
+TEST(TestCountMinSketch, depthClamped) {
+    EXPECT_EQ(1, Metrics::CountMinSketch(16, 0).depth());
+    EXPECT_EQ(16, Metrics::CountMinSketch(16, 100).depth());
+}
+
+TEST(TestCountMinSketch, exactWithFewKeys) {
+    Metrics::CountMinSketch dut;
+
+    dut.update(std::string("GET"), 3);
+    dut.update(std::string("PUT"));
+    dut.update(std::string("GET"));
+    EXPECT_EQ(4, dut.estimate(std::string("GET")));
+    EXPECT_EQ(1, dut.estimate(std::string("PUT")));
+    EXPECT_EQ(5, dut.count());
+}
+
+TEST(TestCountMinSketch, errorBound) {
+    for (bool conservative : {false, true}) {
+        Metrics::CountMinSketch dut{256, 4, conservative};
+        std::map<int, uint64_t> exact;
+        for (int i = 0; i < 20000; i++) {
+            // skewed: low keys are frequent
+            const int key = (i * i) % 1009 % (1 + i % 97);
+            dut.update(key);
+            exact[key]++;
+        }
+
+        const double max_error = std::exp(1.0) * dut.count() / dut.width();
+        for (const auto &entry : exact) {
+            EXPECT_GE(dut.estimate(entry.first), entry.second);
+            EXPECT_LE(dut.estimate(entry.first), entry.second + max_error)
+                << "key " << entry.first;
+        }
+    }
+}
+
+TEST(TestCountMinSketch, conservativeOvercountsLess) {
+    Metrics::CountMinSketch plain{64, 2, false};
+    Metrics::CountMinSketch conservative{64, 2, true};
+    for (int i = 0; i < 10000; i++) {
+        const int key = (i % 2 == 0) ? 0 : i;
+        plain.update(key);
+        conservative.update(key);
+    }
+
+    uint64_t plain_sum = 0;
+    uint64_t conservative_sum = 0;
+    for (int key = 1; key < 200; key += 2) {
+        plain_sum += plain.estimate(key);
+        conservative_sum += conservative.estimate(key);
+    }
+    EXPECT_LT(conservative_sum, plain_sum);
+}
+
+TEST(TestCountMinSketch, merge) {
+    Metrics::CountMinSketch dut1;
+    Metrics::CountMinSketch dut2;
+    Metrics::CountMinSketch other_size{16};
+
+    dut1.update(1, 10);
+    dut2.update(1, 5);
+    dut2.update(2, 7);
+    dut1 += dut2;
+    EXPECT_EQ(15, dut1.estimate(1));
+    EXPECT_EQ(7, dut1.estimate(2));
+    EXPECT_EQ(22, dut1.count());
+
+    // different dimensions are refused
+    EXPECT_FALSE(dut1.merge(other_size));
+    EXPECT_THROW(dut1 += other_size, std::invalid_argument);
+    EXPECT_EQ(22, dut1.count());
+
+    EXPECT_TRUE(dut1.merge(dut2));
+    EXPECT_EQ(20, dut1.estimate(1));
+
+    dut1 += dut1;
+    EXPECT_EQ(40, dut1.estimate(1));
+}
+
+TEST(TestCountMinSketch, reset) {
+    Metrics::CountMinSketch dut;
+    dut.update(1, 10);
+    dut.reset();
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.estimate(1));
+}
+
+TEST(TestCountMinSketch, threads) {
+    const int no_threads = 4;
+    const int loops = 10000;
+    Metrics::CountMinSketch dut{1024, 4};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < no_threads; t++) {
+        threads.emplace_back([&dut]() {
+            for (int i = 0; i < loops; i++) {
+                dut.update(i % 10);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(no_threads * loops, dut.count());
+    for (int key = 0; key < 10; key++) {
+        EXPECT_GE(dut.estimate(key), no_threads * loops / 10);
+    }
+}
+
+} // namespace
@@ -0,0 +1,67 @@
+#include "Metrics/Counter.hpp"
+#include "Metrics/Registry.hpp"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(TestCounter, incDec) {
+    Metrics::Counter<> dut;
+
+    EXPECT_EQ(0, dut.count());
+    dut.inc();
+    dut.inc(10);
+    dut.dec(3);
+    EXPECT_EQ(8, dut.count());
+    dut.dec();
+    EXPECT_EQ(7, dut.count());
+}
+
+TEST(TestCounter, reset) {
+    Metrics::Counter<> dut;
+
+    dut.inc(5);
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+}
+
+template <typename T> void countFromThreads() {
+    constexpr int THREADS = 8;
+    constexpr int LOOPS = 100000;
+    T dut;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; i++) {
+        threads.emplace_back([&dut]() {
+            for (int j = 0; j < LOOPS; j++) {
+                dut.inc();
+            }
+            dut.dec();
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(THREADS * (LOOPS - 1), dut.count());
+}
+
+TEST(TestCounter, multipleThreads) {
+    countFromThreads<Metrics::Counter<>>();
+}
+
+TEST(TestCounter, multipleThreadsCpuCells) {
+    countFromThreads<Metrics::Counter<Metrics::Internals::CpuCellIndex>>();
+}
+
+TEST(TestCounter, registry) {
+    Metrics::Registry registry;
+    auto counter = std::make_shared<Metrics::Counter<>>();
+    registry.addMetric("hits", counter);
+
+    counter->inc(42);
+    EXPECT_EQ("hits: 42\n", registry.reportString());
+    registry.resetMetrics();
+    EXPECT_EQ(0, counter->count());
+}
+} // namespace
@@ -0,0 +1,134 @@
+#include "Metrics/Covariance.hpp"
+#include "Metrics/LinearRegression.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+/** deterministic, correlated test signals */
+std::vector<double> sample(int i) {
+    const double x = std::sin(i * 0.1);
+    return {1e6 + x, 2 * x + std::cos(i * 0.37), -x, static_cast<double>(i)};
+}
+
+TEST(TestCovariance, noValue) {
+    Metrics::Covariance<> dut{3};
+
+    EXPECT_EQ(3, dut.dimensions());
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.mean(0)));
+    EXPECT_TRUE(std::isnan(dut.covariance(0, 1)));
+    EXPECT_TRUE(std::isnan(dut.correlation(0, 1)));
+}
+
+TEST(TestCovariance, matchesPairwise) {
+    constexpr int K = 4;
+    Metrics::Covariance<> dut{K};
+    Metrics::Variance<> variance[K];
+    Metrics::LinearRegression<> pairs[K][K];
+
+    for (int n = 0; n < 1000; n++) {
+        auto values = sample(n);
+        dut.update(values);
+        for (int i = 0; i < K; i++) {
+            variance[i].update(values[i]);
+            for (int j = 0; j < K; j++) {
+                pairs[i][j].update(values[i], values[j]);
+            }
+        }
+    }
+
+    EXPECT_EQ(1000, dut.count());
+    for (int i = 0; i < K; i++) {
+        EXPECT_DOUBLE_EQ(variance[i].mean(), dut.mean(i));
+        EXPECT_NEAR(variance[i].variance(), dut.variance(i),
+                    1e-9 * variance[i].variance());
+        for (int j = 0; j < K; j++) {
+            EXPECT_NEAR(pairs[i][j].correlation(), dut.correlation(i, j),
+                        1e-9);
+            EXPECT_DOUBLE_EQ(dut.covariance(i, j), dut.covariance(j, i));
+        }
+    }
+    EXPECT_NEAR(-1, dut.correlation(0, 2), 1e-9);
+}
+
+TEST(TestCovariance, sampleCovariance) {
+    Metrics::Covariance<> dut{2};
+    dut.update({1, 2});
+    dut.update({3, 6});
+
+    EXPECT_DOUBLE_EQ(1, dut.covariance(0, 0));
+    EXPECT_DOUBLE_EQ(2, dut.covariance(0, 1));
+    EXPECT_DOUBLE_EQ(4, dut.sample_covariance(0, 1));
+    EXPECT_DOUBLE_EQ(1, dut.correlation(0, 1));
+}
+
+TEST(TestCovariance, add) {
+    Metrics::Covariance<> dut1{4};
+    Metrics::Covariance<> dut2{4};
+    Metrics::Covariance<> all{4};
+    for (int n = 0; n < 300; n++) {
+        (n < 100 ? dut1 : dut2).update(sample(n));
+        all.update(sample(n));
+    }
+
+    auto sum = dut1 + dut2;
+    EXPECT_EQ(300, sum.count());
+    for (unsigned i = 0; i < 4; i++) {
+        EXPECT_NEAR(all.mean(i), sum.mean(i), 1e-9 * std::fabs(all.mean(i)));
+        for (unsigned j = 0; j < 4; j++) {
+            EXPECT_NEAR(all.covariance(i, j), sum.covariance(i, j), 1e-6);
+        }
+    }
+
+    // other dimensions are ignored
+    Metrics::Covariance<> other{2};
+    other.update({1, 2});
+    sum += other;
+    EXPECT_EQ(300, sum.count());
+}
+
+TEST(TestCovariance, addToSelf) {
+    Metrics::Covariance<> dut{2};
+    dut.update({1, 2});
+    dut.update({3, 5});
+    const double covariance = dut.covariance(0, 1);
+
+    dut += dut;
+    EXPECT_EQ(4, dut.count());
+    EXPECT_DOUBLE_EQ(covariance, dut.covariance(0, 1));
+}
+
+TEST(TestCovariance, reset) {
+    Metrics::Covariance<> dut{2};
+    dut.update({1, 2});
+    dut.reset();
+
+    EXPECT_EQ(0, dut.count());
+    dut.update({5, 7});
+    EXPECT_EQ(5, dut.mean(0));
+    EXPECT_EQ(0, dut.covariance(0, 1));
+}
+
+TEST(TestCovariance, wrongSizeIgnored) {
+    Metrics::Covariance<> dut{2};
+    dut.update({1, 2});
+    dut.update({3});
+    dut.update({3, 4, 5});
+
+    EXPECT_EQ(1, dut.count());
+    EXPECT_EQ(1, dut.mean(0));
+    EXPECT_EQ(2, dut.mean(1));
+}
+
+TEST(TestCovariance, toString) {
+    Metrics::Covariance<> dut{2};
+    dut.update({1, 2});
+    dut.update({3, 2});
+
+    EXPECT_EQ("count(2) mean(2.0, 2.0) stddev(1.0, 0.0)", dut.toString(1));
+}
+
+} // namespace
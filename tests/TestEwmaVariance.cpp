@@ -0,0 +1,124 @@
+#include "ManualClock.hpp"
+#include "Metrics/EwmaVariance.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+
+namespace {
+
+TEST(TestEwmaVariance, empty) {
+    Metrics::EwmaVariance<> dut;
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.mean()));
+    EXPECT_TRUE(std::isnan(dut.variance()));
+    EXPECT_TRUE(std::isnan(dut.stddev()));
+}
+
+TEST(TestEwmaVariance, fixedAlpha) {
+    Metrics::EwmaVariance<> dut{0.5};
+
+    dut.update(0);
+    EXPECT_EQ(0, dut.mean());
+    EXPECT_EQ(0, dut.variance());
+    dut.update(2);
+    EXPECT_DOUBLE_EQ(1.0, dut.mean());
+    EXPECT_DOUBLE_EQ(1.0, dut.variance());
+    dut.update(1);
+    EXPECT_DOUBLE_EQ(1.0, dut.mean());
+    EXPECT_DOUBLE_EQ(0.5, dut.variance());
+    EXPECT_EQ(3, dut.count());
+}
+
+TEST(TestEwmaVariance, forgetsHistory) {
+    Metrics::EwmaVariance<> dut{0.1};
+
+    for (int i = 0; i < 1000; i++) {
+        dut.update((i % 2 == 0) ? 0 : 100);
+    }
+    EXPECT_NEAR(50.0, dut.mean(), 5.0);
+    EXPECT_NEAR(50.0, dut.stddev(), 5.0);
+
+    // after a level shift, old samples lose their weight
+    for (int i = 0; i < 500; i++) {
+        dut.update(1000);
+    }
+    EXPECT_NEAR(1000.0, dut.mean(), 1e-6);
+    EXPECT_NEAR(0.0, dut.stddev(), 1e-6);
+}
+
+TEST(TestEwmaVariance, timeConstant) {
+    Metrics::EwmaVariance<double, std::mutex, ManualClock> dut{
+        std::chrono::seconds(1)};
+
+    dut.update(0);
+    ManualClock::advance(std::chrono::seconds(1));
+    dut.update(1);
+    EXPECT_DOUBLE_EQ(1 - std::exp(-1), dut.mean());
+
+    // same weight when one sample arrives after 2 s as two samples after 1 s
+    ManualClock::advance(std::chrono::seconds(2));
+    dut.update(1);
+    EXPECT_DOUBLE_EQ(1 - std::exp(-3), dut.mean());
+}
+
+TEST(TestEwmaVariance, samplesInSameTick) {
+    Metrics::EwmaVariance<double, std::mutex, ManualClock> dut{
+        std::chrono::seconds(1)};
+
+    dut.update(0);
+    ManualClock::advance(std::chrono::seconds(1));
+    // a burst within one tick weighs as one sample with the mean of the burst
+    dut.update(1);
+    dut.update(3);
+    const double alpha = 1 - std::exp(-1);
+    EXPECT_EQ(3, dut.count());
+    EXPECT_DOUBLE_EQ(alpha * 2, dut.mean());
+    EXPECT_DOUBLE_EQ(alpha * 1 + alpha * (1 - alpha) * 4, dut.variance());
+
+    ManualClock::advance(std::chrono::seconds(1));
+    dut.update(2);
+    EXPECT_DOUBLE_EQ(alpha * 2 + alpha * (2 - alpha * 2), dut.mean());
+}
+
+TEST(TestEwmaVariance, noLock) {
+    Metrics::Internals::EwmaVarianceNoLock<float> dut{0.5};
+
+    dut.update(0);
+    dut.update(2, 0.25);
+    EXPECT_FLOAT_EQ(0.5, dut.mean());
+    EXPECT_FLOAT_EQ(0.75, dut.variance());
+}
+
+TEST(TestEwmaVariance, reset) {
+    Metrics::EwmaVariance<> dut;
+
+    dut.update(-1);
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.mean()));
+    dut.update(2);
+    EXPECT_EQ(2, dut.mean());
+}
+
+TEST(TestEwmaVariance, toString) {
+    Metrics::EwmaVariance<> dut{0.5};
+
+    EXPECT_EQ("count(0) mean(nan) stddev(nan)", dut.toString(1));
+    dut.update(0);
+    dut.update(2);
+    EXPECT_EQ("count(2) mean(1.0) stddev(1.0)", dut.toString(1));
+}
+
+TEST(TestEwmaVariance, assignments) {
+    Metrics::EwmaVariance<> dut1{0.5};
+    dut1.update(1);
+
+    Metrics::EwmaVariance<> dut2(dut1);
+    Metrics::EwmaVariance<> dut3;
+    dut3 = dut1;
+    dut2.update(3);
+    dut3.update(3);
+    EXPECT_EQ(2, dut2.mean());
+    EXPECT_EQ(2, dut3.mean());
+}
+} // namespace
@@ -0,0 +1,113 @@
+#include "ManualClock.hpp"
+#include "Metrics/ExponentiallyDecayingReservoir.hpp"
+#include "Metrics/Histogram.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+using Reservoir =
+    Metrics::ExponentiallyDecayingReservoir<double, std::mutex, ManualClock>;
+
+TEST(TestExponentiallyDecayingReservoir, firstAllStored) {
+    Reservoir dut{3};
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(3, dut.size());
+        EXPECT_EQ(i, dut.samples());
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(10, values[0]);
+    EXPECT_EQ(11, values[1]);
+    EXPECT_EQ(12, values[2]);
+}
+
+TEST(TestExponentiallyDecayingReservoir, storedMore) {
+    constexpr int SAMPLES_ADDED = 1000;
+    Reservoir dut{3};
+
+    for (int i = 0; i < SAMPLES_ADDED; i++) {
+        EXPECT_EQ(3, dut.size());
+        if (i >= 3) {
+            EXPECT_EQ(3, dut.samples());
+        }
+        EXPECT_EQ(i, dut.count());
+        dut.update(10 + i);
+    }
+    EXPECT_EQ(3, dut.getSnapshot().size());
+}
+
+TEST(TestExponentiallyDecayingReservoir, reset) {
+    Reservoir dut{3};
+
+    dut.update(-1);
+    dut.reset();
+    EXPECT_EQ(0, dut.samples());
+    dut.update(2);
+    EXPECT_EQ(1, dut.samples());
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(1, snapshot.size());
+    EXPECT_EQ(2, snapshot.values()[0]);
+}
+
+TEST(TestExponentiallyDecayingReservoir, recentSamplesDominate) {
+    // 10000 old samples with value 0, 10 minutes later 1000 samples with value
+    // 1: with alpha 0.015 the new samples have ~8000x the weight of old ones
+    Reservoir dut{100};
+
+    for (int i = 0; i < 10000; i++) {
+        dut.update(0);
+    }
+    ManualClock::advance(std::chrono::minutes(10));
+    for (int i = 0; i < 1000; i++) {
+        dut.update(1);
+    }
+
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(100, snapshot.size());
+    EXPECT_EQ(1, snapshot.getValue(0.1));
+}
+
+TEST(TestExponentiallyDecayingReservoir, rescale) {
+    // priorities are rescaled every hour, ordering must survive rescaling
+    Reservoir dut{10};
+
+    for (int hour = 0; hour < 48; hour++) {
+        for (int i = 0; i < 100; i++) {
+            dut.update(hour);
+        }
+        ManualClock::advance(std::chrono::minutes(30));
+    }
+    dut.update(48);
+
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(10, snapshot.size());
+    EXPECT_EQ(47, snapshot.getValue(0));
+}
+
+TEST(TestExponentiallyDecayingReservoir, largeAlpha) {
+    // with alpha 1/s, exp(alpha * t) overflows after ~12 minutes: the
+    // priorities must be rescaled before
+    Reservoir dut{10, 1.0};
+
+    for (int step = 0; step < 20; step++) {
+        for (int i = 0; i < 5; i++) {
+            dut.update(step);
+        }
+        ManualClock::advance(std::chrono::minutes(5));
+    }
+
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(10, snapshot.size());
+    EXPECT_EQ(18, snapshot.getValue(0));
+    EXPECT_EQ(19, snapshot.getValue(1));
+}
+
+TEST(TestExponentiallyDecayingReservoir, histogram) {
+    Metrics::Histogram<Reservoir> dut(4);
+
+    dut.update(1);
+    dut.update(2);
+    EXPECT_EQ(2, dut.getSnapshot().size());
+    EXPECT_EQ(0, dut.toString().find("count(2), min(1)"));
+}
+} // namespace
@@ -0,0 +1,96 @@
+#include "Metrics/FixedSamplingReservoir.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(TestFixedSamplingReservoir, firstAllStored) {
+    Metrics::FixedSamplingReservoir<double, 3> dut;
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(3, dut.size());
+        EXPECT_EQ(i, dut.samples());
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(10, values[0]);
+    EXPECT_EQ(11, values[1]);
+    EXPECT_EQ(12, values[2]);
+}
+
+TEST(TestFixedSamplingReservoir, reset) {
+    Metrics::FixedSamplingReservoir<double, 3> dut;
+    for (int i = 0; i < 10; i++) {
+        dut.update(i);
+    }
+    EXPECT_EQ(10, dut.count());
+    EXPECT_EQ(3, dut.samples());
+
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.samples());
+}
+
+TEST(TestFixedSamplingReservoir, correctBehaviour) {
+    // all values must be selected with nearly same probability
+    constexpr int RESERVOIR_SIZE = 8;
+    constexpr int UPDATES = 32;
+    constexpr int RUNS = 20000;
+    constexpr double MAX_REL_DEVIATION = 0.1;
+    Metrics::FixedSamplingReservoir<int, RESERVOIR_SIZE> dut;
+
+    int stats[UPDATES]{};
+    for (int i = 0; i < RUNS; i++) {
+        dut.reset();
+        for (int j = 0; j < UPDATES; j++) {
+            dut.update(j);
+        }
+        auto values = dut.getSnapshot().values();
+        for (auto val : values) {
+            stats[val]++;
+        }
+    }
+
+    const double expected = RUNS * RESERVOIR_SIZE / UPDATES;
+    for (int j = 0; j < UPDATES; j++) {
+        EXPECT_NEAR(expected, stats[j], expected * MAX_REL_DEVIATION);
+    }
+}
+
+TEST(TestFixedSamplingReservoir, weighted) {
+    // with a reservoir of 1, a value is selected with probability weight /
+    // total weight
+    constexpr int RUNS = 20000;
+    constexpr double MAX_REL_DEVIATION = 0.1;
+    Metrics::FixedSamplingReservoir<int, 1> dut;
+
+    int stats[4]{};
+    for (int i = 0; i < RUNS; i++) {
+        dut.reset();
+        for (int j = 0; j < 4; j++) {
+            dut.update(j, j + 1.0);
+        }
+        EXPECT_EQ(1, dut.samples());
+        stats[dut.getSnapshot().values()[0]]++;
+    }
+
+    for (int j = 0; j < 4; j++) {
+        const double expected = RUNS * (j + 1) / 10.0;
+        EXPECT_NEAR(expected, stats[j], expected * MAX_REL_DEVIATION);
+    }
+}
+
+TEST(TestFixedSamplingReservoir, compactStorage) {
+    Metrics::FixedSamplingReservoir<double, 3, std::mutex,
+                                    Metrics::NarrowCodec<double>>
+        dut;
+    dut.update(0.5);
+    dut.update(2.0);
+
+    EXPECT_EQ(nullptr, dut.data());
+    auto snapshot = dut.getSnapshot();
+    ASSERT_EQ(2, snapshot.size());
+    EXPECT_EQ(0.5, snapshot.getValue(0));
+    EXPECT_EQ(2.0, snapshot.getValue(1));
+}
+
+} // namespace
@@ -0,0 +1,69 @@
+#include "Metrics/FixedSlidingWindowReservoir.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(TestFixedSlidingWindowReservoir, firstAllStored) {
+    Metrics::FixedSlidingWindowReservoir<double, 3> dut;
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(3, dut.size());
+        EXPECT_EQ(i, dut.samples());
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(10, values[0]);
+    EXPECT_EQ(11, values[1]);
+    EXPECT_EQ(12, values[2]);
+}
+
+TEST(TestFixedSlidingWindowReservoir, storedMore) {
+    constexpr int SAMPLES_ADDED = 1000;
+    Metrics::FixedSlidingWindowReservoir<double, 3> dut;
+
+    for (int i = 0; i < SAMPLES_ADDED; i++) {
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(3, values.size());
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 3, values[0]);
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 2, values[1]);
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 1, values[2]);
+}
+
+TEST(TestFixedSlidingWindowReservoir, storedMorePowerOf2) {
+    constexpr int SAMPLES_ADDED = 1001;
+    Metrics::FixedSlidingWindowReservoir<int, 4> dut;
+
+    for (int i = 0; i < SAMPLES_ADDED; i++) {
+        dut.update(i);
+    }
+    EXPECT_EQ(4, dut.samples());
+    auto values = dut.getSnapshot().values();
+    ASSERT_EQ(4, values.size());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(SAMPLES_ADDED - 4 + i, values[i]);
+    }
+    // oldest value is overwritten next
+    EXPECT_EQ(SAMPLES_ADDED - 1, dut.data()[(SAMPLES_ADDED - 1) % 4]);
+}
+
+TEST(TestFixedSlidingWindowReservoir, reset) {
+    Metrics::FixedSlidingWindowReservoir<double, 3> dut;
+    dut.update(1);
+    dut.update(2);
+    dut.reset();
+
+    EXPECT_EQ(0, dut.samples());
+    dut.update(3);
+    EXPECT_EQ(1, dut.samples());
+    EXPECT_EQ(3, dut.getSnapshot().getValue(0));
+}
+
+TEST(TestFixedSlidingWindowReservoir, inlineStorage) {
+    Metrics::FixedSlidingWindowReservoir<float, 256> dut;
+
+    EXPECT_GE(sizeof dut, 256 * sizeof(float));
+}
+
+} // namespace
@@ -0,0 +1,110 @@
+#include "Metrics/Format.hpp"
+#include "gtest/gtest.h"
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace {
+
+template <typename V> std::string viaFormatter(V value, int precision) {
+    Metrics::Internals::Formatter os(precision);
+    os << value;
+    return os.release();
+}
+
+template <typename V> std::string viaStream(V value, int precision) {
+    std::ostringstream os;
+    if (precision > -1) {
+        os << std::fixed << std::setprecision(precision);
+    }
+    os << value;
+    return os.str();
+}
+
+TEST(TestFormat, sameAsStream) {
+    const double values[] = {0.0,
+                             -0.0,
+                             1.0,
+                             -2.5,
+                             0.1,
+                             1.0 / 3,
+                             123456789.0,
+                             1e-7,
+                             1e300,
+                             -1e-300,
+                             NAN,
+                             std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity()};
+    for (int precision : {-1, 0, 1, 3, 17}) {
+        for (double value : values) {
+            EXPECT_EQ(viaStream(value, precision),
+                      viaFormatter(value, precision));
+            const float f = static_cast<float>(value);
+            EXPECT_EQ(viaStream(f, precision), viaFormatter(f, precision));
+        }
+        for (int64_t value : {int64_t{0}, int64_t{-5},
+                              std::numeric_limits<int64_t>::min(),
+                              std::numeric_limits<int64_t>::max()}) {
+            EXPECT_EQ(viaStream(value, precision),
+                      viaFormatter(value, precision));
+        }
+        EXPECT_EQ(viaStream(std::numeric_limits<uint64_t>::max(), precision),
+                  viaFormatter(std::numeric_limits<uint64_t>::max(),
+                               precision));
+        EXPECT_EQ(viaStream(7U, precision), viaFormatter(7U, precision));
+    }
+}
+
+TEST(TestFormat, text) {
+    Metrics::Internals::Formatter os(2);
+    os << "count(" << 3 << ") mean(" << 1.5 << ")" << ' '
+       << std::string("end");
+    EXPECT_EQ("count(3) mean(1.50) end", os.release());
+}
+
+TEST(TestFormat, hugeValueWithLargePrecision) {
+    const std::string text = viaFormatter(1e308, 200);
+    EXPECT_EQ("1000000000000000010979", text.substr(0, 22));
+    EXPECT_EQ(399, text.size());
+}
+
+TEST(TestFormat, replaceDecimalPoint) {
+    char comma[] = "-1,5e+20";
+    EXPECT_EQ(8, Metrics::Internals::replaceDecimalPoint(comma, 8, ","));
+    EXPECT_STREQ("-1.5e+20", comma);
+
+    // multibyte decimal point, e.g. the arabic decimal separator
+    char arabic[] = "3\xd9\xab"
+                    "25";
+    EXPECT_EQ(4, Metrics::Internals::replaceDecimalPoint(arabic, 5,
+                                                         "\xd9\xab"));
+    EXPECT_STREQ("3.25", arabic);
+
+    char integer[] = "42";
+    EXPECT_EQ(2, Metrics::Internals::replaceDecimalPoint(integer, 2, ","));
+    EXPECT_STREQ("42", integer);
+}
+
+TEST(TestFormat, independentOfLocale) {
+    const std::string previous = setlocale(LC_NUMERIC, nullptr);
+    bool found = false;
+    for (const char *name :
+         {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "nl_BE.UTF-8"}) {
+        if (setlocale(LC_NUMERIC, name) != nullptr) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        GTEST_SKIP() << "no locale with a decimal comma installed";
+    }
+    const std::string text = viaFormatter(1.5, -1) + viaFormatter(2.5, 1);
+    setlocale(LC_NUMERIC, previous.c_str());
+    EXPECT_EQ("1.52.5", text);
+}
+
+} // namespace
@@ -1,4 +1,6 @@
+#include "Metrics/FixedSamplingReservoir.hpp"
 #include "Metrics/Histogram.hpp"
+#include "Metrics/SamplingReservoir.hpp"
 #include "Metrics/SlidingWindowReservoir.hpp"
 #include "gtest/gtest.h"
 #include <cmath>
@@ -53,4 +55,54 @@ TEST(TestHistogram, toString) {
     EXPECT_EQ(0, bins[2]);
     EXPECT_EQ(1, bins[3]);
 }
+
+TEST(TestHistogram, unsignedSize) {
+    const unsigned n = 3;
+    Metrics::Histogram<Metrics::SamplingReservoir<>> dut(n);
+
+    for (int i = 0; i < 10; i++) {
+        dut.update(i);
+    }
+    EXPECT_EQ(n, dut.getSnapshot().size());
+}
+
+TEST(TestHistogram, integerArguments) {
+    Metrics::Histogram<Metrics::SlidingWindowReservoir<>> dut(100, 0, 5);
+
+    dut.update(1);
+    EXPECT_EQ(1, dut.getSnapshot().size());
+    EXPECT_EQ(std::string::npos, dut.toString().find("stats:"));
+}
+
+TEST(TestHistogram, fixedReservoir) {
+    Metrics::Histogram<Metrics::FixedSamplingReservoir<double, 4>> dut(
+        Metrics::FixedCapacity{}, true);
+
+    dut.update(-4);
+    dut.update(8);
+    auto snapshot = dut.getSnapshot();
+
+    EXPECT_EQ(2, snapshot.size());
+    EXPECT_EQ(-4, snapshot.getValue(0));
+    EXPECT_EQ(8, snapshot.getValue(1));
+    EXPECT_NE(std::string::npos, dut.toString().find("stats:"));
+}
+
+TEST(TestHistogram, toStringRepeated) {
+    Metrics::Histogram<Metrics::SlidingWindowReservoir<>> dut(4, true, 2);
+    dut.update(1);
+    dut.update(2);
+    const auto first = dut.toString();
+
+    dut.reuseSnapshots();
+    EXPECT_EQ(first, dut.toString());
+    EXPECT_EQ(first, dut.toString());
+    dut.update(3);
+    EXPECT_NE(first, dut.toString());
+
+    Metrics::Snapshot<> snapshot;
+    dut.getSnapshot(snapshot);
+    EXPECT_EQ(3, snapshot.size());
+}
+
 } // namespace
@@ -0,0 +1,173 @@
+#include "Metrics/HyperLogLog.hpp"
+#include "Metrics/Registry.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(TestHyperLogLog, empty) {
+    Metrics::HyperLogLog<> dut;
+
+    EXPECT_EQ(0, dut.cardinality());
+    EXPECT_EQ(14, dut.precision());
+}
+
+TEST(TestHyperLogLog, smallCardinalityExact) {
+    // sparse list has 2^25 buckets, small sets are practically exact
+    Metrics::HyperLogLog<> dut;
+
+    for (int repeat = 0; repeat < 3; repeat++) {
+        for (int i = 0; i < 100; i++) {
+            dut.update(i);
+        }
+    }
+    EXPECT_EQ(100, dut.cardinality());
+}
+
+TEST(TestHyperLogLog, accuracy) {
+    for (unsigned precision : {4U, 10U, 14U}) {
+        const double max_error = 4 * 1.04 / std::sqrt(1 << precision);
+        for (int n : {1000, 10000, 200000}) {
+            Metrics::HyperLogLog<> dut{precision};
+            for (int i = 0; i < n; i++) {
+                dut.update(i);
+                dut.update(i);
+            }
+            EXPECT_NEAR(n, dut.estimate(), n * max_error)
+                << "precision " << precision << ", n " << n;
+        }
+    }
+}
+
+TEST(TestHyperLogLog, strings) {
+    Metrics::HyperLogLog<> dut;
+
+    dut.update(std::string("10.0.0.1"));
+    dut.update(std::string("10.0.0.2"));
+    dut.update(std::string("10.0.0.1"));
+    EXPECT_EQ(2, dut.cardinality());
+}
+
+TEST(TestHyperLogLog, mergeSparse) {
+    Metrics::HyperLogLog<> dut1;
+    Metrics::HyperLogLog<> dut2;
+
+    for (int i = 0; i < 100; i++) {
+        dut1.update(i);
+        dut2.update(i + 50);
+    }
+    dut1 += dut2;
+    EXPECT_EQ(150, dut1.cardinality());
+    EXPECT_EQ(100, dut2.cardinality());
+}
+
+TEST(TestHyperLogLog, mergeDense) {
+    constexpr int N = 100000;
+    Metrics::HyperLogLog<> dut1;
+    Metrics::HyperLogLog<> dut2;
+    Metrics::HyperLogLog<> sparse;
+
+    for (int i = 0; i < N; i++) {
+        dut1.update(i);
+        dut2.update(i + N / 2);
+    }
+    for (int i = 0; i < 10; i++) {
+        sparse.update(-i);
+    }
+    dut1 += dut2;
+    dut1 += sparse;
+    EXPECT_NEAR(1.5 * N + 10, dut1.estimate(), 1.5 * N * 0.03);
+
+    // sparse += dense converts
+    sparse += dut2;
+    EXPECT_NEAR(N + 10, sparse.estimate(), N * 0.03);
+
+    // lower precision is refused
+    Metrics::HyperLogLog<> other{10};
+    other.update(-100);
+    EXPECT_FALSE(sparse.merge(other));
+    EXPECT_THROW(sparse += other, std::invalid_argument);
+    EXPECT_NEAR(N + 10, sparse.estimate(), N * 0.03);
+}
+
+TEST(TestHyperLogLog, mergeHigherPrecision) {
+    constexpr int N = 100000;
+    Metrics::HyperLogLog<> dut{10};
+    Metrics::HyperLogLog<> dense{14};
+    Metrics::HyperLogLog<> sparse{12};
+
+    for (int i = 0; i < N; i++) {
+        dut.update(i);
+        dense.update(i + N / 2);
+    }
+    sparse.update(-1);
+    EXPECT_TRUE(dut.merge(dense));
+    EXPECT_TRUE(dut.merge(sparse));
+    EXPECT_EQ(10, dut.precision());
+    EXPECT_NEAR(1.5 * N, dut.estimate(), 1.5 * N * 4 * 1.04 / 32);
+}
+
+TEST(TestHyperLogLog, noBiasAtTransition) {
+    // the original estimator overestimates by ~2% around 2.5 * m
+    constexpr int RUNS = 200;
+    constexpr int N = 2600;
+    double error = 0;
+    for (int run = 0; run < RUNS; run++) {
+        Metrics::HyperLogLog<> dut{10};
+        for (int i = 0; i < N; i++) {
+            dut.update(run * 1000000 + i);
+        }
+        error += dut.estimate() / N - 1;
+    }
+    EXPECT_NEAR(0, error / RUNS, 0.01);
+}
+
+TEST(TestHyperLogLog, reset) {
+    Metrics::HyperLogLog<> dut;
+
+    for (int i = 0; i < 100000; i++) {
+        dut.update(i);
+    }
+    dut.reset();
+    EXPECT_EQ(0, dut.cardinality());
+    for (int i = 0; i < 100; i++) {
+        dut.update(i);
+    }
+    EXPECT_NEAR(100, dut.estimate(), 3);
+}
+
+TEST(TestHyperLogLog, multipleThreads) {
+    constexpr int THREADS = 4;
+    constexpr int N = 100000;
+    Metrics::HyperLogLog<> dut;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; i++) {
+        threads.emplace_back([&dut, i]() {
+            for (int j = 0; j < N; j++) {
+                dut.update(i * N + j);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_NEAR(THREADS * N, dut.estimate(), THREADS * N * 0.03);
+}
+
+TEST(TestHyperLogLog, registry) {
+    Metrics::Registry registry;
+    auto dut = std::make_shared<Metrics::HyperLogLog<>>();
+    registry.addMetric("clients", dut);
+
+    dut->update(1);
+    dut->update(2);
+    EXPECT_EQ("clients: cardinality(2)\n", registry.reportString());
+    registry.resetMetrics();
+    EXPECT_EQ(0, dut->cardinality());
+}
+} // namespace
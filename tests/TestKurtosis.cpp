@@ -71,4 +71,25 @@ TEST(TestKurtosis, rms) {
     EXPECT_DOUBLE_EQ(5.0, dut.rms());
 }
 
+TEST(TestKurtosis, weighted) {
+    // weight 3 is the same as 3 updates
+    Metrics::Kurtosis<> dut1;
+    Metrics::Kurtosis<double, std::mutex, true> dut2;
+    const double values[] = {1, 5, 7, 2};
+    const double weights[] = {3, 1, 2, 4};
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < weights[i]; j++) {
+            dut1.update(values[i]);
+        }
+        dut2.update(values[i], weights[i]);
+    }
+
+    EXPECT_EQ(4, dut2.count());
+    EXPECT_DOUBLE_EQ(10, dut2.weight());
+    EXPECT_DOUBLE_EQ(dut1.mean(), dut2.mean());
+    EXPECT_DOUBLE_EQ(dut1.variance(), dut2.variance());
+    EXPECT_NEAR(dut1.skew(), dut2.skew(), 1e-12);
+    EXPECT_NEAR(dut1.kurtosis(), dut2.kurtosis(), 1e-12);
+}
+
 } // namespace
@@ -119,4 +119,35 @@ TEST(TestLinearRegression, toString) {
 
     EXPECT_EQ(0, dut.toString(1).find("count(2) slope(-5.0) intercept(15.0)"));
 }
+
+TEST(TestLinearRegression, weighted) {
+    // weight 2 is the same as 2 updates
+    using Weighted = Metrics::LinearRegression<double, std::mutex, true>;
+    Weighted dut1;
+    Weighted dut2;
+    dut1.update(1, 2);
+    dut1.update(1, 2);
+    dut1.update(2, 5);
+    dut1.update(4, 7);
+    dut2.update(1, 2, 2);
+    dut2.update(2, 5);
+    dut2.update(4, 7, 1);
+    dut2.update(4, 7, 0);
+
+    EXPECT_EQ(3, dut2.count());
+    EXPECT_DOUBLE_EQ(4, dut2.weight());
+    EXPECT_DOUBLE_EQ(dut1.slope(), dut2.slope());
+    EXPECT_DOUBLE_EQ(dut1.intercept(), dut2.intercept());
+    EXPECT_DOUBLE_EQ(dut1.correlation(), dut2.correlation());
+
+    Weighted dut3;
+    dut3.update(3, 1, 0.5);
+    dut3.update(5, 9, 1.5);
+    dut1.update(3, 1, 0.5);
+    dut1.update(5, 9, 1.5);
+    dut2 += dut3;
+    EXPECT_DOUBLE_EQ(dut1.slope(), dut2.slope());
+    EXPECT_DOUBLE_EQ(dut1.correlation(), dut2.correlation());
+}
+
 } // namespace
@@ -0,0 +1,89 @@
+#include "ManualClock.hpp"
+#include "Metrics/Meter.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+using Meter = Metrics::Meter<std::mutex, ManualClock>;
+
+TEST(TestMeter, count) {
+    Meter dut;
+
+    EXPECT_EQ(0, dut.count());
+    dut.mark();
+    dut.mark(10);
+    EXPECT_EQ(11, dut.count());
+}
+
+TEST(TestMeter, meanRate) {
+    Meter dut;
+
+    EXPECT_EQ(0, dut.mean_rate());
+    dut.mark(100);
+    ManualClock::advance(std::chrono::seconds(4));
+    EXPECT_DOUBLE_EQ(25.0, dut.mean_rate());
+}
+
+TEST(TestMeter, movingAverages) {
+    Meter dut;
+
+    // rates are only updated every 5 s
+    dut.mark(300);
+    ManualClock::advance(std::chrono::seconds(4));
+    EXPECT_EQ(0, dut.m1_rate());
+
+    // first tick initializes the averages
+    ManualClock::advance(std::chrono::seconds(1));
+    EXPECT_DOUBLE_EQ(60.0, dut.m1_rate());
+    EXPECT_DOUBLE_EQ(60.0, dut.m5_rate());
+    EXPECT_DOUBLE_EQ(60.0, dut.m15_rate());
+
+    // without events, the 1 minute average decays by e in 1 minute
+    ManualClock::advance(std::chrono::seconds(60));
+    EXPECT_NEAR(60.0 * std::exp(-1), dut.m1_rate(), 1e-9);
+    EXPECT_NEAR(60.0 * std::exp(-0.2), dut.m5_rate(), 1e-9);
+    EXPECT_NEAR(60.0 * std::exp(-1.0 / 15), dut.m15_rate(), 1e-9);
+}
+
+TEST(TestMeter, reset) {
+    Meter dut;
+
+    dut.mark(100);
+    ManualClock::advance(std::chrono::seconds(5));
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.mean_rate());
+    EXPECT_EQ(0, dut.m1_rate());
+}
+
+TEST(TestMeter, multipleThreads) {
+    constexpr int THREADS = 8;
+    constexpr int LOOPS = 100000;
+    Meter dut;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; i++) {
+        threads.emplace_back([&dut]() {
+            for (int j = 0; j < LOOPS; j++) {
+                dut.mark();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(THREADS * LOOPS, dut.count());
+}
+
+TEST(TestMeter, toString) {
+    Meter dut;
+
+    dut.mark(10);
+    ManualClock::advance(std::chrono::seconds(5));
+    EXPECT_EQ("count(10) mean_rate(2.0) m1_rate(2.0) m5_rate(2.0) "
+              "m15_rate(2.0)",
+              dut.toString(1));
+}
+} // namespace
@@ -137,4 +137,38 @@ TEST(TestMinMeanMax, assignments) {
     EXPECT_EQ(1, dut2.count());
     EXPECT_EQ(1, dut2.mean());
 }
+
+TEST(TestMinMeanMax, weighted) {
+    Metrics::MinMeanMax<double, std::mutex, true> dut;
+    dut.update(1, 3);
+    dut.update(5);
+    dut.update(100, 0);
+
+    EXPECT_EQ(2, dut.count());
+    EXPECT_DOUBLE_EQ(4, dut.weight());
+    EXPECT_DOUBLE_EQ(2, dut.mean());
+    EXPECT_EQ(1, dut.min());
+    EXPECT_EQ(5, dut.max());
+
+    Metrics::MinMeanMax<double, std::mutex, true> dut2;
+    dut2.update(8, 4);
+    dut += dut2;
+    EXPECT_DOUBLE_EQ(5, dut.mean());
+}
+
+TEST(TestMinMeanMax, floatCountsPast2Pow24) {
+    // float can not represent 2^24 + 1, the count stays an integer
+    Metrics::MinMeanMax<float, std::mutex, true> dut;
+    dut.update(0);
+    for (int i = 0; i < 24; i++) {
+        dut += dut;
+    }
+    dut.update(0);
+    dut.update(0);
+    EXPECT_EQ((1 << 24) + 2, dut.weight());
+
+    dut.update(1, 2);
+    EXPECT_EQ((1 << 24) + 4, dut.weight());
+}
+
 } // namespace
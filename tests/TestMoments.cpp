@@ -0,0 +1,186 @@
+#include "Metrics/Kurtosis.hpp"
+#include "Metrics/Moments.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+/** sum of (x-x_mean)^p, calculated with 2 passes */
+double sumMoment(const std::vector<double> &values, unsigned p) {
+    double mean = 0;
+    for (auto x : values) {
+        mean += x;
+    }
+    mean /= values.size();
+    double sum = 0;
+    for (auto x : values) {
+        sum += std::pow(x - mean, p);
+    }
+    return sum;
+}
+
+/** tolerance for sum of (x-x_mean)^p: odd moments can be close to 0, so
+ * relative to n * stddev^p */
+double tolerance(const std::vector<double> &values, unsigned p) {
+    const double stddev = std::sqrt(sumMoment(values, 2) / values.size());
+    return 1e-10 * values.size() * std::pow(stddev, p);
+}
+
+std::vector<double> testValues(int n) {
+    std::vector<double> values;
+    for (int i = 0; i < n; i++) {
+        values.push_back(100 + std::sin(i) * std::exp(std::cos(3.0 * i)));
+    }
+    return values;
+}
+
+TEST(TestMoments, noDataGivesNan) {
+    Metrics::Moments<6> dut;
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.mean()));
+    EXPECT_TRUE(std::isnan(dut.variance()));
+    EXPECT_TRUE(std::isnan(dut.central_moment(5)));
+}
+
+TEST(TestMoments, sameAsKurtosis) {
+    Metrics::Internals::MomentsNoLock<4> dut;
+    Metrics::Internals::KurtosisNoLock<> reference;
+
+    for (auto x : testValues(1000)) {
+        dut.update(x);
+        reference.update(x);
+    }
+    EXPECT_EQ(reference.count(), dut.count());
+    EXPECT_DOUBLE_EQ(reference.mean(), dut.mean());
+    EXPECT_DOUBLE_EQ(reference.sample_variance(), dut.sample_variance());
+    EXPECT_NEAR(reference.skew(), dut.skew(), 1e-12);
+    EXPECT_NEAR(reference.excess_kurtosis(), dut.excess_kurtosis(), 1e-12);
+}
+
+TEST(TestMoments, higherOrders) {
+    const auto values = testValues(1000);
+    Metrics::Internals::MomentsNoLock<6> dut;
+
+    for (auto x : values) {
+        dut.update(x);
+    }
+    for (unsigned p = 2; p <= 6; p++) {
+        const double expected = sumMoment(values, p);
+        EXPECT_NEAR(expected, dut.sum_moment(p), tolerance(values, p))
+            << "order " << p;
+    }
+    EXPECT_TRUE(std::isnan(dut.sum_moment(7)));
+}
+
+TEST(TestMoments, batchUpdate) {
+    const auto values = testValues(1003);
+    Metrics::Internals::MomentsNoLock<6> dut;
+    Metrics::Internals::MomentsNoLock<6> reference;
+
+    dut.updateBatch(values.data(), 500);
+    dut.updateBatch(values.data() + 500, values.size() - 500);
+    for (auto x : values) {
+        reference.update(x);
+    }
+    EXPECT_EQ(reference.count(), dut.count());
+    EXPECT_EQ(reference.min(), dut.min());
+    EXPECT_EQ(reference.max(), dut.max());
+    EXPECT_NEAR(reference.mean(), dut.mean(), 1e-12);
+    for (unsigned p = 2; p <= 6; p++) {
+        EXPECT_NEAR(reference.sum_moment(p), dut.sum_moment(p),
+                    tolerance(values, p))
+            << "order " << p;
+    }
+}
+
+TEST(TestMoments, sum) {
+    const auto values = testValues(100);
+    Metrics::Moments<5> dut1;
+    Metrics::Moments<5> dut2;
+    Metrics::Moments<5> reference;
+
+    for (size_t i = 0; i < values.size(); i++) {
+        ((i < 30) ? dut1 : dut2).update(values[i]);
+        reference.update(values[i]);
+    }
+    auto result = dut1 + dut2;
+    EXPECT_EQ(reference.count(), result.count());
+    EXPECT_DOUBLE_EQ(reference.mean(), result.mean());
+    for (unsigned p = 2; p <= 5; p++) {
+        EXPECT_NEAR(reference.central_moment(p), result.central_moment(p),
+                    1e-10 * std::fabs(reference.central_moment(p)))
+            << "order " << p;
+    }
+
+    // adding empty moments changes nothing, adding to empty moments copies
+    Metrics::Moments<5> empty;
+    result += empty;
+    empty += reference;
+    EXPECT_EQ(reference.toString(), empty.toString());
+}
+
+TEST(TestMoments, selfAdd) {
+    Metrics::Moments<4> dut;
+    dut.update(1);
+    dut.update(2);
+    dut.update(6);
+    const auto before = dut.state();
+
+    dut += dut;
+    EXPECT_EQ(6, dut.count());
+    EXPECT_DOUBLE_EQ(before.mean(), dut.mean());
+    EXPECT_DOUBLE_EQ(before.central_moment(3), dut.central_moment(3));
+    EXPECT_DOUBLE_EQ(before.central_moment(4), dut.central_moment(4));
+}
+
+TEST(TestMoments, weighted) {
+    // weight 3 is the same as 3 updates
+    Metrics::Internals::MomentsNoLock<6, double, true> dut1;
+    Metrics::Internals::MomentsNoLock<6> dut2;
+    const double values[] = {1, 5, 7, 2};
+    const double weights[] = {3, 1, 2, 4};
+
+    for (int i = 0; i < 4; i++) {
+        dut1.update(values[i], weights[i]);
+        for (int j = 0; j < weights[i]; j++) {
+            dut2.update(values[i]);
+        }
+    }
+    dut1.update(100, 0);
+    EXPECT_EQ(4, dut1.count());
+    EXPECT_DOUBLE_EQ(dut2.weight(), dut1.weight());
+    EXPECT_DOUBLE_EQ(dut2.mean(), dut1.mean());
+    for (unsigned p = 2; p <= 6; p++) {
+        EXPECT_NEAR(dut2.sum_moment(p), dut1.sum_moment(p),
+                    1e-10 * std::fabs(dut2.sum_moment(p)))
+            << "order " << p;
+    }
+}
+
+TEST(TestMoments, floatCountsPast2Pow24) {
+    // float can not represent 2^24 + 1, the count stays an integer
+    Metrics::Internals::MomentsNoLock<4, float> dut;
+    dut.update(1);
+    for (int i = 0; i < 24; i++) {
+        dut += dut;
+    }
+    dut.update(1);
+    dut.update(1);
+    EXPECT_EQ((1 << 24) + 2, dut.count());
+    EXPECT_EQ((1 << 24) + 2, dut.weight());
+    EXPECT_EQ(1, dut.mean());
+}
+
+TEST(TestMoments, toString) {
+    Metrics::Moments<4> dut;
+    dut.update(1);
+    dut.update(3);
+
+    EXPECT_EQ("count(2) min(1.0) mean(2.0) max(3.0) sample_stddev(1.4) "
+              "standardized_moments(3: 0.0, 4: 1.0)",
+              dut.toString(1));
+}
+
+} // namespace
@@ -0,0 +1,182 @@
+#include "Metrics/Counter.hpp"
+#include "Metrics/Gauge.hpp"
+#include "Metrics/Histogram.hpp"
+#include "Metrics/Registry.hpp"
+#include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <string>
+
+namespace {
+
+TEST(TestRegistry, reportMap) {
+    Metrics::Registry registry;
+    auto counter = std::make_shared<Metrics::Counter<>>();
+    auto gauge = std::make_shared<Metrics::Gauge<>>();
+    registry.addMetric("b", counter);
+    registry.addMetric("a", gauge);
+
+    counter->inc(3);
+    gauge->update(1.5);
+    auto report = registry.reportMap(1);
+    EXPECT_EQ(2, report.size());
+    EXPECT_EQ("1.5", report["a"]);
+    EXPECT_EQ("3", report["b"]);
+}
+
+TEST(TestRegistry, reportIntoExistingMap) {
+    Metrics::Registry registry;
+    auto counter = std::make_shared<Metrics::Counter<>>();
+    registry.addMetric("b", counter);
+
+    std::map<std::string, std::string> report{{"a", "old"}, {"b", "old"},
+                                              {"c", "old"}};
+    const std::string *entry = &report["b"];
+    counter->inc(1);
+    registry.reportMap(report);
+    EXPECT_EQ(1, report.size());
+    EXPECT_EQ("1", report["b"]);
+    // node of a metric which is still registered is reused
+    EXPECT_EQ(entry, &report["b"]);
+
+    registry.addMetric("a", counter);
+    registry.addMetric("d", counter);
+    counter->inc(1);
+    registry.reportMap(report);
+    ASSERT_EQ(3, report.size());
+    EXPECT_EQ("2", report["a"]);
+    EXPECT_EQ("2", report["b"]);
+    EXPECT_EQ("2", report["d"]);
+    EXPECT_EQ(entry, &report["b"]);
+}
+
+TEST(TestRegistry, reportHistogramIntoExistingMap) {
+    Metrics::Registry registry;
+    auto histogram = std::make_shared<
+        Metrics::Histogram<Metrics::SlidingWindowReservoir<>>>(4);
+    registry.addMetric("h", histogram);
+    histogram->update(1);
+    histogram->update(5);
+
+    std::map<std::string, std::string> report;
+    registry.reportMap(report);
+    histogram->update(3);
+    registry.reportMap(report);
+    EXPECT_EQ(histogram->toString(), report["h"]);
+    EXPECT_EQ(registry.reportMap()["h"], report["h"]);
+}
+
+TEST(TestRegistry, create) {
+    Metrics::Registry registry;
+    auto counter = registry.create<Metrics::Counter<>>("counter");
+    auto histogram = registry.create<
+        Metrics::Histogram<Metrics::SlidingWindowReservoir<>>>("histogram",
+                                                               10);
+    auto stats = registry.create<Metrics::Variance<>>("stats");
+    EXPECT_EQ(3, registry.size());
+
+    counter->inc(2);
+    histogram->update(5);
+    stats->update(1);
+    stats->update(3);
+    auto report = registry.reportMap(1);
+    EXPECT_EQ("2", report["counter"]);
+    EXPECT_EQ(histogram->toString(1), report["histogram"]);
+    EXPECT_EQ(stats->toString(1), report["stats"]);
+
+    registry.resetMetrics();
+    EXPECT_EQ(0, counter->count());
+    EXPECT_EQ(0, stats->count());
+}
+
+TEST(TestRegistry, find) {
+    Metrics::Registry registry;
+    auto created = registry.create<Metrics::Gauge<>>("gauge");
+    created->update(2.5);
+    registry.addMetric("shared", std::make_shared<Metrics::Counter<>>());
+
+    auto found = registry.find<Metrics::Gauge<>>("gauge");
+    ASSERT_TRUE(found);
+    EXPECT_EQ(created.get(), found.get());
+    EXPECT_EQ(2.5, found->value());
+
+    EXPECT_TRUE(registry.find<Metrics::Counter<>>("shared"));
+    EXPECT_FALSE(registry.find<Metrics::Counter<>>("gauge"));
+    EXPECT_FALSE(registry.find<Metrics::Gauge<>>("missing"));
+    EXPECT_FALSE(Metrics::Handle<Metrics::Gauge<>>());
+}
+
+TEST(TestRegistry, replacedMetricStaysValid) {
+    Metrics::Registry registry;
+    auto first = registry.create<Metrics::Counter<>>("counter");
+    auto shared = registry.create<Metrics::Counter<>>("shared");
+    registry.addMetric("shared", std::make_shared<Metrics::Counter<>>());
+    auto second = registry.create<Metrics::Counter<>>("counter");
+    EXPECT_EQ(2, registry.size());
+
+    // the old handle still works, but is not reported anymore
+    first->inc(1);
+    second->inc(5);
+    shared->inc(1);
+    EXPECT_EQ("counter: 5\nshared: 0\n", registry.reportString());
+}
+
+TEST(TestRegistry, replacedSharedMetricIsReleased) {
+    Metrics::Registry registry;
+    auto kept = std::make_shared<Metrics::Counter<>>();
+    auto replaced = std::make_shared<Metrics::Counter<>>();
+    std::weak_ptr<Metrics::Counter<>> released = replaced;
+    registry.addMetric("kept", kept);
+    registry.addMetric("released", replaced);
+    replaced.reset();
+    registry.addMetric("kept", std::make_shared<Metrics::Counter<>>());
+    registry.addMetric("released", std::make_shared<Metrics::Counter<>>());
+
+    EXPECT_TRUE(released.expired());
+    EXPECT_EQ(1, kept.use_count());
+}
+
+TEST(TestRegistry, move) {
+    Metrics::Registry registry;
+    auto counter = registry.create<Metrics::Counter<>>("counter");
+    registry.addMetric("gauge", std::make_shared<Metrics::Gauge<>>());
+
+    Metrics::Registry moved(std::move(registry));
+    counter->inc(3);
+    EXPECT_EQ(0, registry.size());
+    EXPECT_EQ("counter: 3\ngauge: 0\n", moved.reportString());
+
+    Metrics::Registry assigned;
+    assigned.create<Metrics::Counter<>>("other");
+    assigned = std::move(moved);
+    counter->inc(1);
+    EXPECT_EQ(2, assigned.size());
+    EXPECT_EQ(4, assigned.find<Metrics::Counter<>>("counter")->count());
+    EXPECT_EQ(counter.get(),
+              assigned.find<Metrics::Counter<>>("counter").get());
+}
+
+TEST(TestRegistry, largeAndAlignedMetrics) {
+    struct alignas(64) Aligned : public Metrics::IMetric {
+        void reset() noexcept override {}
+        std::string toString(int = -1) const noexcept override {
+            return "aligned";
+        }
+        char payload[10000];
+    };
+
+    Metrics::Registry registry;
+    for (int i = 0; i < 10; i++) {
+        auto gauge = registry.create<Metrics::Gauge<>>("g" + std::to_string(i));
+        auto aligned = registry.create<Aligned>("a" + std::to_string(i));
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(aligned.get()) % 64);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(gauge.get()) %
+                         alignof(Metrics::Gauge<>));
+    }
+    EXPECT_EQ(20, registry.size());
+    EXPECT_EQ("aligned", registry.reportMap()["a3"]);
+}
+
+} // namespace
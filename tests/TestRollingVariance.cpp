@@ -0,0 +1,171 @@
+#include "Metrics/RollingVariance.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+TEST(TestRollingVariance, empty) {
+    Metrics::RollingVariance<> dut{3};
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(3, dut.size());
+    EXPECT_TRUE(std::isnan(dut.min()));
+    EXPECT_TRUE(std::isnan(dut.mean()));
+    EXPECT_TRUE(std::isnan(dut.max()));
+    EXPECT_TRUE(std::isnan(dut.variance()));
+    EXPECT_TRUE(std::isnan(dut.rms()));
+}
+
+TEST(TestRollingVariance, windowNotFull) {
+    Metrics::RollingVariance<> dut{10};
+
+    dut.update(1);
+    dut.update(2);
+    dut.update(3);
+    EXPECT_EQ(1, dut.min());
+    EXPECT_EQ(2, dut.mean());
+    EXPECT_EQ(3, dut.max());
+    EXPECT_EQ(3, dut.count());
+    EXPECT_EQ(2, dut.m2());
+}
+
+TEST(TestRollingVariance, oldSamplesRemoved) {
+    Metrics::RollingVariance<> dut{3};
+
+    dut.update(100);
+    dut.update(-100);
+    for (int i = 1; i <= 3; i++) {
+        dut.update(i);
+    }
+    EXPECT_EQ(3, dut.count());
+    EXPECT_EQ(1, dut.min());
+    EXPECT_NEAR(2.0, dut.mean(), 1e-12);
+    EXPECT_EQ(3, dut.max());
+    EXPECT_NEAR(2.0, dut.m2(), 1e-12);
+}
+
+TEST(TestRollingVariance, emptyWindow) {
+    Metrics::RollingVariance<> dut{0};
+
+    dut.update(1);
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.size());
+    EXPECT_TRUE(std::isnan(dut.mean()));
+}
+
+TEST(TestRollingVariance, noDriftAfterLargeValues) {
+    // removing large values leaves rounding errors far above the variance
+    // of the small values, they are gone after the recalculation
+    Metrics::RollingVariance<> dut{4};
+    dut.update(1e9);
+    dut.update(-1e9);
+    dut.update(3e9);
+    dut.update(-2e9);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 1; j <= 4; j++) {
+            dut.update(j);
+        }
+    }
+    EXPECT_DOUBLE_EQ(2.5, dut.mean());
+    EXPECT_DOUBLE_EQ(5.0, dut.m2());
+}
+
+TEST(TestRollingVariance, sameAsVarianceOverWindow) {
+    constexpr int WINDOW = 50;
+    Metrics::RollingVariance<> dut{WINDOW};
+    std::mt19937 random_generator;
+    std::normal_distribution<> distribution{1e6, 10};
+    std::vector<double> values;
+
+    for (int i = 0; i < 10000; i++) {
+        values.push_back(distribution(random_generator));
+        dut.update(values.back());
+
+        if (i % 997 == 1 || i == 9999) {
+            Metrics::Variance<> expected;
+            const int first = std::max(0, i + 1 - WINDOW);
+            for (int j = first; j <= i; j++) {
+                expected.update(values[j]);
+            }
+            EXPECT_EQ(expected.count(), dut.count());
+            EXPECT_EQ(expected.min(), dut.min());
+            EXPECT_EQ(expected.max(), dut.max());
+            EXPECT_NEAR(expected.mean(), dut.mean(), 1e-6);
+            EXPECT_NEAR(expected.sample_stddev(), dut.sample_stddev(), 1e-6);
+        }
+    }
+}
+
+TEST(TestRollingVariance, minMaxMonotonic) {
+    // decreasing then increasing values, extremes leave the window
+    Metrics::RollingVariance<> dut{4};
+
+    for (int i = 10; i > 0; i--) {
+        dut.update(i);
+    }
+    EXPECT_EQ(1, dut.min());
+    EXPECT_EQ(4, dut.max());
+    for (int i = 0; i < 3; i++) {
+        dut.update(10);
+    }
+    EXPECT_EQ(1, dut.min());
+    dut.update(10);
+    EXPECT_EQ(10, dut.min());
+    EXPECT_EQ(10, dut.max());
+}
+
+TEST(TestRollingVariance, reset) {
+    Metrics::RollingVariance<> dut{3};
+
+    dut.update(-1);
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.min()));
+    dut.update(2);
+    EXPECT_EQ(2, dut.min());
+    EXPECT_EQ(2, dut.mean());
+    EXPECT_EQ(2, dut.max());
+    EXPECT_EQ(1, dut.count());
+}
+
+TEST(TestRollingVariance, rms) {
+    Metrics::RollingVariance<> dut{4};
+
+    // signal with DC value 3 + square wave amplitude 4 has RMS value 5
+    dut.update(1000);
+    for (int i = 0; i < 2; i++) {
+        dut.update(3 + 4);
+        dut.update(3 - 4);
+    }
+    EXPECT_NEAR(5.0, dut.rms(), 1e-9);
+}
+
+TEST(TestRollingVariance, toString) {
+    Metrics::RollingVariance<> dut{3};
+
+    EXPECT_EQ(0, dut.toString(1).find("count(0) min(nan) mean(nan) max(nan)"));
+    dut.update(0);
+    dut.update(1);
+    dut.update(2);
+    dut.update(3);
+    EXPECT_EQ(0, dut.toString(1).find("count(3) min(1.0) mean(2.0) max(3.0)"));
+}
+
+TEST(TestRollingVariance, assignments) {
+    Metrics::RollingVariance<> dut1{2};
+    dut1.update(1);
+    dut1.update(3);
+
+    Metrics::RollingVariance<> dut2(dut1);
+    Metrics::RollingVariance<> dut3{5};
+    dut3 = dut1;
+    dut2.update(5);
+    dut3.update(5);
+    EXPECT_EQ(4, dut2.mean());
+    EXPECT_EQ(4, dut3.mean());
+    EXPECT_EQ(2, dut3.size());
+}
+} // namespace
@@ -134,4 +134,90 @@ TEST(TestSamplingReservoir, smallReservoirCorrectBehaviour) {
         }
     }
 }
+
+TEST(TestSamplingReservoir, weighted) {
+    // with a reservoir of 1, a value is selected with probability weight /
+    // total weight
+    constexpr int RUNS = 20000;
+    constexpr double MAX_REL_DEVIATION = 0.1;
+    Metrics::SamplingReservoir<int> dut{1};
+
+    int stats[4]{};
+    for (int i = 0; i < RUNS; i++) {
+        dut.reset();
+        for (int j = 0; j < 4; j++) {
+            dut.update(j, j + 1.0);
+        }
+        EXPECT_EQ(1, dut.samples());
+        stats[dut.getSnapshot().values()[0]]++;
+    }
+
+    for (int j = 0; j < 4; j++) {
+        const double expected = RUNS * (j + 1) / 10.0;
+        EXPECT_NEAR(expected, stats[j], expected * MAX_REL_DEVIATION);
+    }
+}
+
+TEST(TestSamplingReservoir, weightedAfterUnweighted) {
+    // 9 unweighted values followed by 1 value with weight 9
+    constexpr int RUNS = 20000;
+    constexpr double MAX_REL_DEVIATION = 0.1;
+    Metrics::SamplingReservoir<int> dut{3};
+
+    int stats[10]{};
+    for (int i = 0; i < RUNS; i++) {
+        dut.reset();
+        for (int j = 0; j < 9; j++) {
+            dut.update(j);
+        }
+        dut.update(9, 9.0);
+        dut.update(10, 0.0);
+        EXPECT_EQ(3, dut.samples());
+        auto values = dut.getSnapshot().values();
+        for (auto val : values) {
+            stats[val]++;
+        }
+    }
+
+    // value 9 has the weight of all other values together
+    EXPECT_GT(stats[9], RUNS * 0.6);
+    for (int j = 1; j < 9; j++) {
+        EXPECT_NEAR(stats[0], stats[j], stats[0] * MAX_REL_DEVIATION);
+    }
+}
+
+TEST(TestSamplingReservoir, compactStorage) {
+    Metrics::SamplingReservoir<double, std::mutex, Metrics::NarrowCodec<double>>
+        dut{3};
+    dut.update(0.5);
+    dut.update(0.1);
+    dut.update(2.0);
+
+    EXPECT_EQ(nullptr, dut.data());
+    auto snapshot = dut.getSnapshot();
+    ASSERT_EQ(3, snapshot.size());
+    EXPECT_NEAR(0.1, snapshot.getValue(0), 1e-8);
+    EXPECT_EQ(0.5, snapshot.getValue(0.5));
+    EXPECT_EQ(2.0, snapshot.getValue(1));
+}
+
+TEST(TestSamplingReservoir, snapshotReusesMemory) {
+    Metrics::SamplingReservoir<> dut(10);
+    Metrics::Snapshot<> snapshot;
+
+    for (int i = 0; i < 100; i++) {
+        dut.update(i);
+    }
+    dut.getSnapshot(snapshot);
+    const double *data = snapshot.values().data();
+    EXPECT_EQ(10, snapshot.size());
+
+    dut.reset();
+    dut.update(5);
+    dut.getSnapshot(snapshot);
+    EXPECT_EQ(data, snapshot.values().data());
+    EXPECT_EQ(1, snapshot.size());
+    EXPECT_EQ(5, snapshot.getValue(0));
+}
+
 } // namespace
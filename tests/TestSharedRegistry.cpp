@@ -0,0 +1,136 @@
+#include "Metrics/SharedRegistry.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+using Metrics::Internals::MinMaxNoLock;
+using Metrics::Internals::VarianceNoLock;
+
+/** name of a shared memory object unique to this process */
+std::string shmName(const char *test) {
+    return "/metrics-test-" + std::to_string(getpid()) + "-" + test;
+}
+
+TEST(TestSharedRegistry, report) {
+    const auto name = shmName("report");
+    Metrics::SharedRegistry<> registry(name);
+    auto variance = registry.create<VarianceNoLock<double>>("variance");
+    auto minmax = registry.create<MinMaxNoLock<double>>("minmax");
+    EXPECT_EQ(2, registry.size());
+    variance.update(1);
+    variance.update(3);
+    minmax.update(-2);
+
+    Metrics::SharedRegistryReader reader(name);
+    EXPECT_EQ(2, reader.size());
+    auto report = reader.reportMap(1);
+    EXPECT_EQ(variance.state().toString(1), report["variance"]);
+    EXPECT_EQ(minmax.state().toString(1), report["minmax"]);
+    EXPECT_EQ("minmax: " + minmax.state().toString() +
+                  "\nvariance: " + variance.state().toString() + "\n",
+              reader.reportString());
+}
+
+TEST(TestSharedRegistry, readTyped) {
+    const auto name = shmName("readTyped");
+    Metrics::SharedRegistry<> registry(name);
+    auto variance = registry.create<VarianceNoLock<double>>("variance");
+    variance.update(2);
+
+    Metrics::SharedRegistryReader reader(name);
+    VarianceNoLock<double> state;
+    ASSERT_TRUE(reader.read("variance", state));
+    EXPECT_EQ(1, state.count());
+    EXPECT_EQ(2, state.mean());
+
+    MinMaxNoLock<double> otherType;
+    EXPECT_FALSE(reader.read("variance", otherType));
+    EXPECT_FALSE(reader.read("unknown", state));
+}
+
+TEST(TestSharedRegistry, full) {
+    const auto name = shmName("full");
+    Metrics::SharedRegistry<> registry(name, 1);
+    EXPECT_THROW(registry.create<VarianceNoLock<double>>(std::string(96, 'x')),
+                 std::length_error);
+    registry.create<VarianceNoLock<double>>("a");
+    EXPECT_THROW(registry.create<VarianceNoLock<double>>("b"),
+                 std::length_error);
+
+    Metrics::SharedRegistry<> small(shmName("small"), 2, 16);
+    EXPECT_THROW(small.create<VarianceNoLock<double>>("a"), std::length_error);
+}
+
+TEST(TestSharedRegistry, removedOnDestruction) {
+    const auto name = shmName("removed");
+    { Metrics::SharedRegistry<> registry(name); }
+    EXPECT_THROW(Metrics::SharedRegistryReader reader(name), std::system_error);
+}
+
+TEST(TestSharedRegistry, nameInUse) {
+    const auto name = shmName("inUse");
+    Metrics::SharedRegistry<> registry(name);
+    auto variance = registry.create<VarianceNoLock<double>>("variance");
+    variance.update(1);
+
+    EXPECT_THROW(Metrics::SharedRegistry<> other(name), std::system_error);
+    Metrics::SharedRegistryReader reader(name);
+    VarianceNoLock<double> state;
+    ASSERT_TRUE(reader.read("variance", state));
+    EXPECT_EQ(1, state.count());
+}
+
+TEST(TestSharedRegistry, readWhileOtherProcessWrites) {
+    constexpr int UPDATES = 200000;
+    const auto name = shmName("processes");
+    Metrics::SharedRegistry<> registry(name);
+    auto variance = registry.create<VarianceNoLock<double>>("variance");
+
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        for (int i = 0; i < UPDATES; i++) {
+            variance.update(i);
+        }
+        _exit(0);
+    }
+
+    // every copy is consistent: values 0..count-1 were added. Read once more
+    // after the child exited, to see its last update.
+    Metrics::SharedRegistryReader reader(name);
+    VarianceNoLock<double> state;
+    int64_t last = 0;
+    int status = -1;
+    bool exited = false;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (!exited) {
+        exited = waitpid(child, &status, WNOHANG) == child;
+        if (!exited && std::chrono::steady_clock::now() > deadline) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            FAIL() << "child did not finish";
+        }
+        ASSERT_TRUE(reader.read("variance", state));
+        ASSERT_GE(state.count(), last);
+        last = state.count();
+        if (last > 0) {
+            ASSERT_EQ(0, state.min());
+            ASSERT_EQ(last - 1, state.max());
+            ASSERT_NEAR((last - 1) / 2.0, state.mean(), 1e-9 * last);
+        }
+    }
+
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_EQ(UPDATES, last);
+    // updates of the other process are visible in this process
+    EXPECT_EQ(UPDATES, variance.state().count());
+}
+
+} // namespace
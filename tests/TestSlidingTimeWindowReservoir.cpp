@@ -0,0 +1,99 @@
+#include "ManualClock.hpp"
+#include "Metrics/Histogram.hpp"
+#include "Metrics/SlidingTimeWindowReservoir.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+using Reservoir =
+    Metrics::SlidingTimeWindowReservoir<double, std::mutex, ManualClock>;
+
+TEST(TestSlidingTimeWindowReservoir, firstAllStored) {
+    Reservoir dut{3};
+
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(3, dut.size());
+        EXPECT_EQ(i, dut.samples());
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(10, values[0]);
+    EXPECT_EQ(11, values[1]);
+    EXPECT_EQ(12, values[2]);
+}
+
+TEST(TestSlidingTimeWindowReservoir, storedMore) {
+    // chunks of 1 sample behave as a count based sliding window
+    constexpr int SAMPLES_ADDED = 1000;
+    Reservoir dut{3};
+
+    for (int i = 0; i < SAMPLES_ADDED; i++) {
+        if (i >= 3) {
+            EXPECT_EQ(3, dut.samples());
+        }
+        dut.update(10 + i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(3, values.size());
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 3, values[0]);
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 2, values[1]);
+    EXPECT_EQ(SAMPLES_ADDED + 10 - 1, values[2]);
+}
+
+TEST(TestSlidingTimeWindowReservoir, fullRingDropsOldestChunk) {
+    // 4 chunks of 2 samples
+    Reservoir dut{8, std::chrono::seconds(60), 4};
+
+    for (int i = 0; i < 9; i++) {
+        dut.update(i);
+    }
+    auto values = dut.getSnapshot().values();
+    EXPECT_EQ(7, values.size());
+    EXPECT_EQ(2, values.front());
+    EXPECT_EQ(8, values.back());
+}
+
+TEST(TestSlidingTimeWindowReservoir, expired) {
+    Reservoir dut{100, std::chrono::seconds(10), 10};
+
+    for (int i = 0; i < 20; i++) {
+        dut.update(i);
+        ManualClock::advance(std::chrono::seconds(1));
+    }
+    // samples 0..9 are older than 10 s, including samples in partially
+    // expired chunks
+    EXPECT_EQ(10, dut.samples());
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(10, snapshot.size());
+    EXPECT_EQ(10, snapshot.getValue(0));
+    EXPECT_EQ(19, snapshot.getValue(1));
+
+    ManualClock::advance(std::chrono::seconds(60));
+    EXPECT_EQ(0, dut.samples());
+    dut.update(-1);
+    snapshot = dut.getSnapshot();
+    EXPECT_EQ(1, snapshot.size());
+    EXPECT_EQ(-1, snapshot.getValue(0));
+}
+
+TEST(TestSlidingTimeWindowReservoir, reset) {
+    Reservoir dut{3};
+
+    dut.update(-1);
+    dut.reset();
+    EXPECT_EQ(0, dut.samples());
+    dut.update(2);
+    EXPECT_EQ(1, dut.samples());
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(1, snapshot.size());
+    EXPECT_EQ(2, snapshot.values()[0]);
+}
+
+TEST(TestSlidingTimeWindowReservoir, histogram) {
+    Metrics::Histogram<Reservoir> dut(4);
+
+    dut.update(1);
+    dut.update(2);
+    EXPECT_EQ(2, dut.getSnapshot().size());
+    EXPECT_EQ(0, dut.toString().find("count(2), min(1)"));
+}
+} // namespace
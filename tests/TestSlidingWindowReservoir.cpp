@@ -47,4 +47,52 @@ TEST(TestSlidingWindowReservoir, reset) {
     EXPECT_EQ(1, snapshot.size());
     EXPECT_EQ(2, snapshot.values()[0]);
 }
+
+TEST(TestSlidingWindowReservoir, compactStorage) {
+    // durations in seconds, stored with a resolution of 1 us
+    Metrics::SlidingWindowReservoir<double, std::mutex,
+                                    Metrics::FixedPointCodec<double>>
+        dut{3, Metrics::FixedPointCodec<double>{1e-6}};
+    dut.update(0.0000014);
+    dut.update(1.5);
+    dut.update(0.25);
+    dut.update(3.0);
+
+    EXPECT_EQ(nullptr, dut.data());
+    auto values = dut.getSnapshot().values();
+    ASSERT_EQ(3, values.size());
+    EXPECT_DOUBLE_EQ(0.25, values[0]);
+    EXPECT_DOUBLE_EQ(1.5, values[1]);
+    EXPECT_DOUBLE_EQ(3.0, values[2]);
+}
+
+TEST(TestSlidingWindowReservoir, identityStorage) {
+    Metrics::SlidingWindowReservoir<> dut{3};
+    dut.update(2.0);
+
+    ASSERT_NE(nullptr, dut.data());
+    EXPECT_EQ(2.0, dut.data()[0]);
+}
+
+TEST(TestSlidingWindowReservoir, snapshotReusesMemory) {
+    Metrics::SlidingWindowReservoir<double, std::mutex,
+                                    Metrics::NarrowCodec<double>>
+        dut(4);
+    Metrics::Snapshot<> snapshot;
+
+    for (int i = 0; i < 6; i++) {
+        dut.update(i);
+    }
+    dut.getSnapshot(snapshot);
+    const double *data = snapshot.values().data();
+    EXPECT_EQ(4, snapshot.size());
+    EXPECT_EQ(2, snapshot.getValue(0));
+
+    dut.update(10);
+    dut.getSnapshot(snapshot);
+    EXPECT_EQ(data, snapshot.values().data());
+    EXPECT_EQ(3, snapshot.getValue(0));
+    EXPECT_EQ(10, snapshot.getValue(1));
+}
+
 } // namespace
@@ -17,6 +17,14 @@ TEST(TestSnapshot, sorted) {
     }
 }
 
+TEST(TestSnapshot, sortedFromVector) {
+    auto dut = Metrics::Snapshot<>(std::vector<double>{200, 100, 150});
+    EXPECT_EQ(3, dut.size());
+    EXPECT_EQ(100, dut.values()[0]);
+    EXPECT_EQ(150, dut.values()[1]);
+    EXPECT_EQ(200, dut.values()[2]);
+}
+
 TEST(TestSnapshot, quantileInRangeOddLength) {
     Metrics::Snapshot<> dut{t1.cbegin(), t1.cend()};
 
@@ -64,4 +72,28 @@ TEST(TestSnapshot, binsCorrect) {
     EXPECT_EQ(1, bins[1]);
 }
 
+TEST(TestSnapshot, assignReusesMemory) {
+    Metrics::Snapshot<> dut;
+    EXPECT_EQ(0, dut.size());
+
+    dut.assign(t2.cbegin(), t2.cend());
+    const double *data = dut.values().data();
+    EXPECT_EQ(100, dut.getValue(0));
+    EXPECT_EQ(200, dut.getValue(1));
+
+    const std::vector<double> smaller{7, 3};
+    dut.assign(smaller.cbegin(), smaller.cend());
+    EXPECT_EQ(data, dut.values().data());
+    EXPECT_EQ(2, dut.size());
+    EXPECT_EQ(3, dut.getValue(0));
+
+    dut.fill([](std::vector<double> &values) {
+        values.push_back(5);
+        values.push_back(4);
+    });
+    EXPECT_EQ(data, dut.values().data());
+    EXPECT_EQ(4, dut.values()[0]);
+    EXPECT_EQ(5, dut.values()[1]);
+}
+
 } // namespace
@@ -0,0 +1,115 @@
+#include "Metrics/Stats.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+
+namespace {
+using namespace Metrics::Feature;
+
+constexpr double EPSILON = 1e-12;
+
+TEST(TestStats, noDataGivesNan) {
+    Metrics::Stats<Count, Min, Max, M2> dut;
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(std::isnan(dut.min()));
+    EXPECT_TRUE(std::isnan(dut.mean()));
+    EXPECT_TRUE(std::isnan(dut.max()));
+    EXPECT_TRUE(std::isnan(dut.variance()));
+    EXPECT_TRUE(std::isnan(dut.sample_variance()));
+}
+
+TEST(TestStats, sameAsVariance) {
+    Metrics::Stats<Count, Min, Max, M2> dut;
+    Metrics::Variance<> reference;
+
+    for (int i = 0; i < 100; i++) {
+        const double value = 1e6 + std::sin(i);
+        dut.update(value);
+        reference.update(value);
+    }
+    EXPECT_EQ(reference.count(), dut.count());
+    EXPECT_EQ(reference.min(), dut.min());
+    EXPECT_EQ(reference.max(), dut.max());
+    EXPECT_NEAR(reference.mean(), dut.mean(), EPSILON);
+    EXPECT_NEAR(reference.m2(), dut.m2(), 1e-9);
+    EXPECT_NEAR(reference.sample_stddev(), dut.sample_stddev(), EPSILON);
+    EXPECT_EQ(reference.toString(), dut.toString());
+}
+
+TEST(TestStats, minMaxOnly) {
+    Metrics::Internals::StatsNoLock<double, Min, Max> dut;
+    EXPECT_EQ(2 * sizeof(double), sizeof dut);
+    EXPECT_EQ("min(nan) max(nan)", dut.toString());
+
+    dut.update(3);
+    dut.update(-1);
+    dut.update(2);
+    EXPECT_EQ(-1, dut.min());
+    EXPECT_EQ(3, dut.max());
+    EXPECT_EQ("min(-1) max(3)", dut.toString());
+
+    dut.reset();
+    EXPECT_TRUE(std::isnan(dut.min()));
+    EXPECT_TRUE(std::isnan(dut.max()));
+}
+
+TEST(TestStats, meanImpliesCount) {
+    Metrics::Internals::StatsNoLock<double, Mean> dut;
+    EXPECT_EQ(sizeof(int64_t) + sizeof(double), sizeof dut);
+
+    dut.update(1);
+    dut.update(2);
+    EXPECT_EQ(2, dut.count());
+    EXPECT_EQ(1.5, dut.mean());
+    EXPECT_EQ("count(2) mean(1.5)", dut.toString());
+}
+
+TEST(TestStats, featureOrderIrrelevant) {
+    Metrics::Internals::StatsNoLock<double, Max, M2, Count> dut1;
+    Metrics::Internals::StatsNoLock<double, Count, Mean, M2, Max> dut2;
+    EXPECT_EQ(sizeof dut1, sizeof dut2);
+
+    for (int i = 0; i < 10; i++) {
+        dut1.update(i);
+        dut2.update(i);
+    }
+    EXPECT_EQ(dut2.toString(), dut1.toString());
+}
+
+TEST(TestStats, sum) {
+    Metrics::Stats<Min, Max, M2> dut1;
+    Metrics::Stats<Min, Max, M2> dut2;
+    Metrics::Stats<Min, Max, M2> reference;
+
+    for (int i = 0; i < 20; i++) {
+        const double value = i * i;
+        ((i < 5) ? dut1 : dut2).update(value);
+        reference.update(value);
+    }
+    auto result = dut1 + dut2;
+    EXPECT_EQ(reference.count(), result.count());
+    EXPECT_EQ(reference.min(), result.min());
+    EXPECT_EQ(reference.max(), result.max());
+    EXPECT_NEAR(reference.mean(), result.mean(), EPSILON);
+    EXPECT_NEAR(reference.variance(), result.variance(), 1e-9);
+
+    // adding empty stats changes nothing
+    result += Metrics::Stats<Min, Max, M2>();
+    EXPECT_EQ(reference.count(), result.count());
+    EXPECT_NEAR(reference.mean(), result.mean(), EPSILON);
+
+    Metrics::Stats<Min, Max, M2> empty;
+    empty += reference;
+    EXPECT_EQ(reference.toString(), empty.toString());
+}
+
+TEST(TestStats, selfAdd) {
+    Metrics::Stats<Mean> dut;
+    dut.update(4);
+    dut += dut;
+    EXPECT_EQ(2, dut.count());
+    EXPECT_EQ(4, dut.mean());
+}
+
+} // namespace
@@ -0,0 +1,133 @@
+#include "Metrics/TextExporter.hpp"
+#include "Metrics/Counter.hpp"
+#include "Metrics/Gauge.hpp"
+#include "Metrics/Histogram.hpp"
+#include "Metrics/Registry.hpp"
+#include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Stats.hpp"
+#include "Metrics/TopK.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <clocale>
+#include <memory>
+#include <string>
+
+namespace {
+
+TEST(TestTextExporter, fields) {
+    Metrics::TextExporter exporter(1);
+    exporter.beginMetric("x");
+    exporter.field("count", int64_t{3});
+    exporter.field("mean", 2.25);
+    exporter.field("mean", 1U, -0.5);
+    exporter.quantile(0.5, 2.0);
+    exporter.bin(1.0, 2.0, 4);
+    exporter.entry("key", 7);
+    exporter.text("label", "abc");
+    exporter.endMetric();
+    EXPECT_EQ("x: count(3) mean(2.2) mean[1](-0.5) Q50(2.0) [1.0, 2.0):4 "
+              "key:7 label(abc)\n",
+              exporter.str());
+
+    exporter.clear();
+    EXPECT_EQ("", exporter.str());
+}
+
+TEST(TestTextExporter, shortestRepresentation) {
+    Metrics::TextExporter exporter;
+    exporter.field("a", 0.1);
+    exporter.field("b", 1e300);
+    exporter.quantile(0.999, 2.5);
+    EXPECT_EQ(" a(0.1) b(1e+300) Q99.9(2.5)", exporter.str());
+}
+
+TEST(TestTextExporter, independentOfLocale) {
+    const std::string previous = setlocale(LC_NUMERIC, nullptr);
+    bool found = false;
+    for (const char *name :
+         {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "nl_BE.UTF-8"}) {
+        if (setlocale(LC_NUMERIC, name) != nullptr) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        GTEST_SKIP() << "no locale with a decimal comma installed";
+    }
+    Metrics::TextExporter exporter;
+    exporter.quantile(0.999, 2.5);
+    setlocale(LC_NUMERIC, previous.c_str());
+    EXPECT_EQ(" Q99.9(2.5)", exporter.str());
+}
+
+TEST(TestTextExporter, registry) {
+    Metrics::Registry registry;
+    auto counter = registry.create<Metrics::Counter<>>("counter");
+    auto gauge = registry.create<Metrics::Gauge<>>("gauge");
+    auto stats = registry.create<Metrics::Variance<>>("stats");
+    auto minmax = registry.create<
+        Metrics::Stats<Metrics::Feature::Min, Metrics::Feature::Max>>(
+        "minmax");
+    auto histogram = registry.create<
+        Metrics::Histogram<Metrics::SlidingWindowReservoir<>>>("histogram",
+                                                               10);
+    auto top = registry.create<Metrics::TopK<>>("top", 2);
+
+    counter->inc(2);
+    gauge->update(1.5);
+    for (int i = 1; i <= 5; i++) {
+        stats->update(i);
+        minmax->update(i);
+        histogram->update(i);
+    }
+    top->update("a", 3);
+    top->update("b");
+
+    Metrics::TextExporter exporter(1);
+    registry.visit(exporter);
+    EXPECT_EQ("counter: count(2)\n"
+              "gauge: value(1.5)\n"
+              "histogram: count(5) min(1.0) Q25(2.0) Q50(3.0) Q75(4.0) "
+              "max(5.0)\n"
+              "minmax: min(1.0) max(5.0)\n"
+              "stats: count(5) min(1.0) mean(3.0) max(5.0) "
+              "sample_stddev(1.6)\n"
+              "top: count(4) a:3 b:1\n",
+              exporter.str());
+
+    // a second report reuses the buffer
+    const auto capacity = exporter.str().capacity();
+    exporter.clear();
+    registry.visit(exporter);
+    EXPECT_EQ(capacity, exporter.str().capacity());
+}
+
+TEST(TestTextExporter, histogramBins) {
+    Metrics::Histogram<Metrics::SlidingWindowReservoir<>> histogram(10, true,
+                                                                    2);
+    for (int i = 0; i < 4; i++) {
+        histogram.update(i);
+    }
+    Metrics::TextExporter exporter(1);
+    histogram.visit(exporter);
+    EXPECT_EQ(" count(4) min(0.0) Q25(0.8) Q50(1.5) Q75(2.2) max(3.0) "
+              "mean(1.5) sample_stddev(1.3) [0.0, 1.5):2 [1.5, 3.0):2",
+              exporter.str());
+}
+
+TEST(TestTextExporter, defaultVisit) {
+    struct Custom : public Metrics::IMetric {
+        void reset() noexcept override {}
+        std::string toString(int = -1) const noexcept override {
+            return "custom";
+        }
+    };
+
+    Metrics::Registry registry;
+    registry.addMetric("c", std::make_shared<Custom>());
+    Metrics::TextExporter exporter;
+    registry.visit(exporter);
+    EXPECT_EQ("c: value(custom)\n", exporter.str());
+}
+
+} // namespace
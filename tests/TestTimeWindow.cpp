@@ -0,0 +1,93 @@
+#include "ManualClock.hpp"
+#include "Metrics/LinearRegression.hpp"
+#include "Metrics/MinMeanMax.hpp"
+#include "Metrics/TimeWindow.hpp"
+#include "Metrics/Variance.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+
+namespace {
+template <typename S>
+using TimeWindow = Metrics::TimeWindow<S, std::mutex, ManualClock>;
+
+TEST(TestTimeWindow, empty) {
+    TimeWindow<Metrics::Internals::VarianceNoLock<>> dut{5};
+
+    EXPECT_EQ(0, dut.state().count());
+    EXPECT_TRUE(std::isnan(dut.state().mean()));
+    EXPECT_EQ(std::chrono::seconds(5), dut.window());
+}
+
+TEST(TestTimeWindow, mergesBuckets) {
+    TimeWindow<Metrics::Internals::VarianceNoLock<>> dut{5};
+
+    dut.update(1);
+    ManualClock::advance(std::chrono::seconds(1));
+    dut.update(2);
+    ManualClock::advance(std::chrono::seconds(1));
+    dut.update(3);
+
+    auto state = dut.state();
+    EXPECT_EQ(3, state.count());
+    EXPECT_EQ(1, state.min());
+    EXPECT_EQ(2, state.mean());
+    EXPECT_EQ(3, state.max());
+    EXPECT_EQ(2, state.m2());
+}
+
+TEST(TestTimeWindow, expires) {
+    TimeWindow<Metrics::Internals::MinMeanMaxNoLock<>> dut{
+        3, std::chrono::milliseconds(100)};
+
+    for (int i = 0; i < 10; i++) {
+        dut.update(i);
+        dut.update(i);
+        ManualClock::advance(std::chrono::milliseconds(100));
+    }
+    // buckets of values 7, 8 and 9 are still in the window
+    ManualClock::advance(std::chrono::milliseconds(-100));
+    auto state = dut.state();
+    EXPECT_EQ(6, state.count());
+    EXPECT_EQ(7, state.min());
+    EXPECT_EQ(9, state.max());
+
+    ManualClock::advance(std::chrono::milliseconds(200));
+    EXPECT_EQ(2, dut.state().count());
+    ManualClock::advance(std::chrono::seconds(10));
+    EXPECT_EQ(0, dut.state().count());
+
+    // bucket is reused
+    dut.update(-1);
+    EXPECT_EQ(1, dut.state().count());
+    EXPECT_EQ(-1, dut.state().mean());
+}
+
+TEST(TestTimeWindow, linearRegression) {
+    TimeWindow<Metrics::Internals::LinearRegressionNoLock<>> dut{60};
+
+    for (int i = 0; i < 10; i++) {
+        dut.update(i, 10 + 2 * i);
+        ManualClock::advance(std::chrono::milliseconds(500));
+    }
+    EXPECT_DOUBLE_EQ(2.0, dut.state().slope());
+    EXPECT_DOUBLE_EQ(10.0, dut.state().intercept());
+}
+
+TEST(TestTimeWindow, reset) {
+    TimeWindow<Metrics::Internals::VarianceNoLock<>> dut{5};
+
+    dut.update(1);
+    dut.reset();
+    EXPECT_EQ(0, dut.state().count());
+    dut.update(2);
+    EXPECT_EQ(2, dut.state().mean());
+}
+
+TEST(TestTimeWindow, toString) {
+    TimeWindow<Metrics::Internals::VarianceNoLock<>> dut{5};
+
+    dut.update(1);
+    dut.update(3);
+    EXPECT_EQ(0, dut.toString(1).find("count(2) min(1.0) mean(2.0) max(3.0)"));
+}
+} // namespace
@@ -0,0 +1,93 @@
+#include "ManualClock.hpp"
+#include "Metrics/Clock.hpp"
+#include "Metrics/SlidingWindowReservoir.hpp"
+#include "Metrics/Timer.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+using Timer =
+    Metrics::Timer<Metrics::SlidingWindowReservoir<double>, ManualClock>;
+
+TEST(TestTimer, update) {
+    Timer dut{10};
+
+    dut.update(std::chrono::microseconds(2));
+    dut.update(std::chrono::microseconds(4));
+    EXPECT_EQ(2, dut.count());
+    auto snapshot = dut.getSnapshot();
+    EXPECT_EQ(2000, snapshot.getValue(0));
+    EXPECT_EQ(4000, snapshot.getValue(1));
+}
+
+TEST(TestTimer, scope) {
+    Timer dut{10};
+
+    {
+        auto scope = dut.time();
+        ManualClock::advance(std::chrono::nanoseconds(150));
+    }
+    EXPECT_EQ(1, dut.count());
+    EXPECT_EQ(150, dut.getSnapshot().getValue(0));
+}
+
+TEST(TestTimer, scopeStop) {
+    Timer dut{10};
+
+    {
+        auto scope = dut.time();
+        ManualClock::advance(std::chrono::nanoseconds(10));
+        scope.stop();
+        ManualClock::advance(std::chrono::nanoseconds(10));
+        scope.stop();
+    }
+    EXPECT_EQ(1, dut.count());
+    EXPECT_EQ(10, dut.getSnapshot().getValue(0));
+}
+
+TEST(TestTimer, reset) {
+    Timer dut{10};
+
+    dut.update(std::chrono::microseconds(2));
+    dut.reset();
+    EXPECT_EQ(0, dut.count());
+    EXPECT_EQ(0, dut.getSnapshot().size());
+}
+
+TEST(TestTimer, toString) {
+    Timer dut{10};
+
+    dut.update(std::chrono::nanoseconds(100));
+    EXPECT_NE(std::string::npos,
+              dut.toString(1).find(") min(100.0) Q25(100.0) Q50(100.0) "
+                                   "Q75(100.0) max(100.0)"));
+}
+
+template <typename C> void clockIsMonotonic() {
+    auto previous = C::now();
+    for (int i = 0; i < 1000; i++) {
+        auto now = C::now();
+        EXPECT_LE(previous, now);
+        previous = now;
+    }
+}
+
+TEST(TestTimer, coarseClock) { clockIsMonotonic<Metrics::CoarseClock>(); }
+
+TEST(TestTimer, tscClock) {
+    clockIsMonotonic<Metrics::TscClock>();
+
+    // calibrated against steady_clock: the TSC interval lies between the
+    // inner and outer steady_clock intervals, also when preempted
+    using std::chrono::steady_clock;
+    const auto outer_start = steady_clock::now();
+    const auto start = Metrics::TscClock::now();
+    const auto inner_start = steady_clock::now();
+    while (steady_clock::now() - inner_start < std::chrono::milliseconds(20)) {
+    }
+    const auto inner_stop = steady_clock::now();
+    const auto elapsed = Metrics::TscClock::now() - start;
+    const auto outer_stop = steady_clock::now();
+    EXPECT_GT(elapsed, (inner_stop - inner_start) * 0.95);
+    EXPECT_LT(elapsed, (outer_stop - outer_start) * 1.05);
+}
+} // namespace
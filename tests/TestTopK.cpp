@@ -0,0 +1,179 @@
+#include "Metrics/Registry.hpp"
+#include "Metrics/TopK.hpp"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(TestTopK, empty) {
+    Metrics::TopK<> dut{10};
+
+    EXPECT_EQ(10, dut.size());
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(dut.top().empty());
+    EXPECT_EQ(0, dut.count("a"));
+    EXPECT_EQ("count(0) top()", dut.toString());
+}
+
+TEST(TestTopK, exactWithFewKeys) {
+    Metrics::TopK<> dut{10};
+
+    dut.update("a");
+    dut.update("b");
+    dut.update("a");
+    dut.update("c", 5);
+    dut.update("a");
+
+    auto top = dut.top();
+    ASSERT_EQ(3, top.size());
+    EXPECT_EQ("c", top[0].key);
+    EXPECT_EQ(5, top[0].count);
+    EXPECT_EQ("a", top[1].key);
+    EXPECT_EQ(3, top[1].count);
+    EXPECT_EQ("b", top[2].key);
+    EXPECT_EQ(1, top[2].count);
+    for (const auto &entry : top) {
+        EXPECT_EQ(0, entry.error);
+    }
+    EXPECT_EQ(9, dut.count());
+    EXPECT_EQ("count(9) top(c: 5, a: 3, b: 1)", dut.toString());
+}
+
+TEST(TestTopK, heavyHitters) {
+    // key 0..4 are frequent, all other keys appear once
+    Metrics::TopK<int> dut{20};
+    std::map<int, uint64_t> exact;
+    int rare = 100;
+    for (int i = 0; i < 10000; i++) {
+        const int key = (i % 3 == 0) ? rare++ : i % 5;
+        dut.update(key);
+        exact[key]++;
+    }
+
+    auto top = dut.top();
+    ASSERT_EQ(20, top.size());
+    for (int i = 0; i < 5; i++) {
+        EXPECT_LT(top[i].key, 5);
+    }
+    for (unsigned i = 1; i < top.size(); i++) {
+        EXPECT_GE(top[i - 1].count, top[i].count);
+    }
+    for (const auto &entry : top) {
+        // counts are overestimated by at most the error
+        EXPECT_GE(entry.count, exact[entry.key]);
+        EXPECT_LE(entry.count - entry.error, exact[entry.key]);
+        // error is bounded by count / k
+        EXPECT_LE(entry.error, dut.count() / 20);
+    }
+}
+
+TEST(TestTopK, merge) {
+    Metrics::TopK<int> dut1{3};
+    Metrics::TopK<int> dut2{3};
+
+    dut1.update(1, 10);
+    dut1.update(2, 5);
+    dut2.update(1, 3);
+    dut2.update(3, 7);
+
+    auto dut = dut1 + dut2;
+    auto top = dut.top();
+    ASSERT_EQ(3, top.size());
+    EXPECT_EQ(1, top[0].key);
+    EXPECT_EQ(13, top[0].count);
+    EXPECT_EQ(3, top[1].key);
+    EXPECT_EQ(7, top[1].count);
+    EXPECT_EQ(2, top[2].key);
+    EXPECT_EQ(5, top[2].count);
+    EXPECT_EQ(25, dut.count());
+}
+
+TEST(TestTopK, mergeFullKeepsBounds) {
+    Metrics::TopK<int> dut1{2};
+    Metrics::TopK<int> dut2{2};
+
+    dut1.update(1, 10);
+    dut1.update(2, 4);
+    dut2.update(1, 6);
+    dut2.update(3, 2);
+
+    // 2 is missing in full dut2, so could have appeared up to 2 times
+    dut1 += dut2;
+    auto top = dut1.top();
+    ASSERT_EQ(2, top.size());
+    EXPECT_EQ(1, top[0].key);
+    EXPECT_EQ(16, top[0].count);
+    EXPECT_EQ(2, top[1].key);
+    EXPECT_EQ(6, top[1].count);
+    EXPECT_EQ(2, top[1].error);
+
+    // merged counters keep working
+    dut1.update(2, 20);
+    EXPECT_EQ(2, dut1.top()[0].key);
+    EXPECT_EQ(26, dut1.top()[0].count);
+}
+
+TEST(TestTopK, mergeSelf) {
+    Metrics::TopK<int> dut{3};
+    dut.update(1, 2);
+    dut += dut;
+
+    EXPECT_EQ(4, dut.count(1));
+    EXPECT_EQ(4, dut.count());
+}
+
+TEST(TestTopK, mergePerThread) {
+    const int no_threads = 4;
+    std::vector<Metrics::TopK<int>> per_thread(no_threads,
+                                               Metrics::TopK<int>{10});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < no_threads; t++) {
+        threads.emplace_back([&per_thread, t]() {
+            for (int i = 0; i < 1000; i++) {
+                per_thread[t].update(i % 4);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    Metrics::TopK<int> dut{10};
+    for (const auto &topk : per_thread) {
+        dut += topk;
+    }
+    EXPECT_EQ(4000, dut.count());
+    for (int key = 0; key < 4; key++) {
+        EXPECT_EQ(1000, dut.count(key));
+    }
+}
+
+TEST(TestTopK, reset) {
+    Metrics::TopK<> dut{2};
+    dut.update("a");
+    dut.update("b");
+    dut.update("c");
+    dut.reset();
+
+    EXPECT_EQ(0, dut.count());
+    EXPECT_TRUE(dut.top().empty());
+
+    dut.update("d");
+    EXPECT_EQ(1, dut.count("d"));
+}
+
+TEST(TestTopK, registry) {
+    Metrics::Registry registry;
+    auto dut = std::make_shared<Metrics::TopK<>>(5);
+    registry.addMetric("requests", dut);
+    dut->update("/index.html", 2);
+
+    auto report = registry.reportMap();
+    EXPECT_EQ("count(2) top(/index.html: 2)", report["requests"]);
+}
+
+} // namespace
@@ -4,8 +4,21 @@
 
 namespace {
 
-TEST(TestVariance, singleValue) {
-    Metrics::Variance<> dut;
+/** all tests run with each accumulator */
+template <typename A> class TestVariance : public ::testing::Test {
+  public:
+    using Dut = Metrics::Variance<double, std::mutex, A>;
+    using WeightedDut = Metrics::Variance<double, std::mutex, A, true>;
+};
+
+using Accumulators =
+    ::testing::Types<Metrics::Internals::WelfordAccumulator<double>,
+                     Metrics::Internals::ShiftedSumAccumulator<double>,
+                     Metrics::Internals::ShiftedSumAccumulator<double, true>>;
+TYPED_TEST_SUITE(TestVariance, Accumulators);
+
+TYPED_TEST(TestVariance, singleValue) {
+    typename TestFixture::Dut dut;
 
     EXPECT_TRUE(std::isnan(dut.mean()));
     EXPECT_EQ(0, dut.mean0());
@@ -18,8 +31,8 @@ TEST(TestVariance, singleValue) {
     EXPECT_EQ(0, dut.m2());
 }
 
-TEST(TestVariance, threeValues) {
-    Metrics::Variance<> dut;
+TYPED_TEST(TestVariance, threeValues) {
+    typename TestFixture::Dut dut;
 
     dut.update(1);
     dut.update(2);
@@ -31,14 +44,14 @@ TEST(TestVariance, threeValues) {
     EXPECT_EQ(2, dut.m2());
 }
 
-TEST(TestVariance, threeValuesCompoundPlus) {
-    Metrics::Variance<> dut1;
+TYPED_TEST(TestVariance, threeValuesCompoundPlus) {
+    typename TestFixture::Dut dut1;
     dut1.update(1);
     dut1.update(2);
     dut1.update(3);
 
     // add empty DUT to non-empty DUT
-    Metrics::Variance<> dut2;
+    typename TestFixture::Dut dut2;
     dut1 += dut2;
 
     EXPECT_EQ(1, dut1.min());
@@ -79,9 +92,9 @@ TEST(TestVariance, threeValuesCompoundPlus) {
     EXPECT_EQ(6, dut1.count());
 }
 
-TEST(TestVariance, threeValuesPlus) {
-    Metrics::Variance<> dut1;
-    Metrics::Variance<> dut2;
+TYPED_TEST(TestVariance, threeValuesPlus) {
+    typename TestFixture::Dut dut1;
+    typename TestFixture::Dut dut2;
 
     dut1.update(1);
     dut1.update(2);
@@ -95,8 +108,8 @@ TEST(TestVariance, threeValuesPlus) {
     EXPECT_EQ(2, dut.m2());
 }
 
-TEST(TestVariance, variance) {
-    Metrics::Variance<> dut;
+TYPED_TEST(TestVariance, variance) {
+    typename TestFixture::Dut dut;
 
     EXPECT_TRUE(std::isnan(dut.variance()));
     EXPECT_TRUE(std::isnan(dut.stddev()));
@@ -128,12 +141,12 @@ TEST(TestVariance, variance) {
     EXPECT_DOUBLE_EQ(sqrt(2.0 * 4.0 / 3.0), dut.sample_stddev());
 }
 
-TEST(TestVariance, varianceHighOffset) {
+TYPED_TEST(TestVariance, varianceHighOffset) {
     // Example from
     // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Example
     // - demo correct behavior when high offset
     constexpr double offset = 1e9;
-    Metrics::Variance<> dut;
+    typename TestFixture::Dut dut;
     dut.update(offset + 4);
     dut.update(offset + 7);
     dut.update(offset + 13);
@@ -142,15 +155,15 @@ TEST(TestVariance, varianceHighOffset) {
     EXPECT_DOUBLE_EQ(30.0, dut.sample_variance());
 }
 
-TEST(TestVariance, varianceHighOffsetCompoundPlus) {
+TYPED_TEST(TestVariance, varianceHighOffsetCompoundPlus) {
     // Example from
     // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Example
     // - demo correct behavior when high offset
     constexpr double offset = 1e9;
-    Metrics::Variance<> dut1;
+    typename TestFixture::Dut dut1;
     dut1.update(offset + 4);
     dut1.update(offset + 7);
-    Metrics::Variance<> dut2;
+    typename TestFixture::Dut dut2;
     dut2.update(offset + 13);
     dut2.update(offset + 16);
     dut1 += dut2;
@@ -159,8 +172,8 @@ TEST(TestVariance, varianceHighOffsetCompoundPlus) {
     EXPECT_DOUBLE_EQ(30.0, dut1.sample_variance());
 }
 
-TEST(TestVariance, reset) {
-    Metrics::Variance<> dut;
+TYPED_TEST(TestVariance, reset) {
+    typename TestFixture::Dut dut;
 
     dut.update(-1);
     dut.reset();
@@ -177,8 +190,8 @@ TEST(TestVariance, reset) {
     EXPECT_EQ(1, dut.count());
 }
 
-TEST(TestVariance, rmsFirstSample) {
-    Metrics::Variance<> dut;
+TYPED_TEST(TestVariance, rmsFirstSample) {
+    typename TestFixture::Dut dut;
 
     // RMS of 0 samples is NAN
     EXPECT_TRUE(std::isnan(dut.rms()));
@@ -188,9 +201,9 @@ TEST(TestVariance, rmsFirstSample) {
     EXPECT_DOUBLE_EQ(5.0, dut.rms());
 }
 
-TEST(TestVariance, rms) {
+TYPED_TEST(TestVariance, rms) {
     constexpr int LOOPS = 10;
-    Metrics::Variance<> dut;
+    typename TestFixture::Dut dut;
 
     // signal with DC value 3 + square wave amplitude 4 has RMS value 5
     for (int i = 0; i < LOOPS; i++) {
@@ -201,8 +214,8 @@ TEST(TestVariance, rms) {
     EXPECT_DOUBLE_EQ(5.0, dut.rms());
 }
 
-TEST(TestVariance, toString) {
-    Metrics::Variance<> dut;
+TYPED_TEST(TestVariance, toString) {
+    typename TestFixture::Dut dut;
 
     EXPECT_EQ(0, dut.toString(1).find("count(0) min(nan) mean(nan) max(nan)"));
     dut.update(1);
@@ -211,21 +224,21 @@ TEST(TestVariance, toString) {
     EXPECT_EQ(0, dut.toString(1).find("count(3) min(1.0) mean(2.0) max(3.0)"));
 }
 
-TEST(TestVariance, constructors) {
-    Metrics::Variance<> dut1;
+TYPED_TEST(TestVariance, constructors) {
+    typename TestFixture::Dut dut1;
     dut1.update(1);
 
-    Metrics::Variance<> dut2(dut1);
+    typename TestFixture::Dut dut2(dut1);
     EXPECT_EQ(1, dut1.count());
     EXPECT_EQ(1, dut2.count());
 }
 
-TEST(TestVariance, assignments) {
-    Metrics::Variance<> dut1;
+TYPED_TEST(TestVariance, assignments) {
+    typename TestFixture::Dut dut1;
     dut1.update(1);
     dut1.update(3);
 
-    Metrics::Variance<> dut2;
+    typename TestFixture::Dut dut2;
     dut2 = dut1;
     EXPECT_EQ(2, dut1.mean());
     EXPECT_EQ(2, dut2.mean());
@@ -234,9 +247,9 @@ TEST(TestVariance, assignments) {
     EXPECT_EQ(2, dut2.mean());
 }
 
-TEST(TestVariance, addEmpty) {
-    Metrics::Variance<> dut1;
-    Metrics::Variance<> dut2;
+TYPED_TEST(TestVariance, addEmpty) {
+    typename TestFixture::Dut dut1;
+    typename TestFixture::Dut dut2;
 
     // add empty DUT to empty DUT
     dut1 += dut2;
@@ -247,4 +260,90 @@ TEST(TestVariance, addEmpty) {
     dut1.update(1);
     EXPECT_EQ(1, dut1.mean());
 }
+
+TYPED_TEST(TestVariance, weighted) {
+    // weight 3 is the same as 3 updates
+    typename TestFixture::Dut dut1;
+    typename TestFixture::WeightedDut dut2;
+    for (int i = 0; i < 3; i++) {
+        dut1.update(1);
+    }
+    dut1.update(5);
+    dut1.update(7);
+    dut1.update(7);
+    dut2.update(1, 3);
+    dut2.update(5);
+    dut2.update(7, 2);
+
+    EXPECT_EQ(3, dut2.count());
+    EXPECT_DOUBLE_EQ(6, dut2.weight());
+    EXPECT_DOUBLE_EQ(dut1.mean(), dut2.mean());
+    EXPECT_DOUBLE_EQ(dut1.variance(), dut2.variance());
+    EXPECT_DOUBLE_EQ(dut1.sample_variance(), dut2.sample_variance());
+    EXPECT_DOUBLE_EQ(dut1.rms(), dut2.rms());
+    EXPECT_EQ(1, dut2.min());
+    EXPECT_EQ(7, dut2.max());
+
+    // weight <= 0 is ignored
+    dut2.update(100, 0);
+    dut2.update(100, -1);
+    EXPECT_EQ(3, dut2.count());
+    EXPECT_EQ(7, dut2.max());
+}
+
+TYPED_TEST(TestVariance, addWeighted) {
+    typename TestFixture::WeightedDut dut1;
+    typename TestFixture::WeightedDut dut2;
+    typename TestFixture::WeightedDut all;
+    dut1.update(1, 2.5);
+    dut1.update(4);
+    dut2.update(2, 0.5);
+    dut2.update(8, 1.5);
+    all.update(1, 2.5);
+    all.update(4);
+    all.update(2, 0.5);
+    all.update(8, 1.5);
+
+    dut1 += dut2;
+    EXPECT_DOUBLE_EQ(all.weight(), dut1.weight());
+    EXPECT_DOUBLE_EQ(all.mean(), dut1.mean());
+    EXPECT_DOUBLE_EQ(all.variance(), dut1.variance());
+}
+
+TEST(TestVarianceAccumulator, compensatedSum) {
+    // 0.1 is not exact in binary, a plain sum accumulates the rounding errors
+    constexpr int LOOPS = 1000000;
+    Metrics::Variance<double, std::mutex,
+                      Metrics::Internals::ShiftedSumAccumulator<double, true>>
+        dut;
+    dut.update(0.0);
+    for (int i = 0; i < LOOPS; i++) {
+        dut.update(0.1);
+    }
+
+    const double mean = 0.1 * LOOPS / (LOOPS + 1);
+    EXPECT_NEAR(mean, dut.mean(), 1e-16);
+    EXPECT_NEAR(0.01 * LOOPS / (LOOPS + 1) - mean * mean, dut.variance(),
+                1e-16);
+}
+
+template <typename A> void expectFloatCountsPast2Pow24() {
+    // float can not represent 2^24 + 1, the count stays an integer
+    Metrics::Variance<float, std::mutex, A> dut;
+    dut.update(1);
+    for (int i = 0; i < 24; i++) {
+        dut += dut;
+    }
+    dut.update(1);
+    dut.update(1);
+    EXPECT_EQ((1 << 24) + 2, dut.count());
+    EXPECT_EQ((1 << 24) + 2, dut.weight());
+    EXPECT_EQ(1, dut.mean());
+}
+
+TEST(TestVarianceAccumulator, floatCountsPast2Pow24) {
+    using namespace Metrics::Internals;
+    expectFloatCountsPast2Pow24<WelfordAccumulator<float>>();
+    expectFloatCountsPast2Pow24<ShiftedSumAccumulator<float>>();
+}
 } // namespace